@@ -10,6 +10,7 @@
  *----------------------------------------------------------------------------*/
 
 #include "globalData.h"
+#include "../light/shadow.h"
 
 //------------------------------------------------------------------------------
 //  initData: Initialises the global data
@@ -20,15 +21,27 @@ void initData
   ( Globdat *globdat )
 
 {
-  globdat->mesh.vertexCount   = 0;
-  globdat->mesh.faceCount     = 0;
+  initMesh( &globdat->mesh );
   
   globdat->spheres.count      = 0;
+  globdat->planes.count       = 0;
 
   globdat->sun.intensity      = 0.;
 
   globdat->spotlights.count   = 0;
+  globdat->spotlights.samples = SHADOW_SAMPLES;
+  globdat->spotlights.radius  = SHADOW_RADIUS;
+  globdat->lightBVH           = NULL;
+  globdat->sunMap             = NULL;
+  globdat->radianceCache      = NULL;
+  globdat->aov                = NULL;
+
+  globdat->lods.count         = 0;
   
   globdat->bgimage.loadedFlag = 0;
+
+  globdat->bvh                = NULL;
+
+  initSettings( &globdat->settings );
 }
 
@@ -17,14 +17,24 @@
 #include "../light/sun.h"
 #include "../materials/materials.h"
 #include "../shapes/mesh.h"
+#include "../shapes/planes.h"
+#include "../shapes/lod.h"
 #include "../shapes/spheres.h"
 #include "../util/backGroundImage.h"
 #include "../util/film.h"
 #include "../util/vector.h"
 #include "../light/spotlight.h"
+#include "settings.h"
 
 
 
+struct BVH;
+struct LightBVH;
+struct SunMap;
+struct RadianceCache;
+struct AOVFilm;
+
+
 //------------------------------------------------------------------------------
 //  Declaration of the Globdat type (a global data structure)
 //------------------------------------------------------------------------------
@@ -37,11 +47,22 @@ typedef struct
   BGImage     bgimage;
   Materials   materials;
   Spheres     spheres;
+  Planes      planes;
   Mesh        mesh;
+  LODObjects  lods;
+
+  struct BVH  *bvh;
   
   Sun         sun;
   Spotlights  spotlights;
 
+  struct LightBVH *lightBVH;
+  struct SunMap   *sunMap;
+  struct RadianceCache *radianceCache;
+  struct AOVFilm  *aov;
+
+  Settings    settings;
+
   char        filename[40];
 } Globdat;
 
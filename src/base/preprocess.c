@@ -7,10 +7,15 @@
  *
  *  Versions:
  *  03/02/2020 | J.Remmers    | First version
- *             |              |
+ *  19/10/2026 |              | Vertex normals and BVH are built here
  *----------------------------------------------------------------------------*/
 
+#include <omp.h>
 #include "preprocess.h"
+#include "../util/bvh.h"
+#include "../light/lightbvh.h"
+#include "../light/sunmap.h"
+#include "../light/radiancecache.h"
 
 
 //------------------------------------------------------------------------------
@@ -23,6 +28,59 @@ void preprocess
   ( Globdat  *globdat )
 
 {
+  double t0,t1,t2;
+
+  printf("\n  PREPROCESS\n");
+  printf("    Number of threads ....... : %d\n",omp_get_max_threads());
+
   initialiseCamera( &globdat->cam , globdat->film );
-}
 
+  if ( globdat->settings.groundRadius > 0.0 )
+  {
+    convertLargeSpheres( &globdat->spheres , &globdat->planes , 
+                         globdat->cam.origin , globdat->settings.groundRadius );
+  }
+
+  t0 = omp_get_wtime();
+
+  selectLODLevels( &globdat->lods , &globdat->cam , &globdat->mesh );
+
+  if ( globdat->settings.reorderMesh && globdat->mesh.faceCount > 0 )
+  {
+    reorderMesh( &globdat->mesh );
+  }
+
+  if ( globdat->mesh.faceCount > 0 )
+  {
+    addFaceNormals( &globdat->mesh );
+  }
+
+  if ( globdat->settings.compactMesh && globdat->mesh.faceCount > 0 )
+  {
+    compactMesh( &globdat->mesh );
+  }
+
+  t1 = omp_get_wtime();
+
+  globdat->bvh = createBVH( globdat );
+
+  globdat->lightBVH = createLightBVH( &globdat->spotlights );
+
+  t2 = omp_get_wtime();
+
+  printf("    Mesh setup .............. : %f s\n",t1-t0);
+  printf("    BVH construction ........ : %f s (%d nodes)\n",t2-t1,globdat->bvh->nodeCount);
+
+  if ( globdat->settings.sunMapSize > 0 )
+  {
+    globdat->sunMap = createSunMap( globdat , globdat->settings.sunMapSize );
+
+    printf("    Sun map construction .... : %f s\n",omp_get_wtime()-t2);
+  }
+
+  if ( globdat->settings.cacheCellSize > 0.0 )
+  {
+    globdat->radianceCache = createRadianceCache( globdat->settings.cacheCellSize ,
+                                                  globdat->settings.cacheError );
+  }
+}
@@ -27,6 +27,9 @@ const char *VERTICES  = "Vertices";
 const char *FILENAME  = "Filename";
 const char *MATERIALS = "Materials";
 const char *SPOTLIGHTS = "Spotlights";
+const char *PLANES    = "Planes";
+const char *SETTINGS  = "Settings";
+const char *LOD       = "LOD";
 
 //------------------------------------------------------------------------------
 //  readInput: Reads the input data from a file
@@ -84,6 +87,10 @@ void readInput
     {
       readSphereData( fin , &globdat->spheres );
     }
+    else if ( strcmp( label , PLANES ) == 0 )
+    {
+      readPlaneData( fin , &globdat->planes );
+    }
     else if ( strcmp( label , FACES ) == 0 )
     {
       readFaceData( fin , &globdat->mesh );
@@ -96,6 +103,14 @@ void readInput
     {
       readMaterialData( fin , &globdat->materials );
     }    
+    else if ( strcmp( label , LOD ) == 0 )
+    {
+      readLODData( fin , &globdat->lods );
+    }
+    else if ( strcmp( label , SETTINGS ) == 0 )
+    {
+      readSettingsData( fin , &globdat->settings );
+    }
     else if( strcmp( label , FILENAME ) == 0 )
     {
       fscanf( fin , "%s" , globdat->filename );
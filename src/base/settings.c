@@ -0,0 +1,346 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "../util/aov.h"
+
+const char *GROUNDPLANE = "GroundPlane";
+const char *COMPACTMESH = "CompactMesh";
+const char *REORDERMESH = "ReorderMesh";
+const char *ADAPTIVE    = "Adaptive";
+const char *PROGRESSIVE = "Progressive";
+const char *TIMEBUDGET  = "TimeBudget";
+const char *TARGETERROR = "TargetError";
+const char *ADAPTIVESHADOWS = "AdaptiveShadows";
+const char *LIGHTSAMPLES = "LightSamples";
+const char *STOCHASTICLIGHTS = "StochasticLights";
+const char *SUNMAP = "SunMap";
+const char *RADIANCECACHE = "RadianceCache";
+const char *TILESIZE = "TileSize";
+const char *HDROUTPUT = "HDROutput";
+const char *EXPOSURE = "Exposure";
+const char *GAMMA = "Gamma";
+const char *CHECKPOINT = "Checkpoint";
+const char *AOV = "AOV";
+const char *DENOISE = "Denoise";
+const char *PREVIEW = "Preview";
+
+const char *AOV_NAMES[] = { "depth" , "normal" , "material" , "albedo" , "sun" , "lights" };
+
+
+//------------------------------------------------------------------------------
+//  initSettings: Sets the default values of the settings
+//------------------------------------------------------------------------------
+
+
+void initSettings
+
+  ( Settings*   settings )
+
+{
+  settings->groundRadius = 0.0;
+  settings->compactMesh  = 0;
+  settings->reorderMesh  = 1;
+
+  settings->adaptiveBase  = 0;
+  settings->adaptiveError = 1.0;
+
+  settings->progressivePass = 0;
+  settings->timeBudget      = 0.0;
+  settings->targetError     = 0.0;
+
+  settings->adaptiveShadows = 0;
+  settings->lightSamples    = 0;
+  settings->stochasticLights = 0;
+  settings->sunMapSize      = 0;
+  settings->cacheCellSize   = 0.0;
+  settings->cacheError      = 0.02;
+  settings->tileSize        = 32;
+  settings->hdrOutput       = 0;
+  settings->exposure        = 0.0;
+  settings->gamma           = 2.0;
+  settings->checkpointInterval = 0.0;
+  settings->resume          = 0;
+  settings->firstTile       = 0;
+  settings->lastTile        = -1;
+  settings->claimDir[0]     = '\0';
+  settings->partialFilm[0]  = '\0';
+  settings->aovs            = 0;
+  settings->denoise         = 0;
+  settings->previewInterval = 0.0;
+
+  memset( settings->cropWindow , 0 , sizeof(settings->cropWindow) );
+}
+
+
+//------------------------------------------------------------------------------
+//  readSettingsData: Reads the settings from a file
+//------------------------------------------------------------------------------
+
+
+void readSettingsData
+
+  ( FILE*       fin      ,
+    Settings*   settings )
+
+{
+  char label[20] = "None";
+
+  fscanf( fin , "%s" , label );
+
+  while( strcmp( label , "End" ) != 0 )
+  {
+    if( strcmp( label , GROUNDPLANE ) == 0 )
+    {
+      fscanf( fin , "%le" , &settings->groundRadius );
+    }
+    else if( strcmp( label , COMPACTMESH ) == 0 )
+    {
+      fscanf( fin , "%d" , &settings->compactMesh );
+    }
+    else if( strcmp( label , REORDERMESH ) == 0 )
+    {
+      fscanf( fin , "%d" , &settings->reorderMesh );
+    }
+    else if( strcmp( label , ADAPTIVE ) == 0 )
+    {
+      fscanf( fin , "%d %le" , &settings->adaptiveBase , &settings->adaptiveError );
+    }
+    else if( strcmp( label , PROGRESSIVE ) == 0 )
+    {
+      fscanf( fin , "%d" , &settings->progressivePass );
+    }
+    else if( strcmp( label , TIMEBUDGET ) == 0 )
+    {
+      fscanf( fin , "%le" , &settings->timeBudget );
+    }
+    else if( strcmp( label , TARGETERROR ) == 0 )
+    {
+      fscanf( fin , "%le" , &settings->targetError );
+    }
+    else if( strcmp( label , ADAPTIVESHADOWS ) == 0 )
+    {
+      fscanf( fin , "%d" , &settings->adaptiveShadows );
+    }
+    else if( strcmp( label , LIGHTSAMPLES ) == 0 )
+    {
+      fscanf( fin , "%d" , &settings->lightSamples );
+    }
+    else if( strcmp( label , STOCHASTICLIGHTS ) == 0 )
+    {
+      fscanf( fin , "%d" , &settings->stochasticLights );
+    }
+    else if( strcmp( label , SUNMAP ) == 0 )
+    {
+      fscanf( fin , "%d" , &settings->sunMapSize );
+
+      // The map has a border of two texels on each side
+
+      if ( settings->sunMapSize != 0 && settings->sunMapSize <= 4 )
+      {
+        printf("ERROR: Sun map size %d must be larger than 4, the map is disabled\n",settings->sunMapSize);
+        settings->sunMapSize = 0;
+      }
+    }
+    else if( strcmp( label , RADIANCECACHE ) == 0 )
+    {
+      fscanf( fin , "%le %le" , &settings->cacheCellSize , &settings->cacheError );
+    }
+    else if( strcmp( label , TILESIZE ) == 0 )
+    {
+      fscanf( fin , "%d" , &settings->tileSize );
+    }
+    else if( strcmp( label , EXPOSURE ) == 0 )
+    {
+      fscanf( fin , "%le" , &settings->exposure );
+    }
+    else if( strcmp( label , GAMMA ) == 0 )
+    {
+      fscanf( fin , "%le" , &settings->gamma );
+    }
+    else if( strcmp( label , CHECKPOINT ) == 0 )
+    {
+      fscanf( fin , "%le" , &settings->checkpointInterval );
+    }
+    else if( strcmp( label , AOV ) == 0 )
+    {
+      char name[20];
+
+      fscanf( fin , "%19s" , name );
+
+      if ( strcmp( name , "all" ) == 0 )
+      {
+        settings->aovs = AOV_ALL;
+      }
+
+      for ( int k = 0 ; k < AOV_KINDS ; k++ )
+      {
+        if ( strcmp( name , AOV_NAMES[k] ) == 0 )
+        {
+          settings->aovs |= 1 << k;
+        }
+      }
+    }
+    else if( strcmp( label , DENOISE ) == 0 )
+    {
+      fscanf( fin , "%d" , &settings->denoise );
+    }
+    else if( strcmp( label , PREVIEW ) == 0 )
+    {
+      fscanf( fin , "%le" , &settings->previewInterval );
+    }
+    else if( strcmp( label , HDROUTPUT ) == 0 )
+    {
+      char format[20];
+
+      fscanf( fin , "%19s" , format );
+
+      if ( strcmp( format , "pfm" ) == 0 )
+      {
+        settings->hdrOutput = HDR_PFM;
+      }
+      else if ( strcmp( format , "exr" ) == 0 )
+      {
+        settings->hdrOutput = HDR_EXR;
+      }
+      else if ( strcmp( format , "both" ) == 0 )
+      {
+        settings->hdrOutput = HDR_PFM | HDR_EXR;
+      }
+      else
+      {
+        settings->hdrOutput = 0;
+      }
+    }
+
+    fscanf( fin , "%s" , label );
+  }
+
+  printf("  SETTINGS\n");
+  printf("    Ground plane radius ..... : %f \n",settings->groundRadius);
+  printf("    Compact mesh ............ : %d \n",settings->compactMesh);
+  printf("    Reorder mesh ............ : %d \n",settings->reorderMesh);
+  printf("    Adaptive shadows ........ : %d \n",settings->adaptiveShadows);
+  printf("    Light samples ........... : %d \n",settings->lightSamples);
+  printf("    Stochastic lights ....... : %d \n",settings->stochasticLights);
+  printf("    Sun map size ............ : %d \n",settings->sunMapSize);
+  printf("    Tile size ............... : %d \n",settings->tileSize);
+  printf("    Exposure ................ : %f \n",settings->exposure);
+  printf("    Gamma ................... : %f \n",settings->gamma);
+  printf("    HDR output .............. : %s%s%s \n",
+         settings->hdrOutput == 0       ? "none" : "",
+         settings->hdrOutput & HDR_PFM  ? "pfm "  : "",
+         settings->hdrOutput & HDR_EXR  ? "exr"  : "");
+
+  if ( settings->cacheCellSize > 0.0 )
+  {
+    printf("    Radiance cache cell size  : %f \n",settings->cacheCellSize);
+    printf("    Radiance cache error .... : %f \n",settings->cacheError);
+  }
+
+  if ( settings->aovs != 0 )
+  {
+    printf("    Output variables ........ :");
+
+    for ( int k = 0 ; k < AOV_KINDS ; k++ )
+    {
+      if ( settings->aovs & ( 1 << k ) )
+      {
+        printf(" %s",AOV_NAMES[k]);
+      }
+    }
+
+    printf("\n");
+  }
+
+  if ( settings->denoise > 0 )
+  {
+    printf("    Denoise levels .......... : %d \n",settings->denoise);
+  }
+
+  if ( settings->previewInterval > 0.0 )
+  {
+    printf("    Preview interval ........ : %f \n",settings->previewInterval);
+  }
+
+  if ( settings->checkpointInterval > 0.0 )
+  {
+    printf("    Checkpoint interval ..... : %f \n",settings->checkpointInterval);
+  }
+
+  if ( settings->adaptiveBase > 0 )
+  {
+    printf("    Adaptive base samples ... : %d \n",settings->adaptiveBase);
+    printf("    Adaptive error .......... : %f \n",settings->adaptiveError);
+  }
+
+  if ( settings->progressivePass > 0 )
+  {
+    printf("    Progressive pass ........ : %d \n",settings->progressivePass);
+    printf("    Time budget ............. : %f \n",settings->timeBudget);
+    printf("    Target error ............ : %f \n",settings->targetError);
+  }
+  printf("\n");
+}
+
+
+//------------------------------------------------------------------------------
+//  readSettingsOptions: Reads the options on the command line
+//------------------------------------------------------------------------------
+
+
+int readSettingsOptions
+
+  ( int         argc     ,
+    char*       argv[]   ,
+    Settings*   settings )
+
+{
+  int i;
+
+  for ( i = 2 ; i < argc ; i++ )
+  {
+    if ( strcmp( argv[i] , "--resume" ) == 0 )
+    {
+      settings->resume = 1;
+    }
+    else if ( strcmp( argv[i] , "--crop" ) == 0 && i + 4 < argc )
+    {
+      for ( int k = 0 ; k < 4 ; k++ )
+      {
+        settings->cropWindow[k] = atoi( argv[++i] );
+      }
+    }
+    else if ( strcmp( argv[i] , "--tiles" ) == 0 && i + 2 < argc )
+    {
+      settings->firstTile = atoi( argv[++i] );
+      settings->lastTile  = atoi( argv[++i] );
+    }
+    else if ( strcmp( argv[i] , "--claim" ) == 0 && i + 1 < argc )
+    {
+      snprintf( settings->claimDir , sizeof(settings->claimDir) , "%s" , argv[++i] );
+    }
+    else if ( strcmp( argv[i] , "--partial" ) == 0 && i + 1 < argc )
+    {
+      snprintf( settings->partialFilm , sizeof(settings->partialFilm) , "%s" , argv[++i] );
+    }
+    else
+    {
+      printf("ERROR: Unknown or incomplete option '%s'\n",argv[i]);
+      return -1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef BASE_SETTINGS_H
+#define BASE_SETTINGS_H
+
+#include <stdio.h>
+
+
+#define HDR_PFM 1
+#define HDR_EXR 2
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the Settings type (optional settings of the renderer)
+//      groundRadius : Spheres with a larger radius are replaced by a plane
+//                     (0 = no conversion)
+//      compactMesh  : Store the mesh in single precision with encoded normals
+//      reorderMesh  : Sort faces and vertices along a Morton curve
+//      adaptiveBase : Number of samples of every pixel in adaptive sampling
+//                     (0 = all pixels get samples_per_pixel samples)
+//      adaptiveError: Pixels with a larger standard error (in 8 bit output
+//                     levels) get more samples, up to samples_per_pixel
+//      progressivePass : Number of samples per pixel in each pass of the 
+//                     progressive mode (0 = no progressive mode)
+//      timeBudget   : Progressive mode stops after this time (seconds)
+//      targetError  : Progressive mode stops when the average pixel error is
+//                     below this value
+//      adaptiveShadows : Probe the soft shadows before tracing all samples
+//                     (biased, 0 = off)
+//      lightSamples : Number of spotlights that is sampled per hit point 
+//                     (0 = all spotlights that can reach the point)
+//      stochasticLights : Number of shadow rays per hit point for the sun and
+//                     all spotlights together (0 = off)
+//      sunMapSize   : Resolution of the sun visibility map, larger than 4
+//                     (0 = no map)
+//      cacheCellSize: Cell size of the radiance cache (0 = no cache)
+//      cacheError   : Largest spread of the light in a cell of the radiance 
+//                     cache that is reused
+//      tileSize     : Size of the square tiles in which the image is rendered
+//      hdrOutput    : Linear float images that are written next to the 
+//                     bitmap (HDR_PFM and/or HDR_EXR)
+//      exposure     : Exposure of the 8 bit image in stops
+//      gamma        : Gamma of the 8 bit image
+//      checkpointInterval : Time between two checkpoints of the film in
+//                     seconds (0 = no checkpoints)
+//      resume       : Continue from the checkpoint file (set by the --resume
+//                     option on the command line)
+//      cropWindow   : Pixels x0, y0, x1, y1 that are rendered, x1 and y1 not
+//                     included (x1 = 0: the whole image)
+//      firstTile    : First tile that is rendered
+//      lastTile     : Last tile that is rendered (-1 = up to the last tile)
+//      claimDir     : Shared directory in which the tiles are claimed by
+//                     the processes that render the image ("" = no claims)
+//      partialFilm  : Partial film file that is written instead of the 
+//                     image ("" = the whole image is rendered)
+//      aovs         : Output variables that are written to a multi-channel 
+//                     EXR file (AOV_DEPTH, ..., 0 = none)
+//      denoise      : Number of levels of the denoising filter that is
+//                     applied to the image (0 = off)
+//      previewInterval : Time between two previews of the film in seconds
+//                     (0 = no preview)
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  double     groundRadius;
+  int        compactMesh;
+  int        reorderMesh;
+  int        adaptiveBase;
+  double     adaptiveError;
+  int        progressivePass;
+  double     timeBudget;
+  double     targetError;
+  int        adaptiveShadows;
+  int        lightSamples;
+  int        stochasticLights;
+  int        sunMapSize;
+  double     cacheCellSize;
+  double     cacheError;
+  int        tileSize;
+  int        hdrOutput;
+  double     exposure;
+  double     gamma;
+  double     checkpointInterval;
+  int        resume;
+  int        cropWindow[4];
+  int        firstTile;
+  int        lastTile;
+  char       claimDir[64];
+  char       partialFilm[64];
+  int        aovs;
+  int        denoise;
+  double     previewInterval;
+} Settings;
+
+
+//------------------------------------------------------------------------------
+//  initSettings: Sets the default values of the settings
+//
+//  Arguments:
+//      settings : Pointer to the settings
+//
+//------------------------------------------------------------------------------
+
+
+void initSettings
+
+  ( Settings*   settings );
+
+
+//------------------------------------------------------------------------------
+//  readSettingsData: Reads the settings from a file
+//
+//  Arguments:
+//      fin      : File pointer to the file that contains the settings
+//      settings : Pointer to the settings
+//
+//------------------------------------------------------------------------------
+
+
+void readSettingsData
+
+  ( FILE*       fin      ,
+    Settings*   settings );
+
+
+//------------------------------------------------------------------------------
+//  readSettingsOptions: Reads the options on the command line after the name
+//                       of the input file:
+//                         --resume                 continue from checkpoint
+//                         --crop x0 y0 x1 y1       render a pixel rectangle
+//                         --tiles first last       render a range of tiles
+//                         --claim dir              claim tiles in directory
+//                         --partial file           name of the partial film
+//
+//  Arguments:
+//      argc     : number of arguments
+//      argv     : the arguments
+//      settings : Pointer to the settings
+//
+//  Return:
+//      int      : 0 on success, -1 if an option is not valid
+//
+//------------------------------------------------------------------------------
+
+
+int readSettingsOptions
+
+  ( int         argc     ,
+    char*       argv[]   ,
+    Settings*   settings );
+
+#endif
+
+
@@ -11,10 +11,71 @@
  *             |              |
  *----------------------------------------------------------------------------*/
 
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "shutdown.h"
 #include "../shapes/mesh.h"
 #include "../util/film.h"
 #include "../util/backGroundImage.h"
+#include "../util/bvh.h"
+#include "../light/lightbvh.h"
+#include "../light/sunmap.h"
+#include "../light/radiancecache.h"
+
+//------------------------------------------------------------------------------
+//  getOutputName: Returns the name of an output file, which is the name of 
+//                 the bitmap with a prefix and another extension
+//------------------------------------------------------------------------------
+
+
+void getOutputName
+
+  ( Globdat*     globdat   ,
+    const char*  prefix    ,
+    const char*  extension ,
+    char*        name      ,
+    int          size      )
+
+{
+  char *dot = strrchr( globdat->filename , '.' );
+  int  base = dot ? (int)( dot - globdat->filename ) : (int)strlen( globdat->filename );
+
+  snprintf( name , size , "%s%.*s%s" , prefix , base , globdat->filename , extension );
+}
+
+
+//------------------------------------------------------------------------------
+//  openOutputWriter: Opens the output files of the film
+//------------------------------------------------------------------------------
+
+
+FilmWriter* openOutputWriter
+
+  ( Globdat*  globdat )
+
+{
+  char pfmName[48], exrName[48], countName[48];
+
+  int  hdrOutput = globdat->settings.hdrOutput;
+  int  adaptive  = globdat->settings.adaptiveBase > 0;
+
+  getOutputName( globdat , ""     , ".pfm" , pfmName   , sizeof(pfmName)   );
+  getOutputName( globdat , ""     , ".exr" , exrName   , sizeof(exrName)   );
+  getOutputName( globdat , "spp_" , ".bmp" , countName , sizeof(countName) );
+
+  FilmWriter *writer = openFilmWriter( globdat->film , globdat->filename ,
+                                       ( hdrOutput & HDR_PFM ) ? pfmName   : NULL ,
+                                       ( hdrOutput & HDR_EXR ) ? exrName   : NULL ,
+                                       adaptive                ? countName : NULL ,
+                                       globdat->cam.samples_per_pixel );
+
+  writer->exposure = pow( 2.0 , globdat->settings.exposure );
+  writer->gamma    = ( globdat->settings.gamma > 0.0 ) ? globdat->settings.gamma : 2.0;
+
+  return writer;
+}
+
 
 //------------------------------------------------------------------------------
 //  shutdown: Shuts down the RayTracer
@@ -26,12 +87,63 @@ void shutdown
   ( Globdat*  globdat )
 
 {
-  saveToBitmap( globdat->film , globdat->filename );
+  // A film that is rendered in bands has already been written by trace, a
+  // part of the image is written to the partial film file by trace
+
+  int partial = globdat->settings.partialFilm[0] != '\0';
+
+  if ( globdat->film->bandSize == globdat->film->height && !partial )
+  {
+    FilmWriter *writer = openOutputWriter( globdat );
+
+    writeFilmRows( writer , globdat->film );
+    closeFilmWriter( writer );
+  }
+
+  free( globdat->film );
+  free( globdat->aov );
   
   freeBGImage( &globdat->bgimage );
   freeMesh   ( &globdat->mesh );  
+  freeBVH    ( globdat->bvh );
+  freeLightBVH( globdat->lightBVH );
+  freeSunMap ( globdat->sunMap );
+  freeRadianceCache( globdat->radianceCache );
 
   printf("\n  The Raytracer has finished successfully.\n");
+
+  if ( partial )
+  {
+    printf("  The partial film is stored in the file '%s'.\n",globdat->settings.partialFilm);
+    return;
+  }
+
   printf("  The image is stored in the file '%s'.\n",globdat->filename);
+
+  char name[48];
+
+  if ( globdat->settings.hdrOutput & HDR_PFM )
+  {
+    getOutputName( globdat , "" , ".pfm" , name , sizeof(name) );
+    printf("  The linear image is stored in the file '%s'.\n",name);
+  }
+
+  if ( globdat->settings.hdrOutput & HDR_EXR )
+  {
+    getOutputName( globdat , "" , ".exr" , name , sizeof(name) );
+    printf("  The linear image is stored in the file '%s'.\n",name);
+  }
+
+  if ( globdat->aov != NULL )
+  {
+    getOutputName( globdat , "" , "_aov.exr" , name , sizeof(name) );
+    printf("  The output variables are stored in the file '%s'.\n",name);
+  }
+
+  if ( globdat->settings.adaptiveBase > 0 )
+  {
+    getOutputName( globdat , "spp_" , ".bmp" , name , sizeof(name) );
+    printf("  The sample counts are stored in the file '%s'.\n",name);
+  }
 }
 
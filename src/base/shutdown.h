@@ -29,6 +29,49 @@ void shutdown
 
   ( Globdat*  globdat );
 
+
+//------------------------------------------------------------------------------
+//  getOutputName: Returns the name of an output file, which is the name of 
+//                 the image with a prefix and another extension
+//
+//  Arguments:
+//      globdat   : Pointer to the global data
+//      prefix    : prefix of the name
+//      extension : extension of the name, including the dot
+//      name      : the name of the output file
+//      size      : size of the name buffer
+//
+//------------------------------------------------------------------------------
+
+
+void getOutputName
+
+  ( Globdat*     globdat   ,
+    const char*  prefix    ,
+    const char*  extension ,
+    char*        name      ,
+    int          size      );
+
+
+//------------------------------------------------------------------------------
+//  openOutputWriter: Opens the output files of the film: the 8 bit image 
+//                    (a PNG file if the file name ends with .png), the linear
+//                    images of the HDROutput setting and, in adaptive 
+//                    sampling, the sample counts
+//
+//  Arguments:
+//      globdat : Pointer to the global data
+//
+//  Return:
+//      FilmWriter* : the writer
+//
+//------------------------------------------------------------------------------
+
+
+FilmWriter* openOutputWriter
+
+  ( Globdat*  globdat );
+
 #endif
 
 
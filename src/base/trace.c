@@ -20,8 +20,18 @@
 #include "../util/color.h"
 #include "../util/ray.h"
 #include "../util/film.h"
+#include "shutdown.h"
 #include "../util/bvh.h"
+#include "../util/sampler.h"
 #include "../light/shadow.h"
+#include "../light/lightbvh.h"
+#include "../light/sunmap.h"
+#include "../light/radiancecache.h"
+#include "../util/checkpoint.h"
+#include "../util/region.h"
+#include "../util/aov.h"
+#include "../util/denoise.h"
+#include "../util/preview.h"
 
 #include <omp.h>
 #include <stdlib.h>
@@ -40,30 +50,16 @@ void trace
   printf("\n  +++ Start tracing +++\n");
 
   int ix, iy;
-  double u, v;
 
-  Ray ray;
-  Color color, addColor, bgColor;
-  bgColor.red = (int)255 * 0.678;
-  bgColor.green = (int)255 * 0.847;
-  bgColor.blue = (int)255 * 0.902;
-
-  Intersect intersection;
-
-  BVH *bvh = (BVH *)malloc(sizeof(BVH));
-  bvh->nodeCount = 0;
-
-  int total = globdat->mesh.faceCount + globdat->spheres.count;
-  buildBVH(bvh, globdat, 0, total);
+  BVH *bvh = globdat->bvh;
 
   int numThreads = 16;
   omp_set_num_threads(numThreads);
 
   int spp = globdat->cam.samples_per_pixel;
-  int strat = globdat->cam.strat;
   int sqrt_spp = (int)sqrt((double)spp);
 
-  if (strat == 1 && sqrt_spp * sqrt_spp != spp)
+  if (globdat->cam.sampler == SAMPLER_STRATIFIED && sqrt_spp * sqrt_spp != spp)
   {
     if (omp_get_thread_num() == 0)
     {
@@ -72,105 +68,695 @@ void trace
     exit(1);
   }
 
+  // The image is rendered in passes of a number of samples per pixel. In 
+  // adaptive sampling, a pixel is skipped once its error is small enough. In
+  // progressive mode, the rendering stops when the time budget or the target
+  // error of the image is reached.
+
+  int    adaptiveBase  = globdat->settings.adaptiveBase;
+  double adaptiveError = globdat->settings.adaptiveError;
+  int    progressive   = globdat->settings.progressivePass;
+  double timeBudget    = globdat->settings.timeBudget;
+  double targetError   = globdat->settings.targetError;
+
+  int passSize = spp;
+
+  if (progressive > 0)
+  {
+    passSize = progressive;
+  }
+  else if (adaptiveBase > 0)
+  {
+    passSize = adaptiveBase;
+  }
+
+  // The film is split in square tiles that are numbered row by row. A thread
+  // renders a whole tile in scanline order into its own tile buffer, which is
+  // added to the film once the tile is finished.
+
+  int tileSize = globdat->settings.tileSize > 0 ? globdat->settings.tileSize : 32;
+
+  long totalSamples = 0;
+
   Vec3 *offsets;
-  offsets = (Vec3 *)malloc(SHADOW_SAMPLES * sizeof(Vec3));
-  createRandomOffsets(offsets);
+  offsets = (Vec3 *)malloc(globdat->spotlights.samples * sizeof(Vec3));
+  createShadowOffsets(offsets, globdat->spotlights.samples);
+
+  resetShadowCounters();
+
+  // A film with a memory limit holds a band of rows. The bands are rendered
+  // one after the other and written to the output files when they are done;
+  // the time budget is shared between the bands.
+
+  Film *film = globdat->film;
+  FilmWriter *writer = NULL;
+
+  // A process that renders a part of the image writes its tiles to a partial
+  // film file. The parts are given by a crop window, a range of tiles or by
+  // the tiles that the process claims first in a shared directory.
+
+  Region *region = NULL;
+  Settings *settings = &globdat->settings;
+
+  if (settings->partialFilm[0] != '\0')
+  {
+    region = createRegion(film, tileSize, settings->cropWindow, settings->firstTile, settings->lastTile,
+                          settings->claimDir, settings->partialFilm, pow(2.0, settings->exposure),
+                          (settings->gamma > 0.0) ? settings->gamma : 2.0);
+
+    if (region == NULL)
+    {
+      exit(1);
+    }
+  }
+  else if (film->bandSize < film->height)
+  {
+    writer = openOutputWriter(globdat);
+  }
+
+  // The output variables are stored in planes that follow the bands of the
+  // film, and are written to a multi-channel EXR file next to the image. The
+  // denoiser filters the whole film and is guided by the depth, normal and
+  // albedo planes, which are added when they are not written.
+
+  AOVFilm *aov = NULL;
+  AOVWriter *aovWriter = NULL;
+  int nSpots = globdat->spotlights.count;
+  int aovFlags = settings->aovs;
+  int denoise = 0;
+
+  if (settings->denoise > 0 && region != NULL)
+  {
+    printf("    Denoising is not available for a partial film\n");
+  }
+  else if (settings->denoise > 0 && film->bandSize < film->height)
+  {
+    printf("    Denoising is not available for a film with a memory limit\n");
+  }
+  else if (settings->denoise > 0)
+  {
+    aovFlags |= DENOISE_FEATURES;
+    denoise = settings->denoise;
+  }
+
+  if (settings->aovs != 0 && region != NULL)
+  {
+    printf("    Output variables are not written for a partial film\n");
+  }
+  else if (aovFlags != 0)
+  {
+    char name[48];
+
+    getOutputName(globdat, "", "_aov.exr", name, sizeof(name));
+
+    aov = createAOVFilm(aovFlags, nSpots, film);
+    aovWriter = (settings->aovs != 0 && aov->channels > 0) ? openAOVWriter(aov, film->height, name) : NULL;
+
+    if (globdat->radianceCache != NULL && (settings->aovs & (AOV_SUN | AOV_LIGHTS)))
+    {
+      printf("    The radiance cache is not used for the light output variables\n");
+    }
+  }
+
+  globdat->aov = aov;
+
+  // A checkpoint stores the film and the tiles that are finished in the 
+  // current pass. The samples are counter based, so a resumed render gives
+  // the same image as an uninterrupted one.
+
+  Checkpoint *checkpoint = NULL;
+
+  if (globdat->settings.checkpointInterval > 0.0 || globdat->settings.resume)
+  {
+    if (film->bandSize < film->height)
+    {
+      printf("    Checkpoints are not available for a film with a memory limit\n");
+    }
+    else if (settings->claimDir[0] != '\0')
+    {
+      printf("    Checkpoints are not available when tiles are claimed\n");
+    }
+    else
+    {
+      char name[48];
+
+      getOutputName(globdat, "", ".ckpt", name, sizeof(name));
+
+      checkpoint = createCheckpoint(name, globdat->settings.checkpointInterval, film, spp, tileSize);
+
+      if (aov != NULL)
+      {
+        checkpoint->aovData = aov->p;
+        checkpoint->aovSize = (long)film->rows * film->width * aov->channels;
+      }
+
+      installCheckpointSignals();
+    }
+  }
+
+  // A preview of the film is written at an interval, so that a viewer can
+  // follow the render. A low resolution pass with one sample per block fills
+  // the pixels that have no samples yet, and the tiles are rendered from the
+  // centre of the image out.
+
+  Preview *preview = NULL;
 
-#pragma omp parallel for collapse(2) schedule(dynamic, 16) private(ray, u, v, intersection, color, addColor)
-  for (ix = 0; ix < globdat->film->width; ix++)
+  if (settings->previewInterval > 0.0 && film->bandSize < film->height)
   {
-    for (iy = 0; iy < globdat->film->height; iy++)
+    printf("    Preview is not available for a film with a memory limit\n");
+  }
+  else if (settings->previewInterval > 0.0)
+  {
+    char name[48];
+
+    getOutputName(globdat, "", "_preview.bmp", name, sizeof(name));
+
+    preview = createPreview(name, settings->previewInterval, film, tileSize, pow(2.0, settings->exposure),
+                            (settings->gamma > 0.0) ? settings->gamma : 2.0);
+
+    int blocks = preview->blocksX * preview->blocksY;
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int b = 0; b < blocks; b++)
+    {
+      int i, j;
+      Sampler sampler;
+
+      getPreviewBlockPixel(preview, b, &i, &j);
+
+      initSampler(&sampler, globdat->cam.sampler, spp);
+      startSample(&sampler, j * film->width + i, 0);
+
+      preview->blocks[b] = traceSample(globdat, bvh, offsets, &sampler, i, j, NULL);
+    }
+
+    writePreview(preview);
+
+    printf("    Preview file ............ : %s\n", name);
+  }
+
+  for (int y0 = 0; y0 < film->height; y0 += film->bandSize)
+  {
+    startFilmBand(film, y0);
+
+    if (region != NULL)
     {
-      color.red = 0;
-      color.green = 0;
-      color.blue = 0;
+      startRegionBand(region, film);
+    }
+
+    if (checkpoint != NULL && globdat->settings.resume && readCheckpoint(checkpoint, film))
+    {
+      totalSamples = checkpoint->totalSamples;
+
+      printf("    Resumed from checkpoint . : pass %d, sample %d\n", checkpoint->pass + 1, checkpoint->first);
+    }
+    else if (aov != NULL)
+    {
+      startAOVBand(aov, film);
+    }
+
+    double t0 = omp_get_wtime();
+    double budget = timeBudget * film->rows / film->height;
+    int tileCount = getTileCount(film, tileSize);
+    int *tileOrder = (int *)malloc(tileCount * sizeof(int));
+
+    for (int t = 0; t < tileCount; t++)
+    {
+      tileOrder[t] = t;
+    }
+
+    if (preview != NULL)
+    {
+      getCentreOutTileOrder(film, tileSize, tileOrder);
+    }
+
+    int first = (checkpoint != NULL) ? checkpoint->first : 0;
+    int pass = (checkpoint != NULL) ? checkpoint->pass : 0;
+    int done = 0;
+
+    while (first < spp && !done)
+    {
+      int last = (first + passSize < spp) ? first + passSize : spp;
+      long activePixels = 0;
+
+      if (checkpoint != NULL)
+      {
+        startCheckpointPass(checkpoint, first, pass);
+        activePixels = checkpoint->activePixels;
+      }
+
+#pragma omp parallel private(ix, iy)
+      {
+        Tile *tile = createTile(tileSize);
+        AOVFilm *aovTile = (aov != NULL) ? createAOVTile(aov, tileSize) : NULL;
 
-      for (int sample = 0; sample < spp; sample++) {
-        u = 1.0;
-        v = 1.0;
+        double spotAOV[nSpots + 1];
+        AOVSample aovSample;
+        AOVSample *sampleAOV = (aov != NULL) ? &aovSample : NULL;
 
-        if (globdat->cam.strat == 1) {
-          double jitter_x = rand() / (double)RAND_MAX;
-          double jitter_y = rand() / (double)RAND_MAX;
+        aovSample.lights = spotAOV;
 
-          int sx = sample % sqrt_spp;
-          int sy = sample / sqrt_spp;
+#pragma omp for schedule(dynamic, 1)
+        for (int k = 0; k < tileCount; k++)
+        {
+          int t = tileOrder[k];
 
-          u = (sx + jitter_x) / sqrt_spp;
-          v = (sy + jitter_y) / sqrt_spp;
-        } else {
-          if (spp > 1)
+          if (checkpoint != NULL && (checkpoint->tileDone[t] || checkpointStopRequested()))
           {
-            u = (rand() % 1000) / 1000.0;
-            v = (rand() % 1000) / 1000.0;
+            continue;
           }
-        }
 
-        generateCameraRay(&ray, ix, iy, u, v, &globdat->cam);
+          if (region != NULL && !claimRegionTile(region, film, t))
+          {
+            continue;
+          }
 
-        resetIntersect(&intersection);
-        traverseBVH(bvh, globdat, &ray, &intersection);
+          startTile(tile, globdat->film, tileSize, t);
 
-        if (intersection.matID == -1)
-        {
-          if (globdat->bgimage.loadedFlag == 1)
+          if (aovTile != NULL)
+          {
+            startAOVTile(aovTile, tile);
+          }
+
+          if (first > 0 && budget > 0.0 && omp_get_wtime() - t0 > budget)
           {
-            int jx, jy;
+            continue;
+          }
+
+          long tileSamples = 0;
+          long tilePixels = 0;
 
-            mapRayToBGCoordinates(&jx, &jy, ray, globdat);
-            addColor = getBGImagePixelValue(&globdat->bgimage, jx, jy);
+          for (iy = tile->y0; iy < tile->y0 + tile->height; iy++)
+          {
+            for (ix = tile->x0; ix < tile->x0 + tile->width; ix++)
+            {
+              if (region != NULL && !insideRegion(region, ix, iy))
+              {
+                continue;
+              }
+
+              if (first > 0 && adaptiveBase > 0 && getPixelError(globdat->film, ix, iy) < adaptiveError)
+              {
+                continue;
+              }
+
+              Sampler sampler;
+              initSampler(&sampler, globdat->cam.sampler, spp);
+
+              for (int sample = first; sample < last; sample++)
+              {
+                startSample(&sampler, iy * globdat->film->width + ix, sample);
+
+                if (sampleAOV != NULL)
+                {
+                  clearAOVSample(sampleAOV, nSpots);
+                }
+
+                Color color = traceSample(globdat, bvh, offsets, &sampler, ix, iy, sampleAOV);
+
+                addTileSample(tile, ix, iy, &color, 1.0);
+
+                if (sampleAOV != NULL)
+                {
+                  addAOVSample(aovTile, ix, iy, sampleAOV);
+                }
+              }
+
+              tileSamples += last - first;
+              tilePixels++;
+            }
+          }
+
+          int checkpointDue = 0;
+
+          // The tiles do not overlap, so they are added to the film without a
+          // lock, together with their output variables. The snapshot of a
+          // checkpoint needs a film and planes without partial tiles, the
+          // preview locks only the tile that it copies.
+
+          if (checkpoint != NULL)
+          {
+#pragma omp critical (flushTile)
+            {
+              flushPreviewTile(preview, globdat->film, tile, aov, aovTile, t);
+
+              totalSamples += tileSamples;
+              activePixels += tilePixels;
+
+              checkpointDue = finishCheckpointTile(checkpoint, globdat->film, t, totalSamples, activePixels);
+            }
           }
           else
           {
-            addColor = bgColor;
+            flushPreviewTile(preview, globdat->film, tile, aov, aovTile, t);
+
+#pragma omp atomic
+            totalSamples += tileSamples;
+#pragma omp atomic
+            activePixels += tilePixels;
+          }
+
+          // The checkpoint is written outside the critical section, so that
+          // the other threads keep adding their tiles to the film
+
+          if (checkpointDue)
+          {
+            writeCheckpointSnapshot(checkpoint);
+          }
+
+          // The previews are taken and written by the master thread between
+          // its tiles
+
+          if (preview != NULL && omp_get_thread_num() == 0 && takePreviewSnapshot(preview, globdat->film))
+          {
+            writePreview(preview);
           }
         }
-        else
+
+        free(tile);
+        free(aovTile);
+      }
+
+      if (checkpoint != NULL && checkpointStopRequested())
+      {
+        writeCheckpoint(checkpoint, film);
+
+        printf("    Render stopped, the checkpoint is stored in '%s'\n", checkpoint->fileName);
+        exit(1);
+      }
+
+      first = last;
+      pass++;
+
+      if (activePixels == 0)
+      {
+        done = 1;
+      }
+
+      if (progressive > 0)
+      {
+        double elapsed = omp_get_wtime() - t0;
+        double error = getFilmError(globdat->film);
+
+        printf("    Pass %-4d ............... : %d samples, error %.4f, %.2f s\n", pass, last, error, elapsed);
+
+        if (budget > 0.0 && elapsed >= budget)
         {
-          double lightIntensity = computeIntensity(globdat, bvh, offsets, &ray, &intersection);
-          addColor = getColor(lightIntensity, &globdat->materials.mat[intersection.matID]);
+          printf("    Time budget reached\n");
+          done = 1;
+        }
+        else if (targetError > 0.0 && error <= targetError)
+        {
+          printf("    Target error reached\n");
+          done = 1;
         }
-        
-        color.red += addColor.red;
-        color.green += addColor.green;
-        color.blue += addColor.blue;
       }
+    }
+
+    free(tileOrder);
 
-      color.red /= spp;
-      color.green /= spp;
-      color.blue /= spp;
+    if (writer != NULL)
+    {
+      writeFilmRows(writer, film);
+    }
 
-      storePixelRGB(globdat->film, ix, iy, &color);
+    if (region != NULL)
+    {
+      writeRegionTiles(region, film);
     }
+
+    if (aovWriter != NULL)
+    {
+      writeAOVRows(aovWriter, aov, film);
+    }
+  }
+
+  closeAOVWriter(aovWriter);
+
+  if (denoise > 0)
+  {
+    double t1 = omp_get_wtime();
+
+    denoiseFilm(film, aov, denoise);
+
+    printf("    Denoising ............... : %d levels, %.2f s\n", denoise, omp_get_wtime() - t1);
+  }
+
+  if (writer != NULL)
+  {
+    closeFilmWriter(writer);
+  }
+
+  if (region != NULL)
+  {
+    printf("    Tiles in partial film ... : %ld\n", closeRegion(region));
+  }
+
+  if (checkpoint != NULL)
+  {
+    remove(checkpoint->fileName);
+    freeCheckpoint(checkpoint);
+  }
+
+  freePreview(preview);
+  free(offsets);
+
+  printf("    Average samples per pixel : %.2f\n",
+         totalSamples / (double)(globdat->film->width * globdat->film->height));
+
+  long shadowCast, shadowSaved;
+
+  getShadowCounters(&shadowCast, &shadowSaved);
+
+  if (globdat->sunMap != NULL)
+  {
+    long resolved, fallback;
+
+    getSunMapCounters(&resolved, &fallback);
+
+    printf("    Sun map lookups ......... : %ld (%.1f%% without shadow ray)\n", resolved + fallback,
+           100.0 * resolved / (double)(resolved + fallback + (resolved + fallback == 0)));
+  }
+
+  if (globdat->radianceCache != NULL)
+  {
+    long hits, misses;
+
+    getRadianceCacheCounters(&hits, &misses);
+
+    printf("    Radiance cache lookups .. : %ld (%.1f%% reused)\n", hits + misses,
+           100.0 * hits / (double)(hits + misses + (hits + misses == 0)));
+  }
+
+  if (shadowCast > 0)
+  {
+    printf("    Soft shadow rays cast ... : %ld\n", shadowCast);
+    printf("    Soft shadow rays saved .. : %ld (%.1f%%)\n", shadowSaved,
+           100.0 * shadowSaved / (double)(shadowCast + shadowSaved));
   }
 }
 
 //------------------------------------------------------------------------------
-//  computeIntensity: Computes the intensity of a pixel from the shadows
+//  traceSample: Traces a single camera ray and returns its color
 //------------------------------------------------------------------------------
 
-double computeIntensity(Globdat *globdat, BVH *bvh, Vec3 *offsets, Ray *ray, Intersect *intersection) {
-  Vec3 hitPoint = addVector(1.0, &ray->o, intersection->t, &ray->d);
+Color traceSample(Globdat *globdat, BVH *bvh, Vec3 *offsets, Sampler *sampler, int ix, int iy, AOVSample *aov)
+{
+  double u = 1.0;
+  double v = 1.0;
+  double lu, lv;
+
+  Ray ray;
+  Color color, bgColor;
+  bgColor.red = (int)255 * 0.678;
+  bgColor.green = (int)255 * 0.847;
+  bgColor.blue = (int)255 * 0.902;
+
+  Intersect intersection;
+
+  if (sampler->spp > 1 || sampler->type != SAMPLER_RANDOM)
+  {
+    getSample2D(sampler, SAMPLER_DIM_PIXEL, &u, &v);
+  }
+
+  getSample2D(sampler, SAMPLER_DIM_LENS, &lu, &lv);
+
+  generateCameraRay(&ray, ix, iy, u, v, lu, lv, &globdat->cam);
+
+  resetIntersect(&intersection);
+  traverseBVH(bvh, globdat, &ray, &intersection);
+
+  if (intersection.matID == -1)
+  {
+    if (globdat->bgimage.loadedFlag == 1)
+    {
+      int jx, jy;
+
+      mapRayToBGCoordinates(&jx, &jy, ray, globdat);
+      color = getBGImagePixelValue(&globdat->bgimage, jx, jy);
+    }
+    else
+    {
+      color = bgColor;
+    }
+
+    if (aov != NULL)
+    {
+      aov->albedo = color;
+    }
+  }
+  else
+  {
+    AOVSample *lightAOV = NULL;
+
+    if (aov != NULL)
+    {
+      aov->depth = intersection.t;
+      aov->normal = intersection.normal;
+      aov->matID = intersection.matID;
+      aov->albedo = globdat->materials.mat[intersection.matID].base;
+
+      if (globdat->settings.aovs & (AOV_SUN | AOV_LIGHTS))
+      {
+        lightAOV = aov;
+      }
+    }
+
+    double lightIntensity = computeIntensity(globdat, bvh, offsets, sampler, &ray, &intersection, lightAOV);
+    color = getColor(lightIntensity, &globdat->materials.mat[intersection.matID]);
+  }
+
+  return color;
+}
+
+//------------------------------------------------------------------------------
+//  computeDirectLight: Computes the light of the sun and the spotlights at a
+//                      hit point, without the ambient light
+//------------------------------------------------------------------------------
+
+static double computeDirectLight(Globdat *globdat, BVH *bvh, Vec3 *offsets, Sampler *sampler, Vec3 hitPoint, Intersect *intersection, AOVSample *aov) {
   double lightIntensity = 0.0;
 
-  Intersect shadowHit;
-  resetIntersect(&shadowHit);
+  if (globdat->settings.stochasticLights > 0)
+  {
+    return computeStochasticLight(globdat, bvh, offsets, sampler, &hitPoint, &intersection->normal, globdat->settings.stochasticLights,
+                                  aov ? &aov->sun : NULL, aov ? aov->lights : NULL);
+  }
+
+  // The sun map decides the visibility of the sun for most points, a shadow
+  // ray is only needed near the shadow edges
 
-  Ray shadowRay;
-  createShadowRay(globdat, bvh, &shadowRay, &hitPoint, &globdat->sun.d, &intersection->normal);
-  traverseBVH(bvh, globdat, &shadowRay, &shadowHit);
+  int sunVisible = -1;
 
-  if (shadowHit.matID == -1)
+  if (globdat->sunMap != NULL)
   {
-    lightIntensity += fmax(dotProduct(&globdat->sun.d, &intersection->normal), 0.0);
+    sunVisible = lookupSunMap(globdat->sunMap, &hitPoint, &intersection->normal);
   }
 
-  for (int iSpot = 0; iSpot < globdat->spotlights.count; iSpot++)
+  if (sunVisible == -1)
   {
-    lightIntensity += computeSoftShadow(globdat, bvh, offsets, &hitPoint, &intersection->normal, intersection, iSpot);
+    Intersect shadowHit;
+    resetIntersect(&shadowHit);
+
+    Ray shadowRay;
+    createShadowRay(globdat, bvh, &shadowRay, &hitPoint, &globdat->sun.d, &intersection->normal);
+    traverseBVH(bvh, globdat, &shadowRay, &shadowHit);
+
+    sunVisible = (shadowHit.matID == -1);
   }
 
+  if (sunVisible)
+  {
+    double sun = fmax(dotProduct(&globdat->sun.d, &intersection->normal), 0.0);
+
+    lightIntensity += sun;
+
+    if (aov != NULL)
+    {
+      aov->sun = sun;
+    }
+  }
+
+  // The light BVH gives the spotlights that can reach the hit point. Either
+  // all of them are evaluated, or lightSamples of them are selected with a 
+  // probability proportional to their importance.
+
+  LightBVH *lbvh = globdat->lightBVH;
+  int lightSamples = globdat->settings.lightSamples;
+
+  if (lbvh != NULL && (lightSamples <= 0 || lightSamples >= globdat->spotlights.count))
+  {
+    int lights[globdat->spotlights.count];
+    int nLights = collectLights(lbvh, &hitPoint, &intersection->normal, lights);
+
+    for (int i = 0; i < nLights; i++)
+    {
+      double light = computeSoftShadow(globdat, bvh, offsets, sampler, &hitPoint, &intersection->normal, intersection, lights[i]);
+
+      lightIntensity += light;
+
+      if (aov != NULL)
+      {
+        aov->lights[lights[i]] += light;
+      }
+    }
+  }
+  else if (lbvh != NULL)
+  {
+    double u, unused;
+
+    getSample2D(sampler, SAMPLER_DIM_LIGHT_SELECT, &u, &unused);
+
+    for (int i = 0; i < lightSamples; i++)
+    {
+      double pdf;
+      int iSpot = sampleLight(lbvh, &hitPoint, &intersection->normal, fmod(u + (double)i / lightSamples, 1.0), &pdf);
+
+      if (iSpot >= 0)
+      {
+        double light = computeSoftShadow(globdat, bvh, offsets, sampler, &hitPoint, &intersection->normal, intersection, iSpot) / (pdf * lightSamples);
+
+        lightIntensity += light;
+
+        if (aov != NULL)
+        {
+          aov->lights[iSpot] += light;
+        }
+      }
+    }
+  }
+
+  return lightIntensity;
+}
+
+//------------------------------------------------------------------------------
+//  computeIntensity: Computes the intensity of a pixel from the shadows
+//------------------------------------------------------------------------------
+
+double computeIntensity(Globdat *globdat, BVH *bvh, Vec3 *offsets, Sampler *sampler, Ray *ray, Intersect *intersection, AOVSample *aov) {
+  Vec3 hitPoint = addVector(1.0, &ray->o, intersection->t, &ray->d);
+  double lightIntensity;
   double ambient = 0.05;
+
+  // Cells of the radiance cache with enough samples and a small spread reuse
+  // the average light, all other points cast their shadow rays and add the 
+  // result to the cache. The cache does not know the light of each source,
+  // so it is not used when these are needed.
+
+  RadianceCache *cache = (aov == NULL) ? globdat->radianceCache : NULL;
+
+  if (cache != NULL && lookupRadianceCache(cache, &hitPoint, &intersection->normal, &lightIntensity))
+  {
+    return fmin(ambient + lightIntensity, 1.0);
+  }
+
+  lightIntensity = computeDirectLight(globdat, bvh, offsets, sampler, hitPoint, intersection, aov);
+
+  if (cache != NULL)
+  {
+    addRadianceCache(cache, &hitPoint, &intersection->normal, lightIntensity);
+  }
+
   return fmin(ambient + lightIntensity, 1.0);
 }
 
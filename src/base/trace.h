@@ -15,6 +15,9 @@
 
 #include "globalData.h"
 #include "../util/bvh.h"
+#include "../util/sampler.h"
+#include "../util/color.h"
+#include "../util/aov.h"
 
 
 //------------------------------------------------------------------------------
@@ -30,14 +33,50 @@ void trace
   ( Globdat*  globdat );
 
 
+//------------------------------------------------------------------------------
+//  traceSample: Traces a single camera ray through pixel (ix,iy), using the
+//               current sample of the sampler, and returns its color
+//
+//  Arguments:
+//      globdat : Pointer to the global data
+//      bvh     : Pointer to the bvh data structure
+//      offsets : Offsets of the shadow rays
+//      sampler : Pointer to the sampler (pixel and sample already set)
+//      ix      : x-coordinate of the pixel
+//      iy      : y-coordinate of the pixel
+//      aov     : output variables of the sample, which must be cleared 
+//                (NULL = not needed)
+//
+//  Return:
+//      Color   : the color of the sample
+//
+//------------------------------------------------------------------------------
+
+
+Color traceSample
+
+  ( Globdat* globdat,
+    BVH *bvh,
+    Vec3 *offsets,
+    Sampler *sampler,
+    int ix,
+    int iy,
+    AOVSample *aov );
+
+
 //------------------------------------------------------------------------------
 //  computeIntensity: Computes the intensity of a pixel from the shadows
 //
 //  Arguments:
 //      globdat      : Pointer to the global data
 //      bvh          : Pointer to the bvh data structure
+//      offsets      : Base pattern of the soft shadow samples
+//      sampler      : Sampler of the current pixel sample
 //      ray          : Ray structure
 //      intersection : Intersection point of the ray with the scene
+//      aov          : receives the light of the sun and of each spotlight
+//                     (NULL = not needed). The radiance cache is not used 
+//                     for these samples.
 //
 //------------------------------------------------------------------------------
 
@@ -47,8 +86,10 @@ double computeIntensity
   ( Globdat* globdat,
     BVH *bvh,
     Vec3 *offsets,
+    Sampler *sampler,
     Ray *ray,
-    Intersect *intersection );
+    Intersect *intersection,
+    AOVSample *aov );
 
 
 //------------------------------------------------------------------------------
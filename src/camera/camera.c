@@ -17,12 +17,14 @@
 #include <string.h>
 #include "camera.h"
 #include "../util/mathutils.h"
+#include "../util/sampler.h"
 
 const char *LOCATION = "Centre";
 const char *ROTATION = "Rotation";
 const char *FOV = "Fov";
 const char *SAMPLE = "Samples";
 const char *STRATIFIED = "Stratified";
+const char *SAMPLER = "Sampler";
 const char *APERTURE = "Aperture";
 const char *FOCAL_LENGTH = "Focallength";
 
@@ -37,6 +39,7 @@ void readCameraData
 
 {
   char label[20] = "None";
+  char name[20] = "None";
 
   fscanf(fin, "%s", label);
 
@@ -45,6 +48,7 @@ void readCameraData
   cam->tilt.z = 0.0;
   cam->samples_per_pixel = 1;
   cam->strat = 0;
+  cam->sampler = -1;
   cam->aperture = 0.0;
   cam->focal_length = 1.0;
 
@@ -70,6 +74,18 @@ void readCameraData
     {
       fscanf(fin, "%d", &cam->strat);
     }
+    else if (strcmp(label, SAMPLER) == 0)
+    {
+      fscanf(fin, "%s", name);
+
+      cam->sampler = getSamplerType(name);
+
+      if (cam->sampler < 0)
+      {
+        printf("    Unknown sampler %s, using random\n", name);
+        cam->sampler = SAMPLER_RANDOM;
+      }
+    }
     else if (strcmp(label, APERTURE) == 0)
     {
       fscanf(fin, "%le", &cam->aperture);
@@ -82,12 +98,19 @@ void readCameraData
     fscanf(fin, "%s", label);
   }
 
+  // Stratified 1 is kept for the older input files
+
+  if (cam->sampler < 0)
+  {
+    cam->sampler = (cam->strat == 1) ? SAMPLER_STRATIFIED : SAMPLER_RANDOM;
+  }
+
   printf("  CAMERA\n");
   printf("    Location ................ : %f %f %f \n", cam->origin.x, cam->origin.y, cam->origin.z);
   printf("    Rotation ................ : %f %f %f \n", cam->tilt.x, cam->tilt.y, cam->tilt.z);
   printf("    Field Of View ........... : %f \n", cam->fov);
   printf("    Number of samples ....... : %d \n", cam->samples_per_pixel);
-  printf("    Stratified sampling ..... : %d \n", cam->strat);
+  printf("    Sampler ................. : %s \n", getSamplerName(cam->sampler));
   printf("    Camera aperture ......... : %f \n", cam->aperture);
   printf("    Camera focal length ..... : %f \n", cam->focal_length);
 
@@ -114,6 +137,78 @@ void initialiseCamera
 
   cam->z0 = -0.5 * (height - cam->dx);
   cam->y0 = 0.5 * (width - cam->dx);
+
+  // convert input angles to radians
+  double yaw = cam->tilt.y * PICONST / 180;
+  double pitch = cam->tilt.x * PICONST / 180;
+  double roll = cam->tilt.z * PICONST / 180;
+
+  // calculate cosine and sine of angles
+  double cy = cos(yaw), sy = sin(yaw);
+  double cx = cos(pitch), sx = sin(pitch);
+  double cz = cos(roll), sz = sin(roll);
+
+  // The columns of the rotation matrix are the viewing direction and the
+  // horizontal and vertical axes of the image plane
+
+  Vec3 forward = {cy * cz, sx * sy * cz - cx * sz, cx * sy * cz + sx * sz};
+  Vec3 right = {cy * sz, sx * sy * sz + cx * cz, cx * sy * sz - sx * cz};
+  Vec3 up = {-sy, sx * cy, cx * cy};
+
+  double f = cam->focal_length;
+
+  // direction = pixel00 + (ix + u) * pixelDx + (iy - v) * pixelDy
+
+  cam->pixel00.x = f * (forward.x + cam->y0 * right.x + cam->z0 * up.x);
+  cam->pixel00.y = f * (forward.y + cam->y0 * right.y + cam->z0 * up.y);
+  cam->pixel00.z = f * (forward.z + cam->y0 * right.z + cam->z0 * up.z);
+
+  cam->pixelDx = multiplyVector(-f * cam->dx, &right);
+  cam->pixelDy = multiplyVector(f * cam->dx, &up);
+
+  // The lens lies in the plane perpendicular to the viewing direction
+
+  cam->lensU = multiplyVector(0.5 * cam->aperture, &right);
+  cam->lensV = multiplyVector(0.5 * cam->aperture, &up);
+
+  cam->width = film->width;
+}
+
+//------------------------------------------------------------------------------
+//  concentricDisk: Maps a point in the unit square to the unit disc
+//                  (Shirley and Chiu, 1997)
+//------------------------------------------------------------------------------
+
+static void concentricDisk
+
+    (double lu,
+     double lv,
+     double *r1,
+     double *r2)
+
+{
+  double a = 2.0 * lu - 1.0;
+  double b = 2.0 * lv - 1.0;
+
+  if (a == 0.0 && b == 0.0)
+  {
+    *r1 = 0.0;
+    *r2 = 0.0;
+  }
+  else if (fabs(a) > fabs(b))
+  {
+    double phi = 0.25 * PICONST * b / a;
+
+    *r1 = a * cos(phi);
+    *r2 = a * sin(phi);
+  }
+  else
+  {
+    double phi = 0.5 * PICONST - 0.25 * PICONST * a / b;
+
+    *r1 = b * cos(phi);
+    *r2 = b * sin(phi);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -127,80 +222,132 @@ void generateCameraRay
      int iy,
      double u,
      double v,
+     double lu,
+     double lv,
      CameraData *cam)
 
 {
-  double lens_radius = 0.5 * cam->aperture;
-  double r1, r2;
-  // create disc with random point r1 and r2 on it.
-  do
+  double px = ix + u;
+  double py = iy - v;
+
+  Vec3 dir;
+
+  dir.x = cam->pixel00.x + px * cam->pixelDx.x + py * cam->pixelDy.x;
+  dir.y = cam->pixel00.y + px * cam->pixelDx.y + py * cam->pixelDy.y;
+  dir.z = cam->pixel00.z + px * cam->pixelDx.z + py * cam->pixelDy.z;
+
+  ray->o = cam->origin;
+  ray->mask = RAY_CAMERA;
+
+  if (cam->aperture > 0.0)
   {
-    r1 = 2.0 * rand() / (double)RAND_MAX - 1.0;
-    r2 = 2.0 * rand() / (double)RAND_MAX - 1.0;
-  } while (r1 * r1 + r2 * r2 > 1.0);
+    double r1, r2;
 
-  double lens_x = lens_radius * r1;
-  double lens_y = lens_radius * r2;
+    concentricDisk(lu, lv, &r1, &r2);
 
-  // convert input angles to radians
-  double yaw = cam->tilt.y * PICONST / 180;
-  double pitch = cam->tilt.x * PICONST / 180;
-  double roll = cam->tilt.z * PICONST / 180;
+    // Calculate the offset by the lens
+    Vec3 offset = addVector(r1, &cam->lensU, r2, &cam->lensV);
 
-  // calculate cosine and sine of angles
-  double cy = cos(yaw), sy = sin(yaw);
-  double cx = cos(pitch), sx = sin(pitch);
-  double cz = cos(roll), sz = sin(roll);
+    // The ray passes through the same point on the focal plane
+    ray->o = addVector(1.0, &cam->origin, 1.0, &offset);
+    dir = addVector(1.0, &dir, -1.0, &offset);
+  }
 
-  ray->o = cam->origin;
+  unit(&dir);
+
+  ray->d = dir;
+}
+
+//------------------------------------------------------------------------------
+//  generateCameraRayRow: Generates the rays of a row of pixels
+//------------------------------------------------------------------------------
+
+void generateCameraRayRow
+
+    (RayBatch *batch,
+     int ix0,
+     int iy,
+     int count,
+     Sampler *sampler,
+     CameraData *cam)
+
+{
+  double u[RAY_BATCH_SIZE], v[RAY_BATCH_SIZE];
+  double lu[RAY_BATCH_SIZE], lv[RAY_BATCH_SIZE];
+
+  if (count > RAY_BATCH_SIZE)
+  {
+    count = RAY_BATCH_SIZE;
+  }
+
+  batch->count = count;
+  batch->mask  = RAY_CAMERA;
+
+  // The samples are drawn first, so that the loops below only contain 
+  // arithmetic and can be vectorised. Each pixel starts its own sample on a
+  // copy of the sampler, the sampler of the caller is not changed.
+
+  Sampler pixelSampler = *sampler;
 
-  // Define 3x3 rotation matrix
-  double R[3][3];
-
-  R[0][0] = cy * cz;
-  R[0][1] = cy * sz;
-  R[0][2] = -sy;
-
-  R[1][0] = sx * sy * cz - cx * sz;
-  R[1][1] = sx * sy * sz + cx * cz;
-  R[1][2] = sx * cy;
-
-  R[2][0] = cx * sy * cz + sx * sz;
-  R[2][1] = cx * sy * sz - sx * cz;
-  R[2][2] = cx * cy;
-
-  double dx = 1.0;
-  double dy = cam->y0 - (ix + u) * cam->dx;
-  double dz = cam->z0 + (iy - v) * cam->dx;
-
-  // set the direction of the rays using the lens
-  double dir_x = dx * cam->focal_length;
-  double dir_y = dy * cam->focal_length;
-  double dir_z = dz * cam->focal_length;
-
-  // Rotate direction
-  double dir_rot_x = R[0][0] * dir_x + R[0][1] * dir_y + R[0][2] * dir_z;
-  double dir_rot_y = R[1][0] * dir_x + R[1][1] * dir_y + R[1][2] * dir_z;
-  double dir_rot_z = R[2][0] * dir_x + R[2][1] * dir_y + R[2][2] * dir_z;
-
-  // Calculate the offset by the lens
-  double offset_x = R[0][0] * lens_x + R[0][1] * lens_y;
-  double offset_y = R[1][0] * lens_x + R[1][1] * lens_y;
-  double offset_z = R[2][0] * lens_x + R[2][1] * lens_y;
-
-  // Set the origin of the ray equal to that of the camera plus the lens
-  ray->o.x = cam->origin.x + offset_x;
-  ray->o.y = cam->origin.y + offset_y;
-  ray->o.z = cam->origin.z + offset_z;
-
-  // Determine the direction of the rays
-  ray->d.x = dir_rot_x - offset_x;
-  ray->d.y = dir_rot_y - offset_y;
-  ray->d.z = dir_rot_z - offset_z;
-
-  // normalize the vectors
-  double length = sqrt(ray->d.x * ray->d.x + ray->d.y * ray->d.y + ray->d.z * ray->d.z);
-  ray->d.x /= length;
-  ray->d.y /= length;
-  ray->d.z /= length;
+  for (int i = 0; i < count; i++)
+  {
+    u[i] = 1.0;
+    v[i] = 1.0;
+
+    startSample(&pixelSampler, iy * cam->width + ix0 + i, sampler->sample);
+
+    if (pixelSampler.spp > 1 || pixelSampler.type != SAMPLER_RANDOM)
+    {
+      getSample2D(&pixelSampler, SAMPLER_DIM_PIXEL, &u[i], &v[i]);
+    }
+
+    getSample2D(&pixelSampler, SAMPLER_DIM_LENS, &lu[i], &lv[i]);
+  }
+
+  #pragma omp simd
+  for (int i = 0; i < count; i++)
+  {
+    double px = ix0 + i + u[i];
+    double py = iy - v[i];
+
+    batch->ox[i] = cam->origin.x;
+    batch->oy[i] = cam->origin.y;
+    batch->oz[i] = cam->origin.z;
+
+    batch->dx[i] = cam->pixel00.x + px * cam->pixelDx.x + py * cam->pixelDy.x;
+    batch->dy[i] = cam->pixel00.y + px * cam->pixelDx.y + py * cam->pixelDy.y;
+    batch->dz[i] = cam->pixel00.z + px * cam->pixelDx.z + py * cam->pixelDy.z;
+  }
+
+  if (cam->aperture > 0.0)
+  {
+    for (int i = 0; i < count; i++)
+    {
+      double r1, r2;
+
+      concentricDisk(lu[i], lv[i], &r1, &r2);
+
+      double offx = r1 * cam->lensU.x + r2 * cam->lensV.x;
+      double offy = r1 * cam->lensU.y + r2 * cam->lensV.y;
+      double offz = r1 * cam->lensU.z + r2 * cam->lensV.z;
+
+      batch->ox[i] += offx;
+      batch->oy[i] += offy;
+      batch->oz[i] += offz;
+
+      batch->dx[i] -= offx;
+      batch->dy[i] -= offy;
+      batch->dz[i] -= offz;
+    }
+  }
+
+  #pragma omp simd
+  for (int i = 0; i < count; i++)
+  {
+    double inv = 1.0 / sqrt(batch->dx[i] * batch->dx[i] + batch->dy[i] * batch->dy[i] + batch->dz[i] * batch->dz[i]);
+
+    batch->dx[i] *= inv;
+    batch->dy[i] *= inv;
+    batch->dz[i] *= inv;
+  }
 }
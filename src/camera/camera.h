@@ -17,9 +17,13 @@
 #include "../util/vector.h"
 #include "../util/ray.h"
 #include "../util/film.h"
+#include "../util/sampler.h"
+
+#define RAY_BATCH_SIZE 64
 
 //------------------------------------------------------------------------------
-//  Declaration of the CameraData type (a camera)
+//  Declaration of the CameraData type (a camera). The basis vectors of the 
+//  image plane and the lens are computed in initialiseCamera.
 //------------------------------------------------------------------------------
 
 
@@ -29,12 +33,32 @@ typedef struct
   double     fov;
   int        samples_per_pixel;
   int        strat;
+  int        sampler;
   double     aperture;
   double     focal_length;
   double     u,v;
   double     y0,z0,dx;
+  Vec3       pixel00,pixelDx,pixelDy;
+  Vec3       lensU,lensV;
+  int        width;
 } CameraData;
 
+
+//------------------------------------------------------------------------------
+//  Declaration of the RayBatch type (a row of camera rays, stored as a 
+//  structure of arrays for packet or stream tracing). All rays of a batch
+//  have the same type, mask (RAY_CAMERA).
+//------------------------------------------------------------------------------
+
+
+typedef struct 
+{
+  int        count;
+  int        mask;
+  double     ox[RAY_BATCH_SIZE],oy[RAY_BATCH_SIZE],oz[RAY_BATCH_SIZE];
+  double     dx[RAY_BATCH_SIZE],dy[RAY_BATCH_SIZE],dz[RAY_BATCH_SIZE];
+} RayBatch;
+
 //------------------------------------------------------------------------------
 //  readCameraData: Reads the camera data from a file
 //
@@ -73,6 +97,10 @@ void initialiseCamera
 //      ray     : Pointer to the ray
 //      ix      : x-coordinate of the pixel
 //      iy      : y-coordinate of the pixel
+//      u       : x-position of the sample within the pixel
+//      v       : y-position of the sample within the pixel
+//      lu      : first coordinate of the lens sample in [0,1)
+//      lv      : second coordinate of the lens sample in [0,1)
 //      cam     : Pointer to the camera
 //
 //------------------------------------------------------------------------------
@@ -85,8 +113,37 @@ void generateCameraRay
     int           iy  ,
     double        u   ,
     double        v   ,
+    double        lu  ,
+    double        lv  ,
     CameraData*   cam );
 
+
+
+//------------------------------------------------------------------------------
+//  generateCameraRayRow: Generates the rays of count consecutive pixels of 
+//                        row iy, for the current sample index of the sampler.
+//                        The sampler itself is left unchanged.
+//
+//  Arguments:
+//      batch   : Pointer to the batch of rays (return argument)
+//      ix0     : x-coordinate of the first pixel
+//      iy      : y-coordinate of the pixels
+//      count   : number of pixels (at most RAY_BATCH_SIZE)
+//      sampler : Pointer to the sampler
+//      cam     : Pointer to the camera
+//
+//------------------------------------------------------------------------------
+
+
+void generateCameraRayRow
+
+  ( RayBatch*     batch   ,
+    int           ix0     ,
+    int           iy      ,
+    int           count   ,
+    Sampler*      sampler ,
+    CameraData*   cam     );
+
 #endif
 
 
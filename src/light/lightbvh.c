@@ -0,0 +1,392 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "lightbvh.h"
+
+#define HALF_PI 1.57079632679489661923
+
+#define LIGHT_STACK_SIZE 64
+
+
+//------------------------------------------------------------------------------
+//  Sort key of a spotlight during the construction of the tree
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  double key;
+  int    light;
+} LightKey;
+
+
+static int compareLightKeys
+
+  ( const void* a ,
+    const void* b )
+
+{
+  double ka = ((const LightKey*)a)->key;
+  double kb = ((const LightKey*)b)->key;
+
+  return ( ka > kb ) - ( ka < kb );
+}
+
+
+//------------------------------------------------------------------------------
+//  mergeCones: Computes the cone that bounds two cones of (two-sided) axes
+//------------------------------------------------------------------------------
+
+
+static void mergeCones
+
+  ( Vec3*   axis  ,
+    double* theta ,
+    Vec3    axisB ,
+    double  thetaB )
+
+{
+  double cosD = dotProduct( axis , &axisB );
+
+  if ( cosD < 0.0 )
+  {
+    axisB = multiplyVector( -1.0 , &axisB );
+    cosD  = -cosD;
+  }
+
+  double thetaD = acos( fmin( cosD , 1.0 ) );
+
+  if ( *theta >= thetaD + thetaB )
+  {
+    return;
+  }
+
+  if ( thetaB >= thetaD + *theta )
+  {
+    *axis  = axisB;
+    *theta = thetaB;
+    return;
+  }
+
+  double newTheta = 0.5 * ( *theta + thetaD + thetaB );
+
+  if ( newTheta >= HALF_PI )
+  {
+    *theta = HALF_PI;
+    return;
+  }
+
+  // rotate the axis towards axisB
+
+  double rot = newTheta - *theta;
+
+  if ( thetaD > 1.0e-9 )
+  {
+    Vec3 a = multiplyVector( sin( thetaD - rot ) / sin( thetaD ) , axis );
+    Vec3 b = multiplyVector( sin( rot ) / sin( thetaD ) , &axisB );
+
+    *axis = addVector( 1.0 , &a , 1.0 , &b );
+    unit( axis );
+  }
+
+  *theta = newTheta;
+}
+
+
+//------------------------------------------------------------------------------
+//  buildLightNode: Builds the subtree of the spotlights keys[start..end)
+//------------------------------------------------------------------------------
+
+
+static int buildLightNode
+
+  ( LightBVH*   lbvh       ,
+    Spotlights* spotlights ,
+    LightKey*   keys       ,
+    int         start      ,
+    int         end        )
+
+{
+  int nodeIndex = lbvh->nodeCount++;
+  LightNode *node = &lbvh->nodes[nodeIndex];
+
+  if ( end - start == 1 )
+  {
+    Spotlight *light = &spotlights->spotlight[keys[start].light];
+    double     h     = 0.5 * spotlights->radius;
+    Vec3       size  = { h , h , h };
+
+    node->min    = addVector( 1.0 , &light->coord , -1.0 , &size );
+    node->max    = addVector( 1.0 , &light->coord ,  1.0 , &size );
+    node->axis   = light->dir;
+    node->theta  = 0.0;
+    node->cutoff = acos( light->cosCutoff );
+    node->power  = light->intensity;
+    node->left   = -1;
+    node->right  = -1;
+    node->light  = keys[start].light;
+
+    return nodeIndex;
+  }
+
+  // split at the median of the positions along the largest extent
+
+  Vec3 pmin = spotlights->spotlight[keys[start].light].coord;
+  Vec3 pmax = pmin;
+
+  for ( int i = start + 1 ; i < end ; i++ )
+  {
+    pmin = minVector( 1.0 , &pmin , 1.0 , &spotlights->spotlight[keys[i].light].coord );
+    pmax = maxVector( 1.0 , &pmax , 1.0 , &spotlights->spotlight[keys[i].light].coord );
+  }
+
+  Vec3 extent = addVector( 1.0 , &pmax , -1.0 , &pmin );
+  int  axis   = maxDimension( &extent );
+
+  for ( int i = start ; i < end ; i++ )
+  {
+    keys[i].key = (&spotlights->spotlight[keys[i].light].coord.x)[axis];
+  }
+
+  qsort( keys + start , end - start , sizeof(LightKey) , compareLightKeys );
+
+  int mid   = ( start + end ) / 2;
+  int left  = buildLightNode( lbvh , spotlights , keys , start , mid );
+  int right = buildLightNode( lbvh , spotlights , keys , mid   , end );
+
+  LightNode *l = &lbvh->nodes[left];
+  LightNode *r = &lbvh->nodes[right];
+
+  node->min    = minVector( 1.0 , &l->min , 1.0 , &r->min );
+  node->max    = maxVector( 1.0 , &l->max , 1.0 , &r->max );
+  node->axis   = l->axis;
+  node->theta  = l->theta;
+  node->cutoff = fmax( l->cutoff , r->cutoff );
+  node->power  = l->power + r->power;
+  node->left   = left;
+  node->right  = right;
+  node->light  = -1;
+
+  mergeCones( &node->axis , &node->theta , r->axis , r->theta );
+
+  return nodeIndex;
+}
+
+
+//------------------------------------------------------------------------------
+//  createLightBVH: Builds the light BVH of the spotlights
+//------------------------------------------------------------------------------
+
+
+LightBVH* createLightBVH
+
+  ( Spotlights*  spotlights )
+
+{
+  int n = spotlights->count;
+
+  if ( n == 0 )
+  {
+    return NULL;
+  }
+
+  LightBVH *lbvh = (LightBVH*)malloc( sizeof(LightBVH) );
+  LightKey *keys = (LightKey*)malloc( n * sizeof(LightKey) );
+
+  lbvh->nodes     = (LightNode*)malloc( ( 2 * n - 1 ) * sizeof(LightNode) );
+  lbvh->nodeCount = 0;
+
+  for ( int i = 0 ; i < n ; i++ )
+  {
+    keys[i].key   = 0.0;
+    keys[i].light = i;
+  }
+
+  buildLightNode( lbvh , spotlights , keys , 0 , n );
+
+  free( keys );
+
+  return lbvh;
+}
+
+
+//------------------------------------------------------------------------------
+//  freeLightBVH: Frees the light BVH
+//------------------------------------------------------------------------------
+
+
+void freeLightBVH
+
+  ( LightBVH*    lbvh )
+
+{
+  if ( lbvh != NULL )
+  {
+    free( lbvh->nodes );
+    free( lbvh );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  lightImportance: Returns an upper bound of the light of a node at a point
+//------------------------------------------------------------------------------
+
+
+double lightImportance
+
+  ( LightNode*   node   ,
+    Vec3*        point  ,
+    Vec3*        normal )
+
+{
+  // bounding sphere of the node
+
+  Vec3 centre = addVector( 0.5 , &node->min , 0.5 , &node->max );
+  Vec3 half   = addVector( 0.5 , &node->max , -0.5 , &node->min );
+  Vec3 w      = addVector( 1.0 , point , -1.0 , &centre );
+
+  double radius = length( &half );
+  double dist   = length( &w );
+
+  if ( dist <= radius )
+  {
+    return node->power;
+  }
+
+  w = multiplyVector( 1.0 / dist , &w );
+
+  double thetaW = asin( radius / dist );
+
+  // the point must lie inside the cone of at least one spotlight
+
+  if ( node->theta < HALF_PI )
+  {
+    double thetaA = acos( fmin( fabs( dotProduct( &node->axis , &w ) ) , 1.0 ) );
+
+    if ( thetaA - node->theta - thetaW > node->cutoff )
+    {
+      return 0.0;
+    }
+  }
+
+  // the lights must be in front of the surface
+
+  double thetaN = acos( fmax( fmin( -dotProduct( normal , &w ) , 1.0 ) , -1.0 ) );
+
+  thetaN = fmax( thetaN - thetaW , 0.0 );
+
+  if ( thetaN >= HALF_PI )
+  {
+    return 0.0;
+  }
+
+  return node->power * cos( thetaN );
+}
+
+
+//------------------------------------------------------------------------------
+//  collectLights: Finds the spotlights that can reach a point
+//------------------------------------------------------------------------------
+
+
+int collectLights
+
+  ( LightBVH*    lbvh   ,
+    Vec3*        point  ,
+    Vec3*        normal ,
+    int*         lights )
+
+{
+  int stack[LIGHT_STACK_SIZE];
+  int stackSize = 0;
+  int count     = 0;
+
+  stack[stackSize++] = 0;
+
+  while ( stackSize > 0 )
+  {
+    LightNode *node = &lbvh->nodes[stack[--stackSize]];
+
+    if ( lightImportance( node , point , normal ) <= 0.0 )
+    {
+      continue;
+    }
+
+    if ( node->left < 0 )
+    {
+      lights[count++] = node->light;
+    }
+    else
+    {
+      stack[stackSize++] = node->right;
+      stack[stackSize++] = node->left;
+    }
+  }
+
+  return count;
+}
+
+
+//------------------------------------------------------------------------------
+//  sampleLight: Selects a spotlight by descending the light BVH
+//------------------------------------------------------------------------------
+
+
+int sampleLight
+
+  ( LightBVH*    lbvh   ,
+    Vec3*        point  ,
+    Vec3*        normal ,
+    double       u      ,
+    double*      pdf    )
+
+{
+  LightNode *node = &lbvh->nodes[0];
+
+  *pdf = 1.0;
+
+  if ( lightImportance( node , point , normal ) <= 0.0 )
+  {
+    return -1;
+  }
+
+  while ( node->left >= 0 )
+  {
+    double il = lightImportance( &lbvh->nodes[node->left]  , point , normal );
+    double ir = lightImportance( &lbvh->nodes[node->right] , point , normal );
+
+    if ( il + ir <= 0.0 )
+    {
+      return -1;
+    }
+
+    double p = il / ( il + ir );
+
+    if ( u < p )
+    {
+      u     = u / p;
+      *pdf *= p;
+      node  = &lbvh->nodes[node->left];
+    }
+    else
+    {
+      u     = ( u - p ) / ( 1.0 - p );
+      *pdf *= 1.0 - p;
+      node  = &lbvh->nodes[node->right];
+    }
+  }
+
+  return node->light;
+}
@@ -0,0 +1,154 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef LIGHT_LIGHTBVH_H
+#define LIGHT_LIGHTBVH_H
+
+#include "spotlight.h"
+#include "../util/vector.h"
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the LightNode type (a node in the light BVH)
+//      min,max : bounds of the light positions (including the light size)
+//      axis    : axis of the cone that bounds the spotlight directions. A 
+//                spotlight shines in both directions of its axis.
+//      theta   : half angle of the cone of axes
+//      cutoff  : largest cutoff angle of the spotlights in the node
+//      power   : total intensity of the spotlights in the node
+//      left    : index of the left child, -1 for a leaf
+//      right   : index of the right child
+//      light   : index of the spotlight (leaves only)
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  Vec3       min,max;
+  Vec3       axis;
+  double     theta;
+  double     cutoff;
+  double     power;
+  int        left,right;
+  int        light;
+} LightNode;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the LightBVH type (a bounding hierarchy of spotlights)
+//------------------------------------------------------------------------------
+
+
+typedef struct LightBVH
+{
+  LightNode  *nodes;
+  int        nodeCount;
+} LightBVH;
+
+
+//------------------------------------------------------------------------------
+//  createLightBVH: Builds the light BVH of the spotlights
+//
+//  Arguments:
+//      spotlights : Pointer to the spotlights
+//
+//  Return:
+//      LightBVH*  : the light BVH, NULL if there are no spotlights
+//------------------------------------------------------------------------------
+
+
+LightBVH* createLightBVH
+
+  ( Spotlights*  spotlights );
+
+
+//------------------------------------------------------------------------------
+//  freeLightBVH: Frees the light BVH
+//
+//  Arguments:
+//      lbvh    : Pointer to the light BVH (may be NULL)
+//------------------------------------------------------------------------------
+
+
+void freeLightBVH
+
+  ( LightBVH*    lbvh );
+
+
+//------------------------------------------------------------------------------
+//  lightImportance: Returns an upper bound of the light that the spotlights
+//                   in a node can send to a point
+//
+//  Arguments:
+//      node    : Pointer to the node
+//      point   : The point on the surface
+//      normal  : The surface normal at the point
+//
+//  Return:
+//      double  : the bound, 0 if none of the spotlights can reach the point
+//------------------------------------------------------------------------------
+
+
+double lightImportance
+
+  ( LightNode*   node   ,
+    Vec3*        point  ,
+    Vec3*        normal );
+
+
+//------------------------------------------------------------------------------
+//  collectLights: Finds the spotlights that can reach a point
+//
+//  Arguments:
+//      lbvh    : Pointer to the light BVH
+//      point   : The point on the surface
+//      normal  : The surface normal at the point
+//      lights  : Array of spotlight indices (return argument)
+//
+//  Return:
+//      int     : the number of spotlights in lights
+//------------------------------------------------------------------------------
+
+
+int collectLights
+
+  ( LightBVH*    lbvh   ,
+    Vec3*        point  ,
+    Vec3*        normal ,
+    int*         lights );
+
+
+//------------------------------------------------------------------------------
+//  sampleLight: Selects a spotlight with a probability proportional to the
+//               importance of the nodes, by descending the light BVH
+//
+//  Arguments:
+//      lbvh    : Pointer to the light BVH
+//      point   : The point on the surface
+//      normal  : The surface normal at the point
+//      u       : Random number in [0,1)
+//      pdf     : Probability of the selected light (return argument)
+//
+//  Return:
+//      int     : the index of the spotlight, -1 if no light can reach the 
+//                point
+//------------------------------------------------------------------------------
+
+
+int sampleLight
+
+  ( LightBVH*    lbvh   ,
+    Vec3*        point  ,
+    Vec3*        normal ,
+    double       u      ,
+    double*      pdf    );
+
+#endif
@@ -0,0 +1,266 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+#include <omp.h>
+#include "radiancecache.h"
+#include "../util/random.h"
+#include "../util/counter.h"
+
+#define FIXED_POINT  4096.0
+#define MAX_LIGHT    8.0
+
+
+//------------------------------------------------------------------------------
+//  Lookup counters, one cache line per thread
+//------------------------------------------------------------------------------
+
+
+#define COUNTER_HITS   0
+#define COUNTER_MISSES 1
+
+static ThreadCounters cacheCounters;
+
+
+//------------------------------------------------------------------------------
+//  cacheCell: Grid cell of a coordinate. The cell is clamped to the range of
+//             an int, as converting a larger value is undefined.
+//------------------------------------------------------------------------------
+
+
+static unsigned int cacheCell
+
+  ( double         x   )
+
+{
+  double cell = fmin( fmax( floor( x ) , (double)INT_MIN ) , (double)INT_MAX );
+
+  return (unsigned int)(int)cell;
+}
+
+
+//------------------------------------------------------------------------------
+//  cacheKey: Hash of the grid cell of a point and the bin of its normal
+//------------------------------------------------------------------------------
+
+
+static uint64_t cacheKey
+
+  ( RadianceCache* cache  ,
+    Vec3*          point  ,
+    Vec3*          normal )
+
+{
+  double inv = 1.0 / cache->cellSize;
+
+  unsigned int ix = cacheCell( point->x * inv );
+  unsigned int iy = cacheCell( point->y * inv );
+  unsigned int iz = cacheCell( point->z * inv );
+
+  unsigned int nx = (unsigned int)lround( 4.0 * normal->x + 4.0 );
+  unsigned int ny = (unsigned int)lround( 4.0 * normal->y + 4.0 );
+  unsigned int nz = (unsigned int)lround( 4.0 * normal->z + 4.0 );
+
+  unsigned int n  = ( nx * 9 + ny ) * 9 + nz;
+
+  uint64_t h1 = pcgHash( ix ^ pcgHash( iy ^ pcgHash( iz ^ pcgHash( n ) ) ) );
+  uint64_t h2 = pcgHash( iz ^ pcgHash( n ^ pcgHash( ix ^ pcgHash( iy + 0x9e3779b9u ) ) ) );
+
+  return ( ( h1 << 32 ) | h2 ) | 1;
+}
+
+
+//------------------------------------------------------------------------------
+//  findEntry: Finds the entry of a key. A new entry is claimed if create is 
+//             set and the key is not found.
+//------------------------------------------------------------------------------
+
+
+static RadianceCacheEntry* findEntry
+
+  ( RadianceCache* cache  ,
+    uint64_t       key    ,
+    int            create )
+
+{
+  for ( int p = 0 ; p < RADIANCE_CACHE_PROBES ; p++ )
+  {
+    RadianceCacheEntry *entry = &cache->entries[( key + p ) & ( RADIANCE_CACHE_SIZE - 1 )];
+
+    uint64_t current = __atomic_load_n( &entry->key , __ATOMIC_ACQUIRE );
+
+    if ( current == key )
+    {
+      return entry;
+    }
+
+    if ( current == 0 )
+    {
+      if ( !create )
+      {
+        return NULL;
+      }
+
+      uint64_t expected = 0;
+
+      if ( __atomic_compare_exchange_n( &entry->key , &expected , key , 0 ,
+                                        __ATOMIC_ACQ_REL , __ATOMIC_ACQUIRE ) || expected == key )
+      {
+        return entry;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+//  createRadianceCache: Creates an empty radiance cache
+//------------------------------------------------------------------------------
+
+
+RadianceCache* createRadianceCache
+
+  ( double         cellSize ,
+    double         maxError )
+
+{
+  RadianceCache *cache = (RadianceCache*)calloc( 1 , sizeof(RadianceCache) );
+
+  cache->cellSize = cellSize;
+  cache->maxError = maxError;
+  cache->entries  = (RadianceCacheEntry*)calloc( RADIANCE_CACHE_SIZE , sizeof(RadianceCacheEntry) );
+
+  resetThreadCounters( &cacheCounters );
+
+  return cache;
+}
+
+
+//------------------------------------------------------------------------------
+//  freeRadianceCache: Frees the radiance cache
+//------------------------------------------------------------------------------
+
+
+void freeRadianceCache
+
+  ( RadianceCache* cache )
+
+{
+  if ( cache != NULL )
+  {
+    free( cache->entries );
+    free( cache );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  lookupRadianceCache: Returns the cached light at a point
+//------------------------------------------------------------------------------
+
+
+int lookupRadianceCache
+
+  ( RadianceCache* cache  ,
+    Vec3*          point  ,
+    Vec3*          normal ,
+    double*        light  )
+
+{
+  long *counter = getThreadCounter( &cacheCounters );
+
+  RadianceCacheEntry *entry = findEntry( cache , cacheKey( cache , point , normal ) , 0 );
+
+  if ( entry != NULL )
+  {
+    uint64_t value = __atomic_load_n( &entry->value , __ATOMIC_RELAXED );
+
+    double count = (double)( value & 0xff );
+
+    if ( count >= RADIANCE_CACHE_MIN )
+    {
+      double mean = ( ( value >> 8 ) & 0xffffff ) / FIXED_POINT / count;
+      double sq   = ( value >> 32 ) / FIXED_POINT / count;
+      double var  = fmax( sq - mean * mean , 0.0 );
+
+      if ( var <= cache->maxError * cache->maxError )
+      {
+        *light = mean;
+        counter[COUNTER_HITS]++;
+        return 1;
+      }
+    }
+  }
+
+  counter[COUNTER_MISSES]++;
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+//  addRadianceCache: Adds a computed light value to the cache
+//------------------------------------------------------------------------------
+
+
+void addRadianceCache
+
+  ( RadianceCache* cache  ,
+    Vec3*          point  ,
+    Vec3*          normal ,
+    double         light  )
+
+{
+  RadianceCacheEntry *entry = findEntry( cache , cacheKey( cache , point , normal ) , 1 );
+
+  if ( entry == NULL )
+  {
+    return;
+  }
+
+  light = fmin( fmax( light , 0.0 ) , MAX_LIGHT );
+
+  uint64_t sum = (uint64_t)( light * FIXED_POINT + 0.5 );
+  uint64_t sq  = (uint64_t)( light * light * FIXED_POINT + 0.5 );
+  uint64_t add = ( sq << 32 ) | ( sum << 8 ) | 1;
+
+  uint64_t value = __atomic_load_n( &entry->value , __ATOMIC_RELAXED );
+
+  do
+  {
+    if ( ( value & 0xff ) >= RADIANCE_CACHE_MAX )
+    {
+      return;
+    }
+  }
+  while ( !__atomic_compare_exchange_n( &entry->value , &value , value + add , 1 ,
+                                        __ATOMIC_RELAXED , __ATOMIC_RELAXED ) );
+}
+
+
+//------------------------------------------------------------------------------
+//  getRadianceCacheCounters: Returns the number of hits and misses
+//------------------------------------------------------------------------------
+
+
+void getRadianceCacheCounters
+
+  ( long*          hits   ,
+    long*          misses )
+
+{
+  *hits   = sumThreadCounters( &cacheCounters , COUNTER_HITS   );
+  *misses = sumThreadCounters( &cacheCounters , COUNTER_MISSES );
+}
@@ -0,0 +1,145 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef LIGHT_RADIANCECACHE_H
+#define LIGHT_RADIANCECACHE_H
+
+#include <stdint.h>
+#include "../util/vector.h"
+
+#define RADIANCE_CACHE_SIZE     (1 << 20)   // number of entries (power of 2)
+#define RADIANCE_CACHE_PROBES   8           // linear probing length
+#define RADIANCE_CACHE_MIN      4           // samples before an entry is used
+#define RADIANCE_CACHE_MAX      64          // samples after which an entry is frozen
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the RadianceCacheEntry type. The key is a hash of the grid
+//  cell and the normal bin (0 = empty). The value packs the number of samples
+//  (bits 0-7), the sum of the light (bits 8-31) and the sum of the squared
+//  light (bits 32-63), both in fixed point with 12 fraction bits, so that an
+//  entry is updated with a single 64 bit compare-and-swap.
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  uint64_t   key;
+  uint64_t   value;
+} RadianceCacheEntry;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the RadianceCache type (a hashed grid of lighting values)
+//      cellSize : size of the grid cells
+//      maxError : largest standard deviation of the light in a cell for which
+//                 the cache is used
+//      entries  : hash table
+//------------------------------------------------------------------------------
+
+
+typedef struct RadianceCache
+{
+  double              cellSize;
+  double              maxError;
+  RadianceCacheEntry  *entries;
+} RadianceCache;
+
+
+//------------------------------------------------------------------------------
+//  createRadianceCache: Creates an empty radiance cache
+//
+//  Arguments:
+//      cellSize : size of the grid cells
+//      maxError : largest standard deviation of the light in a used cell
+//
+//  Return:
+//      RadianceCache* : the cache
+//------------------------------------------------------------------------------
+
+
+RadianceCache* createRadianceCache
+
+  ( double         cellSize ,
+    double         maxError );
+
+
+//------------------------------------------------------------------------------
+//  freeRadianceCache: Frees the radiance cache
+//
+//  Arguments:
+//      cache    : Pointer to the cache (may be NULL)
+//------------------------------------------------------------------------------
+
+
+void freeRadianceCache
+
+  ( RadianceCache* cache );
+
+
+//------------------------------------------------------------------------------
+//  lookupRadianceCache: Returns the cached light at a point
+//
+//  Arguments:
+//      cache    : Pointer to the cache
+//      point    : The point on the surface
+//      normal   : The surface normal at the point
+//      light    : The average light in the cell (return argument)
+//
+//  Return:
+//      int      : 1 if the cell has enough samples with a small spread, 
+//                 0 otherwise
+//------------------------------------------------------------------------------
+
+
+int lookupRadianceCache
+
+  ( RadianceCache* cache  ,
+    Vec3*          point  ,
+    Vec3*          normal ,
+    double*        light  );
+
+
+//------------------------------------------------------------------------------
+//  addRadianceCache: Adds a computed light value to the cache
+//
+//  Arguments:
+//      cache    : Pointer to the cache
+//      point    : The point on the surface
+//      normal   : The surface normal at the point
+//      light    : The light at the point
+//------------------------------------------------------------------------------
+
+
+void addRadianceCache
+
+  ( RadianceCache* cache  ,
+    Vec3*          point  ,
+    Vec3*          normal ,
+    double         light  );
+
+
+//------------------------------------------------------------------------------
+//  getRadianceCacheCounters: Returns the number of lookups that used the
+//                            cache and the number that computed the light
+//
+//  Arguments:
+//      hits     : number of lookups that used the cache (return argument)
+//      misses   : number of lookups that did not (return argument)
+//------------------------------------------------------------------------------
+
+
+void getRadianceCacheCounters
+
+  ( long*          hits   ,
+    long*          misses );
+
+#endif
@@ -1,6 +1,10 @@
 #include "shadow.h"
 #include <math.h>
 #include <stdlib.h>
+#include <omp.h>
+#include "lightbvh.h"
+#include "sunmap.h"
+#include "../util/counter.h"
 
 
 //------------------------------------------------------------------------------
@@ -9,45 +13,120 @@
 
 void createShadowRay(Globdat *globdat, BVH *bvh, Ray *shadowRay, Vec3 *point, Vec3 *lightDir, Vec3 *normal)
 {
-    unit(lightDir);
+    // The direction of the sun is scaled by its intensity, so it is copied
+    // before it is normalised
+
+    Vec3 d = *lightDir;
+
+    unit(&d);
 
     Vec3 bias = multiplyVector(0.001, normal);
     Vec3 shadowOrigin = addVector(1.0, point, 1.0, &bias);
 
     shadowRay->o = shadowOrigin;
-    shadowRay->d = *lightDir;
+    shadowRay->d = d;
+    shadowRay->mask = RAY_SHADOW;
 }
 
 //------------------------------------------------------------------------------
-//  createRandomOffsets: Create random offsets for shadow sampling
+//  createShadowOffsets: Create the stratified base pattern for shadow sampling
 //------------------------------------------------------------------------------
 
 
-void createRandomOffsets(Vec3 *offsets)
+void createShadowOffsets(Vec3 *offsets, int samples)
 {
-    for (int i = 0; i < SHADOW_SAMPLES; i++)
+    for (int i = 0; i < samples; i++)
     {
-        offsets[i].x = SHADOW_RADIUS * ((double)rand() / RAND_MAX - 0.5);
-        offsets[i].y = SHADOW_RADIUS * ((double)rand() / RAND_MAX - 0.5);
-        offsets[i].z = SHADOW_RADIUS * ((double)rand() / RAND_MAX - 0.5);
+        double y = 0.0, z = 0.0;
+        double fy = 0.5, fz = 1.0 / 3.0;
+
+        // radical inverse of i in base 2 and base 3
+
+        for (int k = i; k > 0; k /= 2, fy *= 0.5)
+        {
+            y += (k % 2) * fy;
+        }
+
+        for (int k = i; k > 0; k /= 3, fz /= 3.0)
+        {
+            z += (k % 3) * fz;
+        }
+
+        offsets[i].x = (i + 0.5) / samples;
+        offsets[i].y = y;
+        offsets[i].z = z;
     }
 }
 
 //------------------------------------------------------------------------------
-//  computeSoftShadow: Computes the soft shadow contribution from a spotlight
+//  Shadow ray counters, one cache line per thread
 //------------------------------------------------------------------------------
 
-double computeSoftShadow(
+
+#define COUNTER_CAST  0
+#define COUNTER_SAVED 1
+
+static ThreadCounters shadowCounters;
+
+
+//------------------------------------------------------------------------------
+//  resetShadowCounters: Sets the shadow ray counters to zero
+//------------------------------------------------------------------------------
+
+
+void resetShadowCounters(void)
+{
+    resetThreadCounters(&shadowCounters);
+}
+
+
+//------------------------------------------------------------------------------
+//  getShadowCounters: Returns the total number of shadow rays cast and saved
+//------------------------------------------------------------------------------
+
+
+void getShadowCounters(long *cast, long *saved)
+{
+    *cast = sumThreadCounters(&shadowCounters, COUNTER_CAST);
+    *saved = sumThreadCounters(&shadowCounters, COUNTER_SAVED);
+}
+
+
+//------------------------------------------------------------------------------
+//  isLightVisible: Traces a shadow ray from a point towards a light position
+//------------------------------------------------------------------------------
+
+
+int isLightVisible(Globdat *globdat, BVH *bvh, Vec3 *hitPoint, Vec3 *normal, Vec3 *lightPos)
+{
+    Ray shadowRay;
+    Intersect shadowHit;
+
+    Vec3 lightDir = addVector(1.0, lightPos, -1.0, hitPoint);
+
+    resetIntersect(&shadowHit);
+
+    createShadowRay(globdat, bvh, &shadowRay, hitPoint, &lightDir, normal);
+    traverseBVH(bvh, globdat, &shadowRay, &shadowHit);
+
+    return shadowHit.matID == -1;
+}
+
+
+//------------------------------------------------------------------------------
+//  computeUnshadowedLight: Computes the light of a spotlight without shadows
+//------------------------------------------------------------------------------
+
+double computeUnshadowedLight(
     Globdat *globdat,
-    BVH *bvh,
     Vec3 *offsets,
+    Sampler *sampler,
     Vec3 *hitPoint,
     Vec3 *normal,
-    Intersect *intersection,
-    int lightIndex)
+    int lightIndex,
+    Vec3 *positions,
+    double *contributions)
 {
-   
-
     Spotlight *spotlight = &globdat->spotlights.spotlight[lightIndex];
 
     Vec3 hitToSpotlight = addVector(1.0, &spotlight->coord, -1.0, hitPoint);
@@ -63,29 +142,247 @@ double computeSoftShadow(
 
     double falloff = fmax(fmin((angleCos - spotlight->cosCutoff) / spotlight->sharpness, 0.0), 1.0);
 
-    double sampleLight = 0.0;
-    Ray shadowRay;
-    Intersect shadowHit;
+    int samples = globdat->spotlights.samples;
+    double radius = globdat->spotlights.radius;
+    double scale = falloff * spotlight->intensity / samples;
+
+    // random rotation of the base pattern for this pixel sample and light
+
+    double rx, ry, rz, unused;
+
+    getSample2D(sampler, SAMPLER_DIM_LIGHT + 2 * lightIndex, &rx, &ry);
+    getSample2D(sampler, SAMPLER_DIM_LIGHT + 2 * lightIndex + 1, &rz, &unused);
 
-    for (int s = 0; s < SHADOW_SAMPLES; s++)
+    double total = 0.0;
+
+    for (int s = 0; s < samples; s++)
     {
-        Vec3 jitteredLightPos = addVector(1.0, &spotlight->coord, 1.0, &offsets[s]);
-        Vec3 lightDir = addVector(1.0, &jitteredLightPos, -1.0, hitPoint);
+        Vec3 offset;
+
+        offset.x = radius * (fmod(offsets[s].x + rx, 1.0) - 0.5);
+        offset.y = radius * (fmod(offsets[s].y + ry, 1.0) - 0.5);
+        offset.z = radius * (fmod(offsets[s].z + rz, 1.0) - 0.5);
+
+        positions[s] = addVector(1.0, &spotlight->coord, 1.0, &offset);
+
+        Vec3 lightDir = addVector(1.0, &positions[s], -1.0, hitPoint);
         unit(&lightDir);
 
-        resetIntersect(&shadowHit);
+        contributions[s] = fmax(dotProduct(&lightDir, normal), 0.0) * scale;
+        total += contributions[s];
+    }
+
+    return total;
+}
+
 
-        createShadowRay(globdat, bvh, &shadowRay, hitPoint, &lightDir, normal);
-        traverseBVH(bvh, globdat, &shadowRay, &shadowHit);
+//------------------------------------------------------------------------------
+//  computeSoftShadow: Computes the soft shadow contribution from a spotlight
+//------------------------------------------------------------------------------
 
-        if (shadowHit.matID == -1)
+double computeSoftShadow(
+    Globdat *globdat,
+    BVH *bvh,
+    Vec3 *offsets,
+    Sampler *sampler,
+    Vec3 *hitPoint,
+    Vec3 *normal,
+    Intersect *intersection,
+    int lightIndex)
+{
+    Spotlight *spotlight = &globdat->spotlights.spotlight[lightIndex];
+
+    int samples = globdat->spotlights.samples;
+    double radius = globdat->spotlights.radius;
+
+    Vec3 positions[samples];
+    double contributions[samples];
+
+    double unshadowed = computeUnshadowedLight(globdat, offsets, sampler, hitPoint, normal, lightIndex, positions, contributions);
+
+    if (unshadowed <= 0.0)
+    {
+        return 0.0;
+    }
+
+    // Adaptive sampling: the corners of a tetrahedron spanning the light are
+    // probed first. If they agree, the point is fully lit or fully in the 
+    // shadow and only the cosine factors of the samples are evaluated.
+
+    long *counter = getThreadCounter(&shadowCounters);
+
+    if (globdat->settings.adaptiveShadows && samples > SHADOW_PROBES)
+    {
+        const double corners[SHADOW_PROBES][3] = {{ 1,  1,  1}, { 1, -1, -1},
+                                                  {-1,  1, -1}, {-1, -1,  1}};
+        int visible = 0;
+
+        for (int p = 0; p < SHADOW_PROBES; p++)
+        {
+            Vec3 probe = {0.5 * radius * corners[p][0], 0.5 * radius * corners[p][1], 0.5 * radius * corners[p][2]};
+            Vec3 probePos = addVector(1.0, &spotlight->coord, 1.0, &probe);
+
+            visible += isLightVisible(globdat, bvh, hitPoint, normal, &probePos);
+        }
+
+        counter[COUNTER_CAST] += SHADOW_PROBES;
+
+        if (visible == 0 || visible == SHADOW_PROBES)
+        {
+            counter[COUNTER_SAVED] += samples - SHADOW_PROBES;
+
+            return (visible > 0) ? unshadowed : 0.0;
+        }
+    }
+
+    double sampleLight = 0.0;
+
+    for (int s = 0; s < samples; s++)
+    {
+        if (contributions[s] > 0.0 && isLightVisible(globdat, bvh, hitPoint, normal, &positions[s]))
+        {
+            sampleLight += contributions[s];
+        }
+    }
+
+    counter[COUNTER_CAST] += samples;
+
+    return sampleLight;
+}
+
+
+//------------------------------------------------------------------------------
+//  computeStochasticLight: Estimates the light of the sun and the spotlights
+//                          with a few randomly selected shadow rays
+//------------------------------------------------------------------------------
+
+double computeStochasticLight(
+    Globdat *globdat,
+    BVH *bvh,
+    Vec3 *offsets,
+    Sampler *sampler,
+    Vec3 *hitPoint,
+    Vec3 *normal,
+    int candidates,
+    double *sunLight,
+    double *spotLight)
+{
+    int samples = globdat->spotlights.samples;
+    int nLights = 0;
+
+    int lights[globdat->spotlights.count + 1];
+    double weights[globdat->spotlights.count + 1];
+    Vec3 positions[samples];
+    double contributions[samples];
+
+    if (globdat->lightBVH != NULL)
+    {
+        nLights = collectLights(globdat->lightBVH, hitPoint, normal, lights);
+    }
+
+    // Unshadowed contribution of the sun (candidate 0) and of the spotlights
+
+    weights[0] = fmax(dotProduct(&globdat->sun.d, normal), 0.0);
+
+    double total = weights[0];
+
+    for (int i = 0; i < nLights; i++)
+    {
+        weights[i + 1] = computeUnshadowedLight(globdat, offsets, sampler, hitPoint, normal, lights[i], positions, contributions);
+        total += weights[i + 1];
+    }
+
+    if (total <= 0.0)
+    {
+        return 0.0;
+    }
+
+    // Each candidate is selected with probability f/total, where f is its 
+    // unshadowed contribution. The estimate f/p * visibility of a candidate 
+    // is therefore total * visibility.
+
+    double u, v;
+
+    getSample2D(sampler, SAMPLER_DIM_LIGHT_SELECT, &u, &v);
+
+    int visible = 0;
+
+    for (int k = 0; k < candidates; k++)
+    {
+        double uk = fmod(u + (double)k / candidates, 1.0) * total;
+        double vk = fmod(v + 0.6180339887498949 * k, 1.0);
+
+        int c = 0;
+        double sum = weights[0];
+
+        while (uk >= sum && c < nLights)
+        {
+            c++;
+            sum += weights[c];
+        }
+
+        int lookup = -1;
+        int seen = 0;
+
+        if (c == 0 && globdat->sunMap != NULL)
+        {
+            lookup = lookupSunMap(globdat->sunMap, hitPoint, normal);
+        }
+
+        if (c == 0 && lookup >= 0)
+        {
+            seen = lookup;
+        }
+        else if (c == 0)
+        {
+            Ray shadowRay;
+            Intersect shadowHit;
+
+            resetIntersect(&shadowHit);
+
+            createShadowRay(globdat, bvh, &shadowRay, hitPoint, &globdat->sun.d, normal);
+            traverseBVH(bvh, globdat, &shadowRay, &shadowHit);
+
+            seen = (shadowHit.matID == -1);
+        }
+        else
+        {
+            double w = computeUnshadowedLight(globdat, offsets, sampler, hitPoint, normal, lights[c - 1], positions, contributions);
+
+            if (w <= 0.0)
+            {
+                continue;
+            }
+
+            int s = 0;
+            double vs = vk * w;
+            double sumS = contributions[0];
+
+            while (vs >= sumS && s < samples - 1)
+            {
+                s++;
+                sumS += contributions[s];
+            }
+
+            seen = isLightVisible(globdat, bvh, hitPoint, normal, &positions[s]);
+        }
+
+        visible += seen;
+
+        // Every visible shadow ray adds total / candidates to the light of 
+        // its candidate
+
+        if (seen && c == 0 && sunLight != NULL)
+        {
+            *sunLight += total / candidates;
+        }
+        else if (seen && c > 0 && spotLight != NULL)
         {
-            double dot = fmax(dotProduct(&lightDir, normal), 0.0);
-            sampleLight += dot;
+            spotLight[lights[c - 1]] += total / candidates;
         }
     }
 
-    double result = (sampleLight / SHADOW_SAMPLES) * falloff * spotlight->intensity;
+    getThreadCounter(&shadowCounters)[COUNTER_CAST] += candidates;
 
-    return result;
+    return total * visible / candidates;
 }
@@ -5,10 +5,13 @@
 #include "../util/vector.h"
 #include "../util/ray.h"
 #include "../util/bvh.h"
+#include "../util/sampler.h"
 
-#define SHADOW_SAMPLES 5
+#define SHADOW_SAMPLES 5    // Default number of soft shadow samples
+#define SHADOW_MAX_SAMPLES 1024 // Samples are kept on the stack of the shadow functions
 #define SHADOW_JITTER 0.05
-#define SHADOW_RADIUS 0.05 // Jitter radius for soft shadow sampling
+#define SHADOW_RADIUS 0.05  // Default jitter radius for soft shadow sampling
+#define SHADOW_PROBES 4     // Probe rays of the adaptive soft shadows
 
 
 //------------------------------------------------------------------------------
@@ -33,18 +36,94 @@ void createShadowRay(Globdat* globdat, BVH* bvh, Ray *shadowRay, Vec3* point, Ve
 
 
 //------------------------------------------------------------------------------
-//  createRandomOffsets: Generates random jitter offsets for soft shadow rays.
+//  createShadowOffsets: Generates the stratified base pattern of the soft 
+//                       shadow rays.
 //
 //  Arguments:
-//      offsets     : Pointer to an array of Vec3s where random offsets will be stored
+//      offsets     : Pointer to an array of Vec3s where the offsets will be stored
+//      samples     : Number of offsets
 //
 //  Description:
-//      This function fills the offsets array with small randomized direction vectors,
-//      used to simulate area light soft shadows through multiple shadow ray sampling.
+//      This function fills the offsets array with a Hammersley point set in the
+//      unit cube. The set is stratified in each of the three directions. Every
+//      pixel sample shifts the set by its own random vector (Cranley-Patterson
+//      rotation), so neighbouring pixels do not share the same pattern.
 //------------------------------------------------------------------------------
 
 
-void createRandomOffsets(Vec3* offsets);
+void createShadowOffsets(Vec3* offsets, int samples);
+
+
+//------------------------------------------------------------------------------
+//  resetShadowCounters: Sets the counters of cast and saved shadow rays to zero
+//------------------------------------------------------------------------------
+
+
+void resetShadowCounters(void);
+
+
+//------------------------------------------------------------------------------
+//  getShadowCounters: Returns the number of soft shadow rays that were cast
+//                     and the number that was saved by the adaptive sampling
+//
+//  Arguments:
+//      cast        : Number of shadow rays cast (return argument)
+//      saved       : Number of shadow rays saved (return argument)
+//------------------------------------------------------------------------------
+
+
+void getShadowCounters(long *cast, long *saved);
+
+
+//------------------------------------------------------------------------------
+//  isLightVisible: Traces a shadow ray from a point towards a light position.
+//
+//  Arguments:
+//      globdat     : Global scene data
+//      bvh         : Pointer to the Bounding Volume Hierarchy
+//      hitPoint    : The point on the surface being shaded
+//      normal      : The surface normal at the hit point
+//      lightPos    : The position on the light
+//
+//  Return:
+//      int         : 1 if the light position is visible, 0 otherwise
+//------------------------------------------------------------------------------
+
+
+int isLightVisible(Globdat *globdat, BVH *bvh, Vec3 *hitPoint, Vec3 *normal, Vec3 *lightPos);
+
+
+//------------------------------------------------------------------------------
+//  computeUnshadowedLight: Computes the light that a spotlight sends to a 
+//                          point when shadows are ignored.
+//
+//  Arguments:
+//      globdat         : Global scene data
+//      offsets         : Base pattern of the soft shadow samples
+//      sampler         : Sampler of the current pixel sample
+//      hitPoint        : The point on the surface being shaded
+//      normal          : Surface normal at the hit point
+//      lightIndex      : Index of the spotlight
+//      positions       : Positions of the light samples (return argument)
+//      contributions   : Contributions of the light samples (return argument)
+//
+//  Return:
+//      double          : The sum of the contributions, 0 if the point is 
+//                        outside the cone of the spotlight (the arrays are
+//                        not filled in that case)
+//------------------------------------------------------------------------------
+
+
+double computeUnshadowedLight(
+    Globdat* globdat,
+    Vec3* offsets,
+    Sampler* sampler,
+    Vec3* hitPoint,
+    Vec3* normal,
+    int lightIndex,
+    Vec3* positions,
+    double* contributions
+);
 
 
 //------------------------------------------------------------------------------
@@ -56,7 +135,8 @@ void createRandomOffsets(Vec3* offsets);
 //      globdat         : Global scene data (lights, materials, etc.)
 //      bvh             : Pointer to the Bounding Volume Hierarchy for intersections
 //      intersection    : Intersection data at the hit point
-//      offsets         : Precomputed random offsets for soft shadow sampling
+//      offsets         : Base pattern of the soft shadow samples
+//      sampler         : Sampler of the current pixel sample (rotation of the pattern)
 //      lightIndex      : Index of the light source being considered
 //
 //  Return:
@@ -66,7 +146,10 @@ void createRandomOffsets(Vec3* offsets);
 //  Description:
 //      This function casts multiple jittered shadow rays toward the light source,
 //      taking into account occlusions. It averages the visibility across all
-//      samples to simulate soft shadowing effects from an area light.
+//      samples to simulate soft shadowing effects from an area light. When 
+//      adaptive shadows are enabled, SHADOW_PROBES rays towards the extremes 
+//      of the light are cast first; all samples are only traced when the 
+//      probes disagree (in the penumbra).
 //------------------------------------------------------------------------------
 
 
@@ -74,12 +157,56 @@ double computeSoftShadow(
     Globdat* globdat,
     BVH* bvh,
     Vec3* offsets,
+    Sampler* sampler,
     Vec3* hitPoint,
     Vec3* normal,
     Intersect* intersection,
     int lightIndex
 );
 
+
+
+//------------------------------------------------------------------------------
+//  computeStochasticLight: Estimates the light from the sun and all spotlights
+//                          with a fixed number of shadow rays.
+//
+//  Arguments:
+//      globdat         : Global scene data
+//      bvh             : Pointer to the Bounding Volume Hierarchy
+//      offsets         : Base pattern of the soft shadow samples
+//      sampler         : Sampler of the current pixel sample
+//      hitPoint        : The point on the surface being shaded
+//      normal          : Surface normal at the hit point
+//      candidates      : Number of shadow rays
+//      sunLight        : Estimate of the light of the sun, added to the value
+//                        (NULL = not needed)
+//      spotLight       : Estimate of the light of each spotlight, added to
+//                        the array (NULL = not needed)
+//
+//  Return:
+//      double          : Unbiased estimate of the light of the sun and the 
+//                        spotlights
+//
+//  Description:
+//      The candidates are the sun and every sample of every spotlight that 
+//      can reach the point. Each shadow ray goes to a candidate that is 
+//      selected with a probability proportional to its unshadowed 
+//      contribution, and is weighted with the inverse of this probability.
+//------------------------------------------------------------------------------
+
+
+double computeStochasticLight(
+    Globdat* globdat,
+    BVH* bvh,
+    Vec3* offsets,
+    Sampler* sampler,
+    Vec3* hitPoint,
+    Vec3* normal,
+    int candidates,
+    double* sunLight,
+    double* spotLight
+);
+
 #endif
 
 
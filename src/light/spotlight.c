@@ -5,7 +5,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "spotlight.h"
+#include "shadow.h"
 
 #define PI 3.14159265358979323846
 
@@ -17,8 +19,34 @@ void readSpotlightData(FILE *fin, Spotlights *spotlights)
 {
   char label[32];
 
-  int nLight;
-  fscanf(fin, "%d", &nLight);
+  int nLight = 0;
+
+  spotlights->samples = SHADOW_SAMPLES;
+  spotlights->radius = SHADOW_RADIUS;
+
+  fscanf(fin, "%s", label);
+
+  while (strcmp(label, "Samples") == 0 || strcmp(label, "Radius") == 0)
+  {
+    if (strcmp(label, "Samples") == 0)
+    {
+      fscanf(fin, "%d", &spotlights->samples);
+    }
+    else
+    {
+      fscanf(fin, "%le", &spotlights->radius);
+    }
+
+    fscanf(fin, "%s", label);
+  }
+
+  if (spotlights->samples < 1 || spotlights->samples > SHADOW_MAX_SAMPLES)
+  {
+    printf("ERROR: Shadow samples must be between 1 and %d, using %d\n", SHADOW_MAX_SAMPLES, SHADOW_SAMPLES);
+    spotlights->samples = SHADOW_SAMPLES;
+  }
+
+  nLight = atoi(label);
   
   spotlights->spotlight = (Spotlight *)malloc(sizeof(Spotlight) * nLight);
   spotlights->count = 0;
@@ -37,6 +65,8 @@ void readSpotlightData(FILE *fin, Spotlights *spotlights)
   }
 
   printf("    Number of lights ........ : %d\n",nLight);
+  printf("    Shadow samples .......... : %d\n",spotlights->samples);
+  printf("    Shadow radius ........... : %f\n",spotlights->radius);
 }
 
 //------------------------------------------------------------------------------
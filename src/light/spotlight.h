@@ -31,17 +31,23 @@
 
  //------------------------------------------------------------------------------
  //  Declaration of the Spotlights type (for count calculation)
+ //      samples : number of shadow rays per spotlight
+ //      radius  : size of the (cubic) light source used for soft shadows
  //------------------------------------------------------------------------------
 
  typedef struct 
  {
      Spotlight *spotlight;
      int count;
+     int samples;
+     double radius;
  } Spotlights;
 
  
  //------------------------------------------------------------------------------
- //  readSpotlightData: Reads the spotlight data from a file
+ //  readSpotlightData: Reads the spotlight data from a file. The number of 
+ //                     lights may be preceded by the optional keywords 
+ //                     'Samples n' and 'Radius r' for the soft shadows.
  //
  //  Arguments:
  //      fin     : File pointer to the file that contains the spotlight data
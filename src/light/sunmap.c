@@ -0,0 +1,290 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "sunmap.h"
+#include "../util/bvh.h"
+#include "../util/counter.h"
+
+#define SUNMAP_FOOTPRINT 128
+#define SUNMAP_BIAS      1.0e-3
+
+
+//------------------------------------------------------------------------------
+//  Lookup counters, one cache line per thread
+//------------------------------------------------------------------------------
+
+
+#define COUNTER_RESOLVED 0
+#define COUNTER_FALLBACK 1
+
+static ThreadCounters sunMapCounters;
+
+
+//------------------------------------------------------------------------------
+//  createSunMap: Builds the sun visibility map
+//------------------------------------------------------------------------------
+
+
+SunMap* createSunMap
+
+  ( Globdat*     globdat ,
+    int          size    )
+
+{
+  BVH  *bvh = globdat->bvh;
+  Vec3  d   = globdat->sun.d;
+
+  unit( &d );
+
+  // Axes of the map plane
+
+  Vec3 helper = ( fabs( d.z ) < 0.9 ) ? (Vec3){ 0.0 , 0.0 , 1.0 } : (Vec3){ 1.0 , 0.0 , 0.0 };
+  Vec3 e1, e2;
+
+  crossProduct( &e1 , &helper , &d );
+  unit( &e1 );
+  crossProduct( &e2 , &d , &e1 );
+
+  // The map covers the points that the camera sees, found with a coarse grid
+  // of primary rays
+
+  double umin =  INFINITY, umax = -INFINITY;
+  double vmin =  INFINITY, vmax = -INFINITY;
+
+  int width  = globdat->film->width;
+  int height = globdat->film->height;
+
+  #pragma omp parallel for collapse(2) reduction(min:umin,vmin) reduction(max:umax,vmax)
+  for ( int i = 0 ; i <= SUNMAP_FOOTPRINT ; i++ )
+  {
+    for ( int j = 0 ; j <= SUNMAP_FOOTPRINT ; j++ )
+    {
+      Ray       ray;
+      Intersect hit;
+
+      int ix = (int)( (double)i / SUNMAP_FOOTPRINT * ( width  - 1 ) );
+      int iy = (int)( (double)j / SUNMAP_FOOTPRINT * ( height - 1 ) );
+
+      generateCameraRay( &ray , ix , iy , 0.5 , 0.5 , 0.5 , 0.5 , &globdat->cam );
+
+      resetIntersect( &hit );
+      traverseBVH( bvh , globdat , &ray , &hit );
+
+      if ( hit.matID != -1 )
+      {
+        Vec3 p = addVector( 1.0 , &ray.o , hit.t , &ray.d );
+
+        double u = dotProduct( &p , &e1 );
+        double v = dotProduct( &p , &e2 );
+
+        umin = fmin( umin , u );
+        umax = fmax( umax , u );
+        vmin = fmin( vmin , v );
+        vmax = fmax( vmax , v );
+      }
+    }
+  }
+
+  if ( umin > umax || bvh->objectCount == 0 )
+  {
+    return NULL;
+  }
+
+  // Hits on planes can lie far away, outside the bounding box of the scene
+
+  AABB *box = &bvh->nodes[0].bbox;
+
+  double bumin =  INFINITY, bumax = -INFINITY;
+  double bvmin =  INFINITY, bvmax = -INFINITY;
+
+  for ( int c = 0 ; c < 8 ; c++ )
+  {
+    Vec3 corner = { ( c & 1 ) ? box->max.x : box->min.x ,
+                    ( c & 2 ) ? box->max.y : box->min.y ,
+                    ( c & 4 ) ? box->max.z : box->min.z };
+
+    bumin = fmin( bumin , dotProduct( &corner , &e1 ) );
+    bumax = fmax( bumax , dotProduct( &corner , &e1 ) );
+    bvmin = fmin( bvmin , dotProduct( &corner , &e2 ) );
+    bvmax = fmax( bvmax , dotProduct( &corner , &e2 ) );
+  }
+
+  umin = fmax( umin , bumin );
+  umax = fmin( umax , bumax );
+  vmin = fmax( vmin , bvmin );
+  vmax = fmin( vmax , bvmax );
+
+  if ( umin > umax || vmin > vmax )
+  {
+    return NULL;
+  }
+
+  SunMap *map = (SunMap*)malloc( sizeof(SunMap) );
+
+  map->e1    = e1;
+  map->e2    = e2;
+  map->d     = d;
+  map->size  = size;
+  map->texel = fmax( umax - umin , vmax - vmin ) / ( size - 4 );
+  map->u0    = umin - 2.0 * map->texel;
+  map->v0    = vmin - 2.0 * map->texel;
+  map->depth = (float*)malloc( (size_t)size * size * sizeof(float) );
+
+  // The map plane lies in front of the bounding box of the scene
+
+  map->originDepth = -INFINITY;
+
+  for ( int c = 0 ; c < 8 ; c++ )
+  {
+    Vec3 corner = { ( c & 1 ) ? box->max.x : box->min.x ,
+                    ( c & 2 ) ? box->max.y : box->min.y ,
+                    ( c & 4 ) ? box->max.z : box->min.z };
+
+    map->originDepth = fmax( map->originDepth , dotProduct( &corner , &d ) + 1.0 );
+  }
+
+  #pragma omp parallel for collapse(2) schedule(dynamic, 64)
+  for ( int j = 0 ; j < size ; j++ )
+  {
+    for ( int i = 0 ; i < size ; i++ )
+    {
+      Ray       ray;
+      Intersect hit;
+
+      double u = map->u0 + ( i + 0.5 ) * map->texel;
+      double v = map->v0 + ( j + 0.5 ) * map->texel;
+
+      ray.o.x  = u * e1.x + v * e2.x + map->originDepth * d.x;
+      ray.o.y  = u * e1.y + v * e2.y + map->originDepth * d.y;
+      ray.o.z  = u * e1.z + v * e2.z + map->originDepth * d.z;
+      ray.d    = multiplyVector( -1.0 , &d );
+      ray.mask = RAY_SHADOW;
+
+      resetIntersect( &hit );
+      traverseBVH( bvh , globdat , &ray , &hit );
+
+      map->depth[j*size+i] = ( hit.matID == -1 ) ? INFINITY : (float)hit.t;
+    }
+  }
+
+  resetThreadCounters( &sunMapCounters );
+
+  return map;
+}
+
+
+//------------------------------------------------------------------------------
+//  freeSunMap: Frees the sun map
+//------------------------------------------------------------------------------
+
+
+void freeSunMap
+
+  ( SunMap*      map )
+
+{
+  if ( map != NULL )
+  {
+    free( map->depth );
+    free( map );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  lookupSunMap: Classifies the visibility of the sun from a point
+//------------------------------------------------------------------------------
+
+
+int lookupSunMap
+
+  ( SunMap*      map    ,
+    Vec3*        point  ,
+    Vec3*        normal )
+
+{
+  long *counter = getThreadCounter( &sunMapCounters );
+
+  double cosT = dotProduct( normal , &map->d );
+
+  // Surfaces facing away from the sun receive no sun light anyway
+
+  if ( cosT <= 0.0 )
+  {
+    counter[COUNTER_RESOLVED]++;
+    return 0;
+  }
+
+  int i = (int)floor( ( dotProduct( point , &map->e1 ) - map->u0 ) / map->texel );
+  int j = (int)floor( ( dotProduct( point , &map->e2 ) - map->v0 ) / map->texel );
+
+  if ( i < 1 || j < 1 || i >= map->size - 1 || j >= map->size - 1 )
+  {
+    counter[COUNTER_FALLBACK]++;
+    return -1;
+  }
+
+  double dmin = INFINITY;
+  double dmax = -INFINITY;
+
+  for ( int jj = j - 1 ; jj <= j + 1 ; jj++ )
+  {
+    for ( int ii = i - 1 ; ii <= i + 1 ; ii++ )
+    {
+      double depth = map->depth[jj*map->size+ii];
+
+      dmin = fmin( dmin , depth );
+      dmax = fmax( dmax , depth );
+    }
+  }
+
+  // The depths of the surface itself vary over the neighbourhood with the 
+  // slope of the surface as seen from the sun
+
+  double depth = map->originDepth - dotProduct( point , &map->d );
+  double tanT  = sqrt( fmax( 1.0 - cosT * cosT , 0.0 ) ) / cosT;
+  double eps   = SUNMAP_BIAS + 3.0 * map->texel * fmin( tanT , 100.0 );
+
+  if ( depth <= dmin + eps )
+  {
+    counter[COUNTER_RESOLVED]++;
+    return 1;
+  }
+
+  if ( depth > dmax + eps )
+  {
+    counter[COUNTER_RESOLVED]++;
+    return 0;
+  }
+
+  counter[COUNTER_FALLBACK]++;
+  return -1;
+}
+
+
+//------------------------------------------------------------------------------
+//  getSunMapCounters: Returns the number of decided and undecided lookups
+//------------------------------------------------------------------------------
+
+
+void getSunMapCounters
+
+  ( long*        resolved ,
+    long*        fallback )
+
+{
+  *resolved = sumThreadCounters( &sunMapCounters , COUNTER_RESOLVED );
+  *fallback = sumThreadCounters( &sunMapCounters , COUNTER_FALLBACK );
+}
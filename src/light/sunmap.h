@@ -0,0 +1,114 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef LIGHT_SUNMAP_H
+#define LIGHT_SUNMAP_H
+
+#include "../base/globalData.h"
+#include "../util/vector.h"
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the SunMap type (a visibility map of the sun). The map is
+//  an orthographic depth map in the plane perpendicular to the sun direction.
+//      e1,e2       : axes of the map
+//      d           : direction of the sun
+//      originDepth : position of the map plane along d
+//      u0,v0       : coordinates of the corner of the map along e1 and e2
+//      texel       : size of a texel
+//      size        : number of texels in each direction
+//      depth       : distance from the map plane to the first surface
+//                    (INFINITY if the ray does not hit the scene)
+//------------------------------------------------------------------------------
+
+
+typedef struct SunMap
+{
+  Vec3       e1,e2,d;
+  double     originDepth;
+  double     u0,v0;
+  double     texel;
+  int        size;
+  float      *depth;
+} SunMap;
+
+
+//------------------------------------------------------------------------------
+//  createSunMap: Builds the sun visibility map for the part of the scene that
+//                is seen by the camera
+//
+//  Arguments:
+//      globdat : Pointer to the global data (camera, sun and BVH are used)
+//      size    : number of texels in each direction
+//
+//  Return:
+//      SunMap* : the sun map, NULL if nothing is visible
+//------------------------------------------------------------------------------
+
+
+SunMap* createSunMap
+
+  ( Globdat*     globdat ,
+    int          size    );
+
+
+//------------------------------------------------------------------------------
+//  freeSunMap: Frees the sun map
+//
+//  Arguments:
+//      map     : Pointer to the sun map (may be NULL)
+//------------------------------------------------------------------------------
+
+
+void freeSunMap
+
+  ( SunMap*      map );
+
+
+//------------------------------------------------------------------------------
+//  lookupSunMap: Classifies the visibility of the sun from a point using the
+//                depths of the 3x3 texels around the point
+//
+//  Arguments:
+//      map     : Pointer to the sun map
+//      point   : The point on the surface
+//      normal  : The surface normal at the point
+//
+//  Return:
+//      int     : 1 if the sun is visible, 0 if it is not and -1 if the map
+//                cannot decide (near a shadow edge or outside the map). In
+//                that case a shadow ray must be traced.
+//------------------------------------------------------------------------------
+
+
+int lookupSunMap
+
+  ( SunMap*      map    ,
+    Vec3*        point  ,
+    Vec3*        normal );
+
+
+//------------------------------------------------------------------------------
+//  getSunMapCounters: Returns the number of lookups that were decided by the
+//                     map and the number that needed a shadow ray
+//
+//  Arguments:
+//      resolved : number of decided lookups (return argument)
+//      fallback : number of undecided lookups (return argument)
+//------------------------------------------------------------------------------
+
+
+void getSunMapCounters
+
+  ( long*        resolved ,
+    long*        fallback );
+
+#endif
@@ -0,0 +1,147 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util/film.h"
+#include "../util/region.h"
+
+
+//------------------------------------------------------------------------------
+//  hasExtension: Returns 1 if a file name ends with the given extension
+//------------------------------------------------------------------------------
+
+
+static int hasExtension
+
+  ( const char*  name      ,
+    const char*  extension )
+
+{
+  size_t n = strlen( name );
+  size_t m = strlen( extension );
+
+  return n >= m && strcmp( name + n - m , extension ) == 0;
+}
+
+
+//------------------------------------------------------------------------------
+//  main: Merges the partial film files of several processes into one image.
+//        The colors and weights of the pixels are summed, so the parts may
+//        also overlap. The type of the output follows from its extension:
+//        .pfm and .exr give a linear image, .png and .bmp an 8 bit image.
+//        The 8 bit image uses the Exposure and Gamma of the render, which
+//        are stored in the partial films.
+//------------------------------------------------------------------------------
+
+
+int main( int argc, char *argv[] )
+
+{
+  if ( argc < 3 )
+  {
+    printf("Please rerun the executable with the output image and the partial films\n");
+    printf("For example:   merge.exe image.bmp part0.part part1.part\n");
+    printf("A .bmp or .png image gets the Exposure and Gamma of the render\n");
+    return 0;
+  }
+
+  int    height, width;
+  double exposure, gamma;
+
+  // Every file must be a partial film of this version and of the same image
+
+  for ( int i = 2 ; i < argc ; i++ )
+  {
+    int    h, w;
+    double e, g;
+    int    status = readPartialFilmHeader( argv[i] , &h , &w , &e , &g );
+
+    if ( status == -2 )
+    {
+      printf("ERROR: '%s' has another version or header size than this merge tool\n",argv[i]);
+      return 1;
+    }
+
+    if ( status != 0 )
+    {
+      printf("ERROR: '%s' is not a partial film file\n",argv[i]);
+      return 1;
+    }
+
+    if ( i == 2 )
+    {
+      height   = h;
+      width    = w;
+      exposure = e;
+      gamma    = g;
+    }
+    else if ( h != height || w != width )
+    {
+      printf("ERROR: Partial film '%s' is of another image\n",argv[i]);
+      return 1;
+    }
+    else if ( e != exposure || g != gamma )
+    {
+      printf("WARNING: Partial film '%s' has another exposure or gamma, those of '%s' are used\n",argv[i],argv[2]);
+    }
+  }
+
+  Film *film = createFilm( height , width );
+
+  for ( int i = 2 ; i < argc ; i++ )
+  {
+    long tiles = addPartialFilm( film , argv[i] );
+
+    if ( tiles < 0 )
+    {
+      printf("ERROR: Partial film '%s' is missing, incomplete or of another image\n",argv[i]);
+      free( film );
+      return 1;
+    }
+
+    printf("  Partial film %-20s : %ld tiles\n",argv[i],tiles);
+  }
+
+  long missing = 0;
+
+  for ( long k = 0 ; k < (long)height * width ; k++ )
+  {
+    missing += ( film->p[k].wght == 0.0 );
+  }
+
+  if ( missing > 0 )
+  {
+    printf("WARNING: %ld pixels have no samples\n",missing);
+  }
+
+  char *output = argv[1];
+
+  FilmWriter *writer = openFilmWriter( film ,
+                                       hasExtension( output , ".pfm" ) || hasExtension( output , ".exr" ) ? NULL : output ,
+                                       hasExtension( output , ".pfm" ) ? output : NULL ,
+                                       hasExtension( output , ".exr" ) ? output : NULL ,
+                                       NULL , 0 );
+
+  writer->exposure = exposure;
+  writer->gamma    = gamma;
+
+  writeFilmRows( writer , film );
+  closeFilmWriter( writer );
+
+  free( film );
+
+  printf("  The image is stored in the file '%s'.\n",output);
+
+  return 0;
+}
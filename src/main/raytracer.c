@@ -32,10 +32,29 @@ int main( int argc, char *argv[] )
   { 
     printf("Please rerun the executable with the correct input filename\n");
     printf("For example:   raytracer.exe singlePin.in\n"); 
+    printf("Options:      --resume, --crop x0 y0 x1 y1, --tiles first last,\n"); 
+    printf("              --claim dir, --partial file\n"); 
     return 0; 
   }
      
   readInput ( argv[1] , &globdat );
+
+  if ( readSettingsOptions( argc , argv , &globdat.settings ) != 0 )
+  {
+    return 1;
+  }
+
+  // A part of the image is written to a partial film file, which is merged
+  // with the other parts by merge.exe
+
+  Settings *settings = &globdat.settings;
+
+  if ( settings->partialFilm[0] == '\0' && ( settings->cropWindow[2] > 0 ||
+       settings->firstTile > 0 || settings->lastTile >= 0 || settings->claimDir[0] != '\0' ) )
+  {
+    getOutputName( &globdat , "" , ".part" , settings->partialFilm , sizeof(settings->partialFilm) );
+  }
+
   preprocess( &globdat );
   
   trace     ( &globdat );
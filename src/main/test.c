@@ -13,11 +13,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
+#include <limits.h>
+#ifdef _WIN32
+#include <io.h>
+#include <direct.h>
+#define rmdir _rmdir
+#else
+#include <unistd.h>
+#endif
 
 #include "../util/vector.h"
 #include "../util/film.h"
+#include "../util/deflate.h"
+#include "../util/checkpoint.h"
+#include "../util/region.h"
+#include "../util/aov.h"
+#include "../util/denoise.h"
+#include "../util/preview.h"
 #include "../util/bvh.h"
 #include "../shapes/spheres.h"
+#include "../shapes/planes.h"
+#include "../shapes/lod.h"
+#include "../util/random.h"
+#include "../util/sampler.h"
+#include "../light/shadow.h"
+#include "../light/lightbvh.h"
+#include "../light/sunmap.h"
+#include "../light/radiancecache.h"
 #include "../util/vector.h"
 
 // Test computeFaceAABB
@@ -66,8 +89,6 @@ void test_computeCentroidAABB() {
 // Test traverseBVH
 void test_traverseBVH() {
   Globdat globdat;
-  BVH *bvh = (BVH *)malloc(sizeof(BVH));
-  bvh->nodeCount = 0;
 
   globdat.spheres.count = 2;
   globdat.spheres.sphere[0].centre = (Vec3){0.0, 0.0, 0.0};
@@ -77,8 +98,9 @@ void test_traverseBVH() {
   globdat.spheres.sphere[1].radius = 1.0;
   globdat.spheres.sphere[1].matID = 2;
   globdat.mesh.faceCount = 0;
+  globdat.planes.count = 0;
 
-  buildBVH(bvh, &globdat, 0, globdat.spheres.count);
+  BVH *bvh = createBVH(&globdat);
 
   assert(bvh->nodeCount == 1);
 
@@ -98,6 +120,1196 @@ void test_traverseBVH() {
   printf("test_traverseBVH passed.\n");
 }
 
+// Test calcPlaneIntersection and convertLargeSpheres
+void test_planes() {
+  Planes planes;
+  planes.count = 0;
+
+  addPlane(&planes, (Vec3){0.0, 0.0, 1.0}, (Vec3){0.0, 0.0, 2.0}, 3);
+
+  assert(planes.plane[0].normal.z == 1.0 && planes.plane[0].offset == 1.0);
+
+  Ray ray;
+  ray.o = (Vec3){0.0, 0.0, 5.0};
+  ray.d = (Vec3){0.0, 0.0, -1.0};
+
+  Intersect intersection;
+  resetIntersect(&intersection);
+
+  assert(calcPlaneIntersection(&intersection, &ray, &planes.plane[0]));
+  assert(intersection.matID == 3 && intersection.t == 4.0);
+
+  ray.d = (Vec3){1.0, 0.0, 0.0};
+  resetIntersect(&intersection);
+
+  assert(!calcPlaneIntersection(&intersection, &ray, &planes.plane[0]));
+
+  Spheres spheres;
+  spheres.count = 0;
+  addSphere(&spheres, (Vec3){0.0, 0.0, -10000.0}, 10001.0, 2);
+  addSphere(&spheres, (Vec3){1.0, 0.0, 2.0}, 0.5, 1);
+
+  assert(convertLargeSpheres(&spheres, &planes, (Vec3){0.0, 0.0, 2.0}, 1000.0) == 1);
+  assert(spheres.count == 1 && spheres.sphere[0].radius == 0.5);
+  assert(planes.count == 2 && planes.plane[1].matID == 2);
+  assert(planes.plane[1].offset == 1.0);
+
+  printf("test_planes passed.\n");
+}
+
+// Test octahedral normals and the compact mesh
+void test_compactMesh() {
+  Vec3 n = {0.3, -0.5, -0.8};
+  unit(&n);
+
+  Vec3 m = decodeOctNormal(encodeOctNormal(&n));
+
+  assert(fabs(m.x - n.x) < 1.0e-4 && fabs(m.y - n.y) < 1.0e-4 && fabs(m.z - n.z) < 1.0e-4);
+
+  Mesh mesh;
+  initMesh(&mesh);
+  mesh.vertices = (Vec3 *)malloc(4 * sizeof(Vec3));
+  mesh.normals = (Vec3 *)malloc(4 * sizeof(Vec3));
+  mesh.faces = (FaceData *)malloc(sizeof(FaceData));
+
+  addVertex(&mesh, (Vec3){0.0, 0.0, 0.0});
+  addVertex(&mesh, (Vec3){1.0, 0.0, 0.0});
+  addVertex(&mesh, (Vec3){1.0, 1.0, 0.0});
+  addVertex(&mesh, (Vec3){0.0, 1.0, 0.0});
+
+  int quad[4] = {0, 1, 2, 3};
+  addFace(&mesh, quad, 4, 7);
+  addFaceNormals(&mesh);
+  compactMesh(&mesh);
+
+  assert(mesh.compact == 1 && mesh.faceCount == 2);
+
+  Face face;
+  getFace(&face, 1, &mesh);
+
+  assert(face.vertexCount == 3 && face.matID == 7);
+  assert(face.vertices[1].x == 1.0 && face.vertices[1].y == 1.0);
+
+  Ray ray;
+  ray.o = (Vec3){0.25, 0.75, 1.0};
+  ray.d = (Vec3){0.0, 0.0, -1.0};
+
+  Intersect intersection;
+  resetIntersect(&intersection);
+
+  assert(calcFaceIntersection(&intersection, &ray, &face, &mesh, 1));
+  assert(intersection.t == 1.0 && fabs(intersection.normal.z - 1.0) < 1.0e-6);
+
+  freeMesh(&mesh);
+
+  printf("test_compactMesh passed.\n");
+}
+
+// Test reorderMesh
+void test_reorderMesh() {
+  Mesh mesh;
+  initMesh(&mesh);
+  mesh.vertices = (Vec3 *)malloc(6 * sizeof(Vec3));
+  mesh.faces = (FaceData *)malloc(2 * sizeof(FaceData));
+
+  addVertex(&mesh, (Vec3){0.0, 0.0, 0.0});
+  addVertex(&mesh, (Vec3){1.0, 0.0, 0.0});
+  addVertex(&mesh, (Vec3){0.0, 1.0, 0.0});
+  addVertex(&mesh, (Vec3){9.0, 9.0, 9.0});
+  addVertex(&mesh, (Vec3){10.0, 9.0, 9.0});
+  addVertex(&mesh, (Vec3){9.0, 10.0, 9.0});
+
+  int far[3] = {3, 4, 5};
+  int near[3] = {2, 1, 0};
+  addFace(&mesh, far, 3, 1);
+  addFace(&mesh, near, 3, 2);
+
+  reorderMesh(&mesh);
+
+  assert(mesh.faceOrigIDs[0] == 1 && mesh.faceOrigIDs[1] == 0);
+  assert(mesh.faces[0].matID == 2 && mesh.faces[0].vertexIDs[0] == 0);
+  assert(mesh.vertexOrigIDs[0] == 2 && mesh.vertexOrigIDs[3] == 3);
+  assert(mesh.vertices[0].y == 1.0 && mesh.vertices[4].x == 10.0);
+
+  freeMesh(&mesh);
+
+  printf("test_reorderMesh passed.\n");
+}
+
+// Test projectedSize
+void test_projectedSize() {
+  CameraData cam;
+  cam.origin = (Vec3){0.0, 0.0, 0.0};
+  cam.dx = 0.001;
+
+  double size = projectedSize((Vec3){10.0, 0.0, 0.0}, 0.5, &cam);
+
+  assert(fabs(size - 100.0) < 1.0e-9);
+
+  printf("test_projectedSize passed.\n");
+}
+
+// Test the counter-based random number generator
+void test_random() {
+  double sum = 0.0;
+
+  for (int i = 0; i < 1000; i++)
+  {
+    double r = hashRandom(12, 3, i);
+
+    assert(r >= 0.0 && r < 1.0);
+    assert(r == hashRandom(12, 3, i));
+
+    sum += r;
+  }
+
+  assert(fabs(sum / 1000.0 - 0.5) < 0.05);
+  assert(hashRandom(12, 3, 0) != hashRandom(13, 3, 0));
+  assert(hashRandom(12, 3, 0) != hashRandom(12, 4, 0));
+
+  printf("test_random passed.\n");
+}
+
+// Test the samplers: points in [0,1) and one point per stratum
+void test_sampler() {
+  int types[4] = {SAMPLER_STRATIFIED, SAMPLER_SOBOL, SAMPLER_HALTON, SAMPLER_CMJ};
+
+  for (int t = 0; t < 4; t++)
+  {
+    Sampler sampler;
+    initSampler(&sampler, types[t], 16);
+
+    int countX[16] = {0};
+    int countXY[4][4] = {{0}};
+
+    for (int sample = 0; sample < 16; sample++)
+    {
+      double u, v;
+
+      startSample(&sampler, 7, sample);
+      getSample2D(&sampler, SAMPLER_DIM_LENS, &u, &v);
+
+      assert(u >= 0.0 && u < 1.0);
+      assert(v >= 0.0 && v < 1.0);
+
+      countX[(int)(16 * u)]++;
+      countXY[(int)(4 * u)][(int)(4 * v)]++;
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+      if (types[t] == SAMPLER_SOBOL || types[t] == SAMPLER_CMJ)
+      {
+        assert(countX[i] == 1);
+      }
+
+      if (types[t] != SAMPLER_HALTON)
+      {
+        assert(countXY[i / 4][i % 4] == 1);
+      }
+    }
+  }
+
+  // Halton dimensions past the prime table use the hashed random numbers
+
+  Sampler halton;
+  double u, v;
+
+  initSampler(&halton, SAMPLER_HALTON, 16);
+  startSample(&halton, 7, 3);
+  getSample2D(&halton, 16, &u, &v);
+
+  assert(u == hashRandom(7, 3, 32) && v == hashRandom(7, 3, 33));
+
+  assert(getSamplerType("sobol") == SAMPLER_SOBOL);
+  assert(getSamplerType("none") == -1);
+
+  printf("test_sampler passed.\n");
+}
+
+// Test the accumulation of samples and the pixel error estimate
+void test_pixelError() {
+  Film *film = createFilm(1, 2);
+
+  Color grey = {100.0, 100.0, 100.0};
+  Color dark = {20.0, 20.0, 20.0};
+
+  for (int i = 0; i < 8; i++)
+  {
+    addPixelSample(film, 0, 0, &grey, 1.0);
+    addPixelSample(film, 1, 0, (i % 2) ? &grey : &dark, 1.0);
+  }
+
+  assert(film->p[0].wght == 8.0);
+  assert(fabs(film->p[0].c.red - 800.0) < 1.0e-9);
+  assert(getPixelError(film, 0, 0) < 1.0e-3);
+  assert(getPixelError(film, 1, 0) > 1.0);
+
+  free(film);
+
+  printf("test_pixelError passed.\n");
+}
+
+// Test that the tiles cover every pixel of the film exactly once
+void test_tiles() {
+  Film *film = createFilm(40, 70);
+  Tile *tile = createTile(32);
+  Color grey = {100.0, 100.0, 100.0};
+
+  assert(getTileCount(film, 32) == 6);
+
+  startTile(tile, film, 32, 5);
+  assert(tile->x0 == 64 && tile->y0 == 32);
+  assert(tile->width == 6 && tile->height == 8);
+
+  for (int t = 0; t < getTileCount(film, 32); t++)
+  {
+    startTile(tile, film, 32, t);
+
+    for (int j = tile->y0; j < tile->y0 + tile->height; j++)
+    {
+      for (int i = tile->x0; i < tile->x0 + tile->width; i++)
+      {
+        addTileSample(tile, i, j, &grey, 1.0);
+      }
+    }
+
+    flushTile(film, tile);
+  }
+
+  for (int k = 0; k < 40 * 70; k++)
+  {
+    assert(film->p[k].wght == 1.0);
+    assert(film->p[k].c.red == 100.0);
+  }
+
+  free(tile);
+  free(film);
+
+  printf("test_tiles passed.\n");
+}
+
+// Test the linear float images written from the film
+void test_hdrOutput() {
+  Film *film = createFilm(2, 3);
+  Color color = {51.0, 102.0, 255.0};
+
+  addPixelSample(film, 2, 1, &color, 1.0);
+  addPixelSample(film, 2, 1, &color, 1.0);
+
+  saveToPFM(film, "test_output.pfm");
+
+  FILE *file = fopen("test_output.pfm", "rb");
+  char magic[3];
+  int width, height;
+  float scale;
+  float data[18];
+
+  assert(fscanf(file, "%2s %d %d %f", magic, &width, &height, &scale) == 4);
+  fgetc(file);
+  assert(strcmp(magic, "PF") == 0 && width == 3 && height == 2 && scale < 0.0);
+  assert(fread(data, sizeof(float), 18, file) == 18);
+  assert(fabs(data[15] - 0.2) < 1.0e-6 && fabs(data[16] - 0.4) < 1.0e-6 && data[17] == 1.0f);
+  assert(data[0] == 0.0f);
+  fclose(file);
+
+  // 8 + header (305) + offsets (2 x 8) + chunks (2 x (8 + 3 x 12))
+
+  saveToEXR(film, "test_output.exr");
+
+  file = fopen("test_output.exr", "rb");
+  fseek(file, 0, SEEK_END);
+  assert(ftell(file) == 8 + 305 + 16 + 2 * 44);
+  fclose(file);
+
+  remove("test_output.pfm");
+  remove("test_output.exr");
+  free(film);
+
+  printf("test_hdrOutput passed.\n");
+}
+
+// Test that a film rendered in bands gives the same file as a full film
+void test_filmBands() {
+  Film *full = createFilm(10, 4);
+  Film *band = createFilmBand(10, 4, 3);
+
+  assert(band->bandSize == 3);
+
+  for (int j = 0; j < 10; j++)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      Color color = {10.0 * i, 20.0 * j, 255.0};
+      addPixelSample(full, i, j, &color, 1.0);
+    }
+  }
+
+  FilmWriter *writer = openFilmWriter(band, NULL, "test_band.pfm", NULL, NULL, 0);
+  int bands = 0;
+
+  for (int y0 = 0; y0 < band->height; y0 += band->bandSize)
+  {
+    startFilmBand(band, y0);
+
+    for (int j = band->y0; j < band->y0 + band->rows; j++)
+    {
+      for (int i = 0; i < 4; i++)
+      {
+        Color color = {10.0 * i, 20.0 * j, 255.0};
+        addPixelSample(band, i, j, &color, 1.0);
+      }
+    }
+
+    writeFilmRows(writer, band);
+    bands++;
+  }
+
+  closeFilmWriter(writer);
+
+  assert(bands == 4 && band->rows == 1);
+
+  saveToPFM(full, "test_full.pfm");
+
+  FILE *a = fopen("test_band.pfm", "rb");
+  FILE *b = fopen("test_full.pfm", "rb");
+  int ca, cb, size = 0;
+
+  do
+  {
+    ca = fgetc(a);
+    cb = fgetc(b);
+    assert(ca == cb);
+    size++;
+  } while (ca != EOF);
+
+  assert(size > 10 * 4 * 12);
+
+  fclose(a);
+  fclose(b);
+  remove("test_band.pfm");
+  remove("test_full.pfm");
+  free(full);
+  free(band);
+
+  printf("test_filmBands passed.\n");
+}
+
+// Test the checksums of the deflate stream and the chunks of a PNG file
+void test_pngOutput() {
+  unsigned char data[1000];
+
+  for (int i = 0; i < 1000; i++)
+  {
+    data[i] = (unsigned char)(i * i + 7);
+  }
+
+  uint32_t whole = updateAdler32(1, data, 1000);
+  uint32_t first = updateAdler32(1, data, 300);
+  uint32_t second = updateAdler32(1, data + 300, 700);
+
+  assert(combineAdler32(first, second, 700) == whole);
+  assert(updateCRC32(0, (const unsigned char *)"IEND", 4) == 0xAE426082);
+
+  Film *film = createFilm(40, 6);
+
+  for (int j = 0; j < 40; j++)
+  {
+    for (int i = 0; i < 6; i++)
+    {
+      Color color = {6.0 * i, 4.0 * j, 100.0};
+      addPixelSample(film, i, j, &color, 1.0);
+    }
+  }
+
+  FilmWriter *writer = openFilmWriter(film, "test_png.png", NULL, NULL, NULL, 0);
+  writeFilmRows(writer, film);
+  closeFilmWriter(writer);
+
+  FILE *fp = fopen("test_png.png", "rb");
+  unsigned char head[16];
+  unsigned char tail[12];
+  const unsigned char signature[8] = {137, 'P', 'N', 'G', 13, 10, 26, 10};
+  const unsigned char iend[12] = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82};
+
+  assert(fread(head, 1, 16, fp) == 16);
+  assert(memcmp(head, signature, 8) == 0);
+  assert(memcmp(head + 12, "IHDR", 4) == 0);
+
+  fseek(fp, -12, SEEK_END);
+  assert(fread(tail, 1, 12, fp) == 12);
+  assert(memcmp(tail, iend, 12) == 0);
+
+  fclose(fp);
+  remove("test_png.png");
+  free(film);
+
+  printf("test_pngOutput passed.\n");
+}
+
+// Test writing, resuming and rejecting a checkpoint of a film
+void test_checkpoint() {
+  Film *film = createFilm(10, 9);
+  Checkpoint *checkpoint = createCheckpoint("test_checkpoint.ckpt", 0.0, film, 16, 4);
+
+  assert(checkpoint->tileCount == 9);
+
+  for (int j = 0; j < 10; j++)
+  {
+    for (int i = 0; i < 9; i++)
+    {
+      Color color = {1.0 * i, 2.0 * j, 0.5};
+      addPixelSample(film, i, j, &color, 1.0);
+    }
+  }
+
+  startCheckpointPass(checkpoint, 4, 1);
+  finishCheckpointTile(checkpoint, film, 2, 123, 45);
+  finishCheckpointTile(checkpoint, film, 7, 456, 78);
+
+  assert(writeCheckpoint(checkpoint, film) == 0);
+
+  Film *resumed = createFilm(10, 9);
+  Checkpoint *other = createCheckpoint("test_checkpoint.ckpt", 0.0, resumed, 16, 4);
+
+  assert(readCheckpoint(other, resumed) == 1);
+  assert(other->first == 4 && other->pass == 1);
+  assert(other->totalSamples == 456 && other->activePixels == 78);
+  assert(memcmp(other->tileDone, checkpoint->tileDone, 9) == 0);
+  assert(other->tileDone[2] && other->tileDone[7] && !other->tileDone[3]);
+  assert(memcmp(resumed->p, film->p, 10 * 9 * sizeof(Pixel)) == 0);
+
+  // The state of a resumed pass is kept, a new pass clears it
+
+  startCheckpointPass(other, 4, 1);
+  assert(other->tileDone[2] && other->activePixels == 78);
+
+  startCheckpointPass(other, 8, 2);
+  assert(!other->tileDone[2] && other->activePixels == 0);
+
+  // A checkpoint of another render is not used
+
+  Checkpoint *wrong = createCheckpoint("test_checkpoint.ckpt", 0.0, resumed, 8, 4);
+
+  assert(readCheckpoint(wrong, resumed) == 0);
+
+  // A snapshot is written as it was taken, while the film changes, and only
+  // one snapshot is taken at a time
+
+  Checkpoint *timed = createCheckpoint("test_checkpoint.ckpt", 0.5, film, 16, 4);
+
+  startCheckpointPass(timed, 4, 1);
+  timed->lastWrite -= 1.0;
+
+  assert(finishCheckpointTile(timed, film, 5, 10, 20) == 1);
+  assert(finishCheckpointTile(timed, film, 6, 11, 21) == 0);
+
+  film->p[0].wght += 1.0;
+
+  assert(writeCheckpointSnapshot(timed) == 0);
+  assert(readCheckpoint(other, resumed) == 1);
+  assert(other->tileDone[5] && !other->tileDone[6]);
+  assert(other->totalSamples == 10 && other->activePixels == 20);
+  assert(resumed->p[0].wght == 1.0);
+
+  remove("test_checkpoint.ckpt");
+  freeCheckpoint(checkpoint);
+  freeCheckpoint(other);
+  freeCheckpoint(wrong);
+  freeCheckpoint(timed);
+  free(film);
+  free(resumed);
+
+  printf("test_checkpoint passed.\n");
+}
+
+// Test the tile claims of regions and the merging of partial films
+void test_region() {
+  Film *film = createFilm(10, 9);
+  int crop[4] = {2, 1, 7, 6};
+
+  // The lock files and partial films go to a temporary directory
+
+  char claimDir[32] = "test_region_XXXXXX";
+  char partName[64];
+  char otherName[64];
+
+#ifdef _WIN32
+  assert(_mktemp(claimDir) != NULL && _mkdir(claimDir) == 0);
+#else
+  assert(mkdtemp(claimDir) != NULL);
+#endif
+
+  snprintf(partName, sizeof(partName), "%s/test_region.part", claimDir);
+  snprintf(otherName, sizeof(otherName), "%s/test_other.part", claimDir);
+
+  for (int j = 0; j < 10; j++)
+  {
+    for (int i = 0; i < 9; i++)
+    {
+      Color color = {1.0 * i, 2.0 * j, 0.5};
+      addPixelSample(film, i, j, &color, 1.0);
+    }
+  }
+
+  // Tiles of 4 pixels: 3 x 3 tiles, the crop window overlaps tiles 0, 1, 3 
+  // and 4, the claims in the directory give tile 0 to the first region only
+
+  Region *region = createRegion(film, 4, crop, 0, 3, claimDir, partName, 0.5, 2.2);
+  Region *other = createRegion(film, 4, NULL, 0, -1, claimDir, otherName, 1.0, 2.0);
+
+  startRegionBand(region, film);
+  startRegionBand(other, film);
+
+  assert(claimRegionTile(region, film, 0) == 1);
+  assert(claimRegionTile(region, film, 1) == 1);
+  assert(claimRegionTile(region, film, 2) == 0);
+  assert(claimRegionTile(region, film, 3) == 1);
+  assert(claimRegionTile(region, film, 4) == 0);
+  assert(claimRegionTile(region, film, 0) == 1);
+  assert(claimRegionTile(other, film, 0) == 0);
+  assert(claimRegionTile(other, film, 4) == 1);
+
+  assert(insideRegion(region, 2, 1) && !insideRegion(region, 7, 3) && !insideRegion(region, 3, 0));
+
+  writeRegionTiles(region, film);
+  assert(closeRegion(region) == 3);
+  closeRegion(other);
+
+  int height, width;
+  double exposure, gamma;
+
+  assert(readPartialFilmHeader(partName, &height, &width, &exposure, &gamma) == 0);
+  assert(height == 10 && width == 9);
+  assert(exposure == 0.5 && gamma == 2.2);
+
+  Film *merged = createFilm(10, 9);
+
+  assert(addPartialFilm(merged, partName) == 3);
+  assert(addPartialFilm(merged, partName) == 3);
+
+  for (int j = 0; j < 10; j++)
+  {
+    for (int i = 0; i < 9; i++)
+    {
+      Pixel *p = &merged->p[j * 9 + i];
+      int inside = i >= 2 && i < 7 && j >= 1 && j < 6 && !(i >= 4 && j >= 4);
+
+      assert(p->wght == (inside ? 2.0 : 0.0));
+      assert(p->c.green == (inside ? 4.0 * j : 0.0));
+    }
+  }
+
+  // A file of another version is rejected
+
+  FILE *fp = fopen(partName, "r+b");
+  fseek(fp, 8, SEEK_SET);
+  fputc(PARTIAL_VERSION + 1, fp);
+  fclose(fp);
+
+  assert(readPartialFilmHeader(partName, &height, &width, &exposure, &gamma) == -2);
+  assert(addPartialFilm(merged, partName) == -1);
+
+  for (int t = 0; t < 5; t++)
+  {
+    char lockName[64];
+    snprintf(lockName, sizeof(lockName), "%s/tile_%d.lock", claimDir, t);
+    remove(lockName);
+  }
+
+  remove(partName);
+  remove(otherName);
+  rmdir(claimDir);
+  free(film);
+  free(merged);
+
+  printf("test_region passed.\n");
+}
+
+// Test the channels, pixel values and EXR output of the output variables
+void test_aovOutput() {
+  Film *film = createFilm(2, 3);
+  AOVFilm *aov = createAOVFilm(AOV_MATERIAL | AOV_ALBEDO | AOV_LIGHTS, 2, film);
+
+  // The material ID comes with the depth: Z, materialID, albedo, 2 lights
+
+  assert(aov->flags & AOV_DEPTH);
+  assert(aov->channels == 1 + 1 + 3 + 2);
+
+  char name[16];
+
+  getAOVChannelName(aov, 0, name, sizeof(name));
+  assert(strcmp(name, "Z") == 0);
+  getAOVChannelName(aov, 6, name, sizeof(name));
+  assert(strcmp(name, "light1") == 0);
+
+  double lights[2];
+  AOVSample sample;
+  sample.lights = lights;
+
+  clearAOVSample(&sample, 2);
+  sample.depth = 5.0;
+  sample.matID = 3;
+  sample.albedo = (Color){255.0, 0.0, 51.0};
+  lights[1] = 0.5;
+
+  Color color = {1.0, 1.0, 1.0};
+
+  addPixelSample(film, 1, 1, &color, 1.0);
+  addAOVSample(aov, 1, 1, &sample);
+
+  clearAOVSample(&sample, 2);
+  sample.depth = 2.0;
+  sample.matID = 7;
+  lights[1] = 0.25;
+
+  addPixelSample(film, 1, 1, &color, 1.0);
+  addAOVSample(aov, 1, 1, &sample);
+
+  float values[7];
+
+  getAOVPixel(aov, film, 1, 1, values);
+
+  assert(values[0] == 2.0f && values[1] == 7.0f);
+  assert(values[2] == 0.5f && values[3] == 0.0f && fabs(values[4] - 0.1f) < 1e-6);
+  assert(values[5] == 0.0f && values[6] == 0.375f);
+
+  getAOVPixel(aov, film, 0, 0, values);
+
+  assert(isinf(values[0]) && values[1] == -1.0f && values[6] == 0.0f);
+
+  AOVWriter *writer = openAOVWriter(aov, film->height, "test_aov.exr");
+
+  assert(writer != NULL);
+
+  // Alphabetical order: Z, albedo.B, albedo.G, albedo.R, light0, light1,
+  // materialID
+
+  const int order[7] = {0, 4, 3, 2, 5, 6, 1};
+
+  for (int c = 0; c < 7; c++)
+  {
+    assert(writer->order[c] == order[c]);
+  }
+
+  writeAOVRows(writer, aov, film);
+  closeAOVWriter(writer);
+
+  FILE *fp = fopen("test_aov.exr", "rb");
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fclose(fp);
+
+  assert(size > 2 * (8 + 8 + 7 * 3 * 4));
+
+  remove("test_aov.exr");
+  free(aov);
+  free(film);
+
+  printf("test_aovOutput passed.\n");
+}
+
+// Test that the output variables of a tile reach the planes and a checkpoint
+// only with its colours, so that a resumed render adds an unfinished tile once
+void test_aovCheckpoint() {
+  Film *film = createFilm(8, 8);
+  AOVFilm *aov = createAOVFilm(AOV_DEPTH | AOV_ALBEDO, 0, film);
+  Checkpoint *checkpoint = createCheckpoint("test_aov.ckpt", 0.0, film, 16, 4);
+
+  checkpoint->aovData = aov->p;
+  checkpoint->aovSize = 8L * 8 * aov->channels;
+
+  Tile *tile = createTile(4);
+  AOVFilm *aovTile = createAOVTile(aov, 4);
+
+  AOVSample sample;
+  clearAOVSample(&sample, 0);
+  sample.depth = 3.0;
+  sample.albedo = (Color){255.0, 0.0, 51.0};
+
+  Color color = {1.0, 1.0, 1.0};
+
+  startCheckpointPass(checkpoint, 0, 0);
+
+  // Tile 0 is finished, tile 3 is still being traced when the checkpoint is
+  // written
+
+  startTile(tile, film, 4, 0);
+  startAOVTile(aovTile, tile);
+  addTileSample(tile, 1, 2, &color, 1.0);
+  addAOVSample(aovTile, 1, 2, &sample);
+  flushPreviewTile(NULL, film, tile, aov, aovTile, 0);
+  finishCheckpointTile(checkpoint, film, 0, 1, 1);
+
+  startTile(tile, film, 4, 3);
+  startAOVTile(aovTile, tile);
+  assert(aovTile->x0 == 4 && aovTile->y0 == 4);
+  addTileSample(tile, 5, 6, &color, 1.0);
+  addAOVSample(aovTile, 5, 6, &sample);
+
+  float values[4];
+
+  getAOVPixel(aov, film, 5, 6, values);
+  assert(isinf(values[0]) && values[1] == 0.0f);
+
+  assert(writeCheckpoint(checkpoint, film) == 0);
+
+  Film *resumed = createFilm(8, 8);
+  AOVFilm *resumedAOV = createAOVFilm(AOV_DEPTH | AOV_ALBEDO, 0, resumed);
+  Checkpoint *other = createCheckpoint("test_aov.ckpt", 0.0, resumed, 16, 4);
+
+  other->aovData = resumedAOV->p;
+  other->aovSize = checkpoint->aovSize;
+
+  assert(readCheckpoint(other, resumed) == 1);
+  assert(other->tileDone[0] && !other->tileDone[3]);
+
+  getAOVPixel(resumedAOV, resumed, 1, 2, values);
+  assert(values[0] == 3.0f && values[1] == 1.0f && fabs(values[3] - 0.2f) < 1e-6);
+
+  // The resumed render traces tile 3 again and gets the same pixel as an
+  // uninterrupted one
+
+  startTile(tile, resumed, 4, 3);
+  startAOVTile(aovTile, tile);
+  addTileSample(tile, 5, 6, &color, 1.0);
+  addAOVSample(aovTile, 5, 6, &sample);
+  flushPreviewTile(NULL, resumed, tile, resumedAOV, aovTile, 3);
+
+  getAOVPixel(resumedAOV, resumed, 5, 6, values);
+  assert(values[0] == 3.0f && values[1] == 1.0f && fabs(values[3] - 0.2f) < 1e-6);
+
+  remove("test_aov.ckpt");
+  freeCheckpoint(checkpoint);
+  freeCheckpoint(other);
+  free(aovTile);
+  free(tile);
+  free(resumedAOV);
+  free(aov);
+  free(resumed);
+  free(film);
+
+  printf("test_aovCheckpoint passed.\n");
+}
+
+// Test that the denoiser removes noise without mixing different albedos
+void test_denoise() {
+  Film *film = createFilm(8, 16);
+  AOVFilm *aov = createAOVFilm(DENOISE_FEATURES, 0, film);
+
+  // Two flat regions that differ only in albedo, with a noisy light: white
+  // on the left and green on the right
+
+  AOVSample sample;
+  double error = 0.0;
+
+  for (int j = 0; j < 8; j++)
+  {
+    for (int i = 0; i < 16; i++)
+    {
+      double noise = ((i * 7 + j * 3) % 5 - 2) * 10.0;
+      double green = 100.0 + noise;
+      double red = (i < 8) ? green : 0.0;
+
+      for (int s = -1; s <= 1; s += 2)
+      {
+        Color color = {red + (red > 0.0) * s * 10.0, green + s * 10.0, red + (red > 0.0) * s * 10.0};
+
+        clearAOVSample(&sample, 0);
+        sample.depth = 4.0;
+        sample.normal = (Vec3){0.0, 0.0, 1.0};
+        sample.albedo = (i < 8) ? (Color){255.0, 255.0, 255.0} : (Color){0.0, 255.0, 0.0};
+
+        addPixelSample(film, i, j, &color, 1.0);
+        addAOVSample(aov, i, j, &sample);
+      }
+
+      error += fabs(noise);
+    }
+  }
+
+  denoiseFilm(film, aov, 3);
+
+  double denoised = 0.0;
+
+  for (int j = 0; j < 8; j++)
+  {
+    for (int i = 0; i < 16; i++)
+    {
+      Pixel *p = &film->p[j * 16 + i];
+
+      assert(p->wght == 2.0f);
+
+      denoised += fabs(p->c.green / p->wght - 100.0);
+
+      // The filter does not mix the two albedos
+
+      if (i >= 8)
+      {
+        assert(fabs(p->c.red) < 1e-3);
+      }
+      else
+      {
+        assert(fabs(p->c.red - p->c.green) < 1e-3);
+      }
+    }
+  }
+
+  assert(denoised < 0.25 * error);
+
+  free(aov);
+  free(film);
+
+  printf("test_denoise passed.\n");
+}
+// Test the tile order, the snapshot and the file of the preview
+void test_preview() {
+  Film *film = createFilm(24, 20);
+
+  // 2 x 3 tiles of 10 pixels, the two middle tiles first
+
+  int order[6];
+
+  getCentreOutTileOrder(film, 10, order);
+
+  assert(order[0] == 2 && order[1] == 3);
+  assert(order[2] == 0 && order[3] == 1 && order[4] == 4 && order[5] == 5);
+
+  Preview *preview = createPreview("test_preview.bmp", 0.0, film, 10, 1.0, 2.0);
+
+  assert(preview->blocksX == 3 && preview->blocksY == 3);
+
+  int i, j;
+
+  getPreviewBlockPixel(preview, 8, &i, &j);
+
+  assert(i == 19 && j == 20);
+
+  for (int b = 0; b < 9; b++)
+  {
+    preview->blocks[b] = (Color){b, b, b};
+  }
+
+  Color color = {50.0, 60.0, 70.0};
+  Tile *tile = createTile(10);
+
+  startTile(tile, film, 10, 0);
+  addTileSample(tile, 3, 2, &color, 1.0);
+  flushPreviewTile(preview, film, tile, NULL, NULL, 0);
+
+  assert(film->p[2 * 20 + 3].c.red == 50.0);
+
+  assert(takePreviewSnapshot(preview, film) == 1);
+
+  preview->interval = 1.0e3;
+  assert(takePreviewSnapshot(preview, film) == 0);
+
+  writePreview(preview);
+
+  // The pixel with a sample keeps it, the others get the color of their block
+
+  assert(preview->film->p[2 * 20 + 3].c.red == 50.0);
+  assert(preview->film->p[20 * 20 + 19].c.red == 8.0);
+  assert(preview->film->p[20 * 20 + 19].wght == 1.0);
+
+  FILE *fp = fopen("test_preview.bmp", "rb");
+
+  assert(fp != NULL);
+
+  fseek(fp, 0, SEEK_END);
+  assert(ftell(fp) == 54 + 24 * 60);
+  fclose(fp);
+
+  remove("test_preview.bmp");
+  freePreview(preview);
+  free(tile);
+  free(film);
+
+  printf("test_preview passed.\n");
+}
+
+// Test the stratified base pattern of the soft shadow rays
+void test_shadowOffsets() {
+  Vec3 offsets[8];
+  int countX[8] = {0};
+  int countY[8] = {0};
+
+  createShadowOffsets(offsets, 8);
+
+  for (int i = 0; i < 8; i++)
+  {
+    assert(offsets[i].z >= 0.0 && offsets[i].z < 1.0);
+
+    countX[(int)(8 * offsets[i].x)]++;
+    countY[(int)(8 * offsets[i].y)]++;
+  }
+
+  for (int i = 0; i < 8; i++)
+  {
+    assert(countX[i] == 1);
+    assert(countY[i] == 1);
+  }
+
+  printf("test_shadowOffsets passed.\n");
+}
+
+// Test the batched generation of camera rays against the single rays
+void test_cameraRayRow() {
+  CameraData cam;
+  cam.origin = (Vec3){-10.0, 0.0, 2.0};
+  cam.tilt = (Vec3){5.0, 10.0, 0.0};
+  cam.fov = 20.0;
+  cam.focal_length = 10.0;
+  cam.aperture = 0.1;
+
+  Film *film = createFilm(20, 30);
+  initialiseCamera(&cam, film);
+
+  Sampler sampler;
+  initSampler(&sampler, SAMPLER_SOBOL, 4);
+  startSample(&sampler, 0, 3);
+
+  RayBatch batch;
+  generateCameraRayRow(&batch, 5, 7, 16, &sampler, &cam);
+
+  assert(batch.count == 16 && batch.mask == RAY_CAMERA);
+
+  // The sampler of the caller still points at its own pixel
+
+  assert(sampler.pixel == 0 && sampler.sample == 3);
+
+  for (int i = 0; i < batch.count; i++)
+  {
+    double u, v, lu, lv;
+    Ray ray;
+
+    startSample(&sampler, 7 * 30 + 5 + i, 3);
+    getSample2D(&sampler, SAMPLER_DIM_PIXEL, &u, &v);
+    getSample2D(&sampler, SAMPLER_DIM_LENS, &lu, &lv);
+
+    generateCameraRay(&ray, 5 + i, 7, u, v, lu, lv, &cam);
+
+    assert(fabs(ray.o.x - batch.ox[i]) < 1.0e-12 && fabs(ray.o.z - batch.oz[i]) < 1.0e-12);
+    assert(fabs(ray.d.x - batch.dx[i]) < 1.0e-12);
+    assert(fabs(ray.d.y - batch.dy[i]) < 1.0e-12);
+    assert(fabs(ray.d.z - batch.dz[i]) < 1.0e-12);
+  }
+
+  // The lens offset is perpendicular to the viewing direction
+
+  Ray centre, lens;
+  generateCameraRay(&centre, 15, 10, 0.0, 0.0, 0.5, 0.5, &cam);
+  generateCameraRay(&lens, 15, 10, 0.0, 0.0, 0.9, 0.2, &cam);
+
+  Vec3 offset = addVector(1.0, &lens.o, -1.0, &centre.o);
+  double cy = cos(10.0 * M_PI / 180.0), sy = sin(10.0 * M_PI / 180.0);
+  double cx = cos(5.0 * M_PI / 180.0), sx = sin(5.0 * M_PI / 180.0);
+  Vec3 forward = {cy, sx * sy, cx * sy};
+
+  assert(length(&offset) > 0.0);
+  assert(fabs(dotProduct(&offset, &forward)) < 1.0e-12);
+
+  free(film);
+
+  printf("test_cameraRayRow passed.\n");
+}
+
+// Test that an invalid number of shadow samples is replaced by the default
+void test_spotlightSamples() {
+  Spotlights spotlights;
+  FILE *fin = tmpfile();
+
+  fprintf(fin, "Samples 0\n1\n0 0 4 0 0 -1 1 10 0.1\n");
+  rewind(fin);
+
+  readSpotlightData(fin, &spotlights);
+
+  assert(spotlights.samples == SHADOW_SAMPLES);
+  assert(spotlights.count == 1);
+
+  fclose(fin);
+  free(spotlights.spotlight);
+
+  printf("test_spotlightSamples passed.\n");
+}
+
+// Test the culling and sampling of spotlights with the light BVH
+void test_lightBVH() {
+  Spotlights spotlights;
+  spotlights.spotlight = (Spotlight *)malloc(8 * sizeof(Spotlight));
+  spotlights.count = 0;
+  spotlights.radius = 0.05;
+
+  // a row of spotlights pointing down, with a cone of 10 degrees
+
+  for (int i = 0; i < 8; i++)
+  {
+    addLight(&spotlights, (Vec3){2.0 * i, 0.0, 4.0}, (Vec3){0.0, 0.0, -1.0}, 1.0, 10.0, 0.1);
+  }
+
+  LightBVH *lbvh = createLightBVH(&spotlights);
+
+  assert(lbvh->nodeCount == 15);
+
+  int lights[8];
+  Vec3 point = {6.0, 0.0, 0.0};
+  Vec3 normal = {0.0, 0.0, 1.0};
+
+  int count = collectLights(lbvh, &point, &normal, lights);
+
+  assert(count == 1 && lights[0] == 3);
+
+  double pdf;
+  assert(sampleLight(lbvh, &point, &normal, 0.7, &pdf) == 3);
+  assert(fabs(pdf - 1.0) < 1.0e-12);
+
+  // facing away from the lights
+
+  normal.z = -1.0;
+  assert(collectLights(lbvh, &point, &normal, lights) == 0);
+  assert(sampleLight(lbvh, &point, &normal, 0.5, &pdf) == -1);
+
+  // far below the lights, every cone contains the point
+
+  point = (Vec3){7.0, 0.0, -400.0};
+  normal.z = 1.0;
+  assert(collectLights(lbvh, &point, &normal, lights) == 8);
+
+  freeLightBVH(lbvh);
+  free(spotlights.spotlight);
+
+  printf("test_lightBVH passed.\n");
+}
+
+// Test the classification of points with the sun map
+void test_sunMap() {
+  SunMap map;
+  float depth[64];
+
+  map.e1 = (Vec3){1.0, 0.0, 0.0};
+  map.e2 = (Vec3){0.0, 1.0, 0.0};
+  map.d = (Vec3){0.0, 0.0, 1.0};
+  map.originDepth = 10.0;
+  map.u0 = 0.0;
+  map.v0 = 0.0;
+  map.texel = 1.0;
+  map.size = 8;
+  map.depth = depth;
+
+  // a ground plane at z = 0 with an occluder at z = 5 above texels 3..5
+
+  for (int j = 0; j < 8; j++)
+  {
+    for (int i = 0; i < 8; i++)
+    {
+      depth[j * 8 + i] = (i >= 3 && i <= 5 && j >= 3 && j <= 5) ? 5.0 : 10.0;
+    }
+  }
+
+  Vec3 up = {0.0, 0.0, 1.0};
+  Vec3 down = {0.0, 0.0, -1.0};
+
+  Vec3 lit = {1.5, 1.5, 0.0};
+  Vec3 shadow = {4.5, 4.5, 0.0};
+  Vec3 edge = {2.5, 4.5, 0.0};
+  Vec3 outside = {0.5, 4.5, 0.0};
+  Vec3 top = {4.5, 4.5, 5.0};
+
+  assert(lookupSunMap(&map, &lit, &up) == 1);
+  assert(lookupSunMap(&map, &shadow, &up) == 0);
+  assert(lookupSunMap(&map, &edge, &up) == -1);
+  assert(lookupSunMap(&map, &outside, &up) == -1);
+  assert(lookupSunMap(&map, &top, &up) == 1);
+  assert(lookupSunMap(&map, &lit, &down) == 0);
+
+  // a map without texels inside the border is disabled
+
+  Settings settings;
+  FILE *fin = tmpfile();
+
+  fprintf(fin, "SunMap 4\nEnd\n");
+  rewind(fin);
+
+  initSettings(&settings);
+  readSettingsData(fin, &settings);
+  fclose(fin);
+
+  assert(settings.sunMapSize == 0);
+
+  printf("test_sunMap passed.\n");
+}
+
+// Test the reuse of the light in the cells of the radiance cache
+void test_radianceCache() {
+  RadianceCache *cache = createRadianceCache(0.1, 0.01);
+
+  Vec3 up = {0.0, 0.0, 1.0};
+  Vec3 side = {1.0, 0.0, 0.0};
+  Vec3 p = {0.52, 0.33, 0.01};
+  Vec3 q = {0.58, 0.37, 0.09};
+  Vec3 edge = {1.25, 0.25, 0.05};
+  Vec3 frozen = {-2.05, 3.15, 0.05};
+  double light;
+
+  assert(lookupRadianceCache(cache, &p, &up, &light) == 0);
+
+  for (int i = 0; i < RADIANCE_CACHE_MIN - 1; i++)
+  {
+    addRadianceCache(cache, &p, &up, 0.5);
+  }
+
+  assert(lookupRadianceCache(cache, &p, &up, &light) == 0);
+
+  addRadianceCache(cache, &q, &up, 0.5);
+
+  // q lies in the same cell as p, but not with a different normal
+
+  assert(lookupRadianceCache(cache, &p, &up, &light) == 1);
+  assert(fabs(light - 0.5) < 1.0e-3);
+  assert(lookupRadianceCache(cache, &q, &up, &light) == 1);
+  assert(lookupRadianceCache(cache, &p, &side, &light) == 0);
+
+  // a cell on a shadow edge is never reused
+
+  for (int i = 0; i < 2 * RADIANCE_CACHE_MIN; i++)
+  {
+    addRadianceCache(cache, &edge, &up, (double)(i % 2));
+  }
+
+  assert(lookupRadianceCache(cache, &edge, &up, &light) == 0);
+
+  // the samples after RADIANCE_CACHE_MAX do not change the entry
+
+  for (int i = 0; i < RADIANCE_CACHE_MAX + 10; i++)
+  {
+    addRadianceCache(cache, &frozen, &up, i < RADIANCE_CACHE_MAX ? 0.2 : 0.9);
+  }
+
+  assert(lookupRadianceCache(cache, &frozen, &up, &light) == 1);
+  assert(fabs(light - 0.2) < 1.0e-3);
+
+  // points far outside the range of the grid share the outermost cells
+
+  Vec3 far = {1.0e300, -1.0e300, 0.0};
+  Vec3 farEdge = {(double)INT_MAX, (double)INT_MIN, 0.05};
+
+  for (int i = 0; i < RADIANCE_CACHE_MIN; i++)
+  {
+    addRadianceCache(cache, &far, &up, 0.4);
+  }
+
+  assert(lookupRadianceCache(cache, &farEdge, &up, &light) == 1);
+  assert(fabs(light - 0.4) < 1.0e-3);
+
+  long hits, misses;
+  getRadianceCacheCounters(&hits, &misses);
+  assert(hits == 4 && misses == 4);
+
+  freeRadianceCache(cache);
+
+  printf("test_radianceCache passed.\n");
+}
+
 int main( void )
 
 {
@@ -173,6 +1385,29 @@ int main( void )
   test_computeSphereAABB();
   test_computeCentroidAABB();
   test_traverseBVH();
+  test_planes();
+  test_compactMesh();
+  test_reorderMesh();
+  test_projectedSize();
+  test_random();
+  test_sampler();
+  test_pixelError();
+  test_tiles();
+  test_hdrOutput();
+  test_filmBands();
+  test_pngOutput();
+  test_checkpoint();
+  test_region();
+  test_aovOutput();
+  test_aovCheckpoint();
+  test_denoise();
+  test_preview();
+  test_shadowOffsets();
+  test_cameraRayRow();
+  test_spotlightSamples();
+  test_lightBVH();
+  test_sunMap();
+  test_radianceCache();
 
   printf("Image generated!!\n");
 }
@@ -0,0 +1,206 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include "lod.h"
+
+const char *LEVEL        = "Level";
+const char *SHADOWOFFSET = "ShadowOffset";
+
+
+//------------------------------------------------------------------------------
+//  readLODData: Reads one LOD object from a file
+//------------------------------------------------------------------------------
+
+
+void readLODData
+
+  ( FILE*         fin  ,
+    LODObjects*   lods )
+
+{
+  char label[20] = "None";
+
+  if ( lods->count >= MAX_LOD_OBJECTS )
+  {
+    printf("ERROR: Maximum number of LOD objects (%d) reached\n",MAX_LOD_OBJECTS);
+    return;
+  }
+
+  LODObject *obj = &lods->object[lods->count++];
+
+  obj->levelCount   = 0;
+  obj->shadowOffset = 0;
+
+  fscanf( fin , "%s" , label );
+
+  while( strcmp( label , "End" ) != 0 )
+  {
+    if( strcmp( label , LEVEL ) == 0 && obj->levelCount < MAX_LOD_LEVELS )
+    {
+      LODLevel *level = &obj->level[obj->levelCount++];
+
+      fscanf( fin , "%39s %le" , level->filename , &level->minSize );
+    }
+    else if ( strcmp( label , SHADOWOFFSET ) == 0 )
+    {
+      fscanf( fin , "%d" , &obj->shadowOffset );
+    }
+
+    fscanf( fin , "%s" , label );
+  }
+
+  printf("  LOD OBJECT %d\n",lods->count-1);
+
+  for ( int i = 0 ; i < obj->levelCount ; i++ )
+  {
+    printf("    Level %d ................. : %s (from %g px)\n",i,
+                                obj->level[i].filename,obj->level[i].minSize);
+  }
+
+  printf("    Shadow level offset ..... : %d\n\n",obj->shadowOffset);
+}
+
+
+//------------------------------------------------------------------------------
+//  projectedSize: Returns the height of a bounding sphere in the image
+//------------------------------------------------------------------------------
+
+
+double projectedSize
+
+  ( Vec3          centre ,
+    double        radius ,
+    CameraData*   cam    )
+
+{
+  Vec3 rel = addVector( 1.0 , &centre , -1.0 , &cam->origin );
+
+  double dist = length( &rel );
+
+  if ( dist <= radius )
+  {
+    return DBL_MAX;
+  }
+
+  // cam->dx is the size of a pixel at unit distance from the camera
+
+  return 2.0 * radius / ( dist * cam->dx );
+}
+
+
+//------------------------------------------------------------------------------
+//  selectLODLevels: Selects the level of each LOD object
+//------------------------------------------------------------------------------
+
+
+void selectLODLevels
+
+  ( LODObjects*   lods ,
+    CameraData*   cam  ,
+    Mesh*         mesh )
+
+{
+  for ( int iObj = 0 ; iObj < lods->count ; iObj++ )
+  {
+    LODObject *obj = &lods->object[iObj];
+
+    if ( obj->levelCount == 0 )
+    {
+      continue;
+    }
+
+    // The bounds of the object are taken from the coarsest level
+
+    int  coarse = obj->levelCount - 1;
+    Mesh levelMesh;
+
+    initMesh( &levelMesh );
+
+    if ( !readMeshFile( obj->level[coarse].filename , &levelMesh ) )
+    {
+      continue;
+    }
+
+    Vec3 bmin = {DBL_MAX, DBL_MAX, DBL_MAX};
+    Vec3 bmax = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+
+    for ( int i = 0 ; i < levelMesh.vertexCount ; i++ )
+    {
+      bmin = minVector( 1.0 , &bmin , 1.0 , &levelMesh.vertices[i] );
+      bmax = maxVector( 1.0 , &bmax , 1.0 , &levelMesh.vertices[i] );
+    }
+
+    Vec3   centre = addVector( 0.5 , &bmin , 0.5 , &bmax );
+    Vec3   diag   = addVector( 1.0 , &bmax , -1.0 , &bmin );
+    double size   = projectedSize( centre , 0.5 * length( &diag ) , cam );
+
+    int camLevel = coarse;
+
+    for ( int i = coarse ; i >= 0 ; i-- )
+    {
+      if ( size >= obj->level[i].minSize )
+      {
+        camLevel = i;
+      }
+    }
+
+    int shadowLevel = camLevel + obj->shadowOffset;
+
+    if ( shadowLevel > coarse )
+    {
+      shadowLevel = coarse;
+    }
+
+    printf("    LOD object %d ............ : %g px, level %d, shadow level %d\n",
+                                         iObj,size,camLevel,shadowLevel);
+
+    int levels[2] = { camLevel , shadowLevel };
+    int masks[2]  = { RAY_CAMERA | RAY_SHADOW , 0 };
+
+    if ( shadowLevel != camLevel )
+    {
+      // Append the level that is already in memory first
+
+      levels[0] = ( shadowLevel == coarse ) ? shadowLevel : camLevel;
+      levels[1] = ( shadowLevel == coarse ) ? camLevel    : shadowLevel;
+      masks[0]  = ( shadowLevel == coarse ) ? RAY_SHADOW  : RAY_CAMERA;
+      masks[1]  = ( shadowLevel == coarse ) ? RAY_CAMERA  : RAY_SHADOW;
+    }
+
+    for ( int k = 0 ; k < 2 ; k++ )
+    {
+      if ( masks[k] == 0 )
+      {
+        continue;
+      }
+
+      if ( levels[k] != coarse )
+      {
+        freeMesh( &levelMesh );
+        initMesh( &levelMesh );
+
+        if ( !readMeshFile( obj->level[levels[k]].filename , &levelMesh ) )
+        {
+          continue;
+        }
+
+        coarse = levels[k];
+      }
+
+      appendMesh( mesh , &levelMesh , masks[k] );
+    }
+
+    freeMesh( &levelMesh );
+  }
+}
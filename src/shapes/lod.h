@@ -0,0 +1,125 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef SHAPES_LOD_H
+#define SHAPES_LOD_H
+
+#include <stdio.h>
+#include "mesh.h"
+#include "../camera/camera.h"
+
+#define MAX_LOD_OBJECTS 10
+#define MAX_LOD_LEVELS  4
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the LODLevel type (one mesh variant of an object)
+//      filename : Input file that contains the vertices and faces
+//      minSize  : The level is used when the object is at least this many
+//                 pixels high in the image
+//------------------------------------------------------------------------------
+
+
+typedef struct 
+{
+  char       filename[40];
+  double     minSize;
+} LODLevel;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the LODObject type (an object with several levels of detail,
+//  ordered from fine to coarse)
+//      shadowOffset : Shadow rays use a level that is this many steps coarser
+//                     than the level that is seen by the camera
+//------------------------------------------------------------------------------
+
+
+typedef struct 
+{
+  LODLevel   level[MAX_LOD_LEVELS];
+  int        levelCount;
+  int        shadowOffset;
+} LODObject;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the LODObjects type (a collection of LOD objects)
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  LODObject  object[MAX_LOD_OBJECTS];
+  int        count;
+} LODObjects;
+
+
+//------------------------------------------------------------------------------
+//  readLODData: Reads one LOD object from a file
+//
+//  Arguments:
+//      fin     : File pointer to the file that contains the LOD data
+//      lods    : Pointer to the LOD objects
+//
+//------------------------------------------------------------------------------
+
+
+void readLODData
+
+  ( FILE*          fin  ,
+    LODObjects*    lods );
+
+
+//------------------------------------------------------------------------------
+//  projectedSize: Returns the height of a bounding sphere in the image
+//
+//  Arguments:
+//      centre  : Centre of the bounding sphere
+//      radius  : Radius of the bounding sphere
+//      cam     : Pointer to the (initialised) camera
+//
+//  Return:
+//      double  : the height in pixels
+//
+//------------------------------------------------------------------------------
+
+
+double projectedSize
+
+  ( Vec3           centre ,
+    double         radius ,
+    CameraData*    cam    );
+
+
+//------------------------------------------------------------------------------
+//  selectLODLevels: Selects the level of each LOD object based on its size in
+//                   the image and appends the selected meshes to the mesh.
+//                   Levels that are not selected are never kept in memory.
+//
+//  Arguments:
+//      lods    : Pointer to the LOD objects
+//      cam     : Pointer to the (initialised) camera
+//      mesh    : Pointer to the mesh of the scene
+//
+//------------------------------------------------------------------------------
+
+
+void selectLODLevels
+
+  ( LODObjects*    lods ,
+    CameraData*    cam  ,
+    Mesh*          mesh );
+
+
+#endif
+
+
@@ -13,7 +13,40 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
 #include "mesh.h"
+#include "../util/mathutils.h"
+
+
+//------------------------------------------------------------------------------
+//  initMesh: Initialises an empty mesh
+//------------------------------------------------------------------------------
+
+
+void initMesh
+
+  ( Mesh*       mesh )
+
+{
+  mesh->vertexCount   = 0;
+  mesh->faceCount     = 0;
+
+  mesh->vertices      = NULL;
+  mesh->normals       = NULL;
+  mesh->faces         = NULL;
+
+  mesh->compact       = 0;
+  mesh->cVertices     = NULL;
+  mesh->cNormals      = NULL;
+  mesh->cIndices      = NULL;
+  mesh->cMatIDs       = NULL;
+
+  mesh->faceOrigIDs   = NULL;
+  mesh->vertexOrigIDs = NULL;
+  mesh->faceMasks     = NULL;
+}
 
 
 //------------------------------------------------------------------------------
@@ -82,12 +115,108 @@ void readFaceData
     addFace( mesh , face , nVer , matID );
   }
 
-  addFaceNormals( mesh );
-
   printf("    Number of faces ......... : %d\n",nFac);
 }
 
 
+//-----------------------------------------------------------------------------
+//  readMeshFile: Reads the vertices and faces from an input file
+//-----------------------------------------------------------------------------
+
+
+int readMeshFile
+
+  ( char*       fileName ,
+    Mesh*       mesh     )
+
+{
+  FILE *fin;
+
+  if ( ( fin = fopen( fileName , "r" ) ) == NULL ) 
+  {
+    printf("Cannot open mesh file %s.\n",fileName);
+    return 0;
+  }
+
+  char label[40];
+
+  printf("    Mesh file ............... : %s\n",fileName);
+
+  while( fscanf( fin , "%39s" , label ) == 1 && strcmp( label , "EndInput" ) != 0 )
+  {
+    if ( strcmp( label , "Vertices" ) == 0 )
+    {
+      readVertexData( fin , mesh );
+    }
+    else if ( strcmp( label , "Faces" ) == 0 )
+    {
+      readFaceData( fin , mesh );
+    }
+  }
+
+  fclose( fin );
+
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+//  appendMesh: Appends the vertices and faces of a mesh to another mesh
+//-----------------------------------------------------------------------------
+
+
+void appendMesh
+
+  ( Mesh*       mesh ,
+    Mesh*       part ,
+    int         mask )
+
+{
+  int nVer = mesh->vertexCount + part->vertexCount;
+  int nFac = mesh->faceCount   + part->faceCount;
+
+  mesh->vertices = (Vec3*)realloc( mesh->vertices , nVer * sizeof(Vec3) );
+  mesh->normals  = (Vec3*)realloc( mesh->normals  , nVer * sizeof(Vec3) );
+  mesh->faces    = (FaceData*)realloc( mesh->faces , nFac * sizeof(FaceData) );
+
+  if ( mask != ( RAY_CAMERA | RAY_SHADOW ) && mesh->faceMasks == NULL )
+  {
+    mesh->faceMasks = (unsigned char*)malloc( nFac * sizeof(unsigned char) );
+
+    memset( mesh->faceMasks , RAY_CAMERA | RAY_SHADOW , mesh->faceCount );
+  }
+  else if ( mesh->faceMasks != NULL )
+  {
+    mesh->faceMasks = (unsigned char*)realloc( mesh->faceMasks , nFac * sizeof(unsigned char) );
+  }
+
+  for ( int i = 0 ; i < part->vertexCount ; i++ )
+  {
+    mesh->vertices[mesh->vertexCount+i] = part->vertices[i];
+  }
+
+  for ( int i = 0 ; i < part->faceCount ; i++ )
+  {
+    FaceData *face = &mesh->faces[mesh->faceCount+i];
+
+    *face = part->faces[i];
+
+    for ( int j = 0 ; j < face->vertexCount ; j++ )
+    {
+      face->vertexIDs[j] += mesh->vertexCount;
+    }
+
+    if ( mesh->faceMasks != NULL )
+    {
+      mesh->faceMasks[mesh->faceCount+i] = (unsigned char)mask;
+    }
+  }
+
+  mesh->vertexCount = nVer;
+  mesh->faceCount   = nFac;
+}
+
+
 //-----------------------------------------------------------------------------
 //  getFace: Returns the face with the given face ID from the mesh
 //-----------------------------------------------------------------------------
@@ -102,6 +231,23 @@ void getFace
 {
   int i,iCrd;
 
+  if ( mesh->compact )
+  {
+    face->matID       = mesh->cMatIDs[faceID];
+    face->vertexCount = 3;
+
+    for ( i = 0 ; i < 3 ; i++ )
+    {
+      Vec3f *v = &mesh->cVertices[mesh->cIndices[3*faceID+i]];
+
+      face->vertices[i].x = v->x;
+      face->vertices[i].y = v->y;
+      face->vertices[i].z = v->z;
+    }
+
+    return;
+  }
+
   face->matID       = mesh->faces[faceID].matID;
   face->vertexCount = mesh->faces[faceID].vertexCount;
   
@@ -170,15 +316,20 @@ int addFace
 //-----------------------------------------------------------------------------
 
 
-void addFaceNormals(Mesh* mesh) {
-  int vertexID;
+void addFaceNormals
 
-  for (int i = 0; i < mesh->vertexCount; i++)
-  {
-    mesh->normals[i] = (Vec3){0.0, 0.0, 0.0};
-  }
+  ( Mesh*    mesh )
 
-  for (int i = 0; i < mesh->faceCount; i++)
+{
+  int nVer = mesh->vertexCount;
+  int nFac = mesh->faceCount;
+
+  // Unit normal of each face (in parallel)
+
+  Vec3 *faceNormals = (Vec3*)malloc( nFac * sizeof(Vec3) );
+
+#pragma omp parallel for schedule(static)
+  for ( int i = 0 ; i < nFac ; i++ )
   {
     int* vertexIDs = mesh->faces[i].vertexIDs;
 
@@ -186,26 +337,72 @@ void addFaceNormals(Mesh* mesh) {
     Vec3 v2 = mesh->vertices[vertexIDs[1]];
     Vec3 v3 = mesh->vertices[vertexIDs[2]];
 
-    Vec3 a = addVector(1.0, &v2, -1.0, &v1);
-    Vec3 b = addVector(1.0, &v3, -1.0, &v1);
+    Vec3 a = addVector( 1.0 , &v2 , -1.0 , &v1 );
+    Vec3 b = addVector( 1.0 , &v3 , -1.0 , &v1 );
+
+    crossProduct( &faceNormals[i] , &a , &b );
+    unit( &faceNormals[i] );
+  }
+
+  // Vertex-to-face map in compressed row storage: the faces of vertex i are
+  // faceIDs[offsets[i]] ... faceIDs[offsets[i+1]-1]
+
+  int *offsets = (int*)calloc( nVer + 1 , sizeof(int) );
+
+  for ( int i = 0 ; i < nFac ; i++ )
+  {
+    for ( int j = 0 ; j < mesh->faces[i].vertexCount ; j++ )
+    {
+      offsets[mesh->faces[i].vertexIDs[j]+1]++;
+    }
+  }
+
+  for ( int i = 0 ; i < nVer ; i++ )
+  {
+    offsets[i+1] += offsets[i];
+  }
 
-    Vec3 faceNormal;
-    crossProduct(&faceNormal, &a, &b);
-    unit(&faceNormal);
+  int *fill    = (int*)malloc( nVer * sizeof(int) );
+  int *faceIDs = (int*)malloc( offsets[nVer] * sizeof(int) );
 
-    double weight = 0.5*length(&faceNormal);
+  for ( int i = 0 ; i < nVer ; i++ )
+  {
+    fill[i] = offsets[i];
+  }
 
-    for (int j = 0; j < mesh->faces[i].vertexCount; j++)
+  for ( int i = 0 ; i < nFac ; i++ )
+  {
+    for ( int j = 0 ; j < mesh->faces[i].vertexCount ; j++ )
     {
-      vertexID = vertexIDs[j];
-      mesh->normals[vertexID] = addVector(1.0, &mesh->normals[vertexID], weight, &faceNormal);
+      faceIDs[fill[mesh->faces[i].vertexIDs[j]]++] = i;
     }
   }
 
-  for (int i = 0; i < mesh->vertexCount; i++)
+  // Each vertex gathers the normals of its faces, so that no two threads 
+  // write to the same vertex
+
+#pragma omp parallel for schedule(static)
+  for ( int i = 0 ; i < nVer ; i++ )
   {
-    unit(&mesh->normals[i]);
+    Vec3 normal = {0.0, 0.0, 0.0};
+
+    for ( int k = offsets[i] ; k < offsets[i+1] ; k++ )
+    {
+      normal = addVector( 1.0 , &normal , 0.5 , &faceNormals[faceIDs[k]] );
+    }
+
+    if ( offsets[i+1] > offsets[i] )
+    {
+      unit( &normal );
+    }
+
+    mesh->normals[i] = normal;
   }
+
+  free( faceNormals );
+  free( offsets );
+  free( fill );
+  free( faceIDs );
 }
 
 //-----------------------------------------------------------------------------
@@ -222,8 +419,20 @@ int calcFaceIntersection
     int           iShp      )
 
 {
-  int* vertexIDs = mesh->faces[iShp].vertexIDs;
   Vec3 normals[3];
+
+  if ( mesh->compact )
+  {
+    unsigned int* ids = &mesh->cIndices[3*iShp];
+
+    normals[0] = decodeOctNormal( mesh->cNormals[ids[0]] );
+    normals[1] = decodeOctNormal( mesh->cNormals[ids[1]] );
+    normals[2] = decodeOctNormal( mesh->cNormals[ids[2]] );
+
+    return calcTriangleIntersection( intersect , ray , face, normals, mesh);
+  }
+
+  int* vertexIDs = mesh->faces[iShp].vertexIDs;
   normals[0] = mesh->normals[vertexIDs[0]];
   normals[1] = mesh->normals[vertexIDs[1]];
   normals[2] = mesh->normals[vertexIDs[2]];
@@ -367,6 +576,276 @@ int calcTriangleIntersection
 
    
 
+//------------------------------------------------------------------------------
+//  compareSortKeys: Compares two (Morton code, face ID) pairs
+//------------------------------------------------------------------------------
+
+
+static int compareSortKeys
+
+  ( const void*  a ,
+    const void*  b )
+
+{
+  uint64_t ka = *(const uint64_t*)a;
+  uint64_t kb = *(const uint64_t*)b;
+
+  return ( ka > kb ) - ( ka < kb );
+}
+
+
+//------------------------------------------------------------------------------
+//  reorderMesh: Sorts the faces along a Morton curve and renumbers vertices
+//------------------------------------------------------------------------------
+
+
+void reorderMesh
+
+  ( Mesh*       mesh )
+
+{
+  int nVer = mesh->vertexCount;
+  int nFac = mesh->faceCount;
+
+  Vec3 *centroids = (Vec3*)malloc( nFac * sizeof(Vec3) );
+
+  Vec3 bmin = {DBL_MAX, DBL_MAX, DBL_MAX};
+  Vec3 bmax = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+
+  for ( int i = 0 ; i < nFac ; i++ )
+  {
+    Vec3 c = {0.0, 0.0, 0.0};
+
+    for ( int j = 0 ; j < mesh->faces[i].vertexCount ; j++ )
+    {
+      c = addVector( 1.0 , &c , 1.0 , &mesh->vertices[mesh->faces[i].vertexIDs[j]] );
+    }
+
+    centroids[i] = multiplyVector( 1.0 / mesh->faces[i].vertexCount , &c );
+
+    bmin = minVector( 1.0 , &bmin , 1.0 , &centroids[i] );
+    bmax = maxVector( 1.0 , &bmax , 1.0 , &centroids[i] );
+  }
+
+  Vec3 size = addVector( 1.0 , &bmax , -1.0 , &bmin );
+  double scale = fmax( size.x , fmax( size.y , size.z ) );
+
+  if ( scale <= 0.0 )
+  {
+    scale = 1.0;
+  }
+
+  // Sort keys: Morton code in the upper 32 bits, face ID in the lower 32 bits
+
+  uint64_t *keys = (uint64_t*)malloc( nFac * sizeof(uint64_t) );
+
+#pragma omp parallel for schedule(static)
+  for ( int i = 0 ; i < nFac ; i++ )
+  {
+    unsigned int code = mortonCode( ( centroids[i].x - bmin.x ) / scale ,
+                                    ( centroids[i].y - bmin.y ) / scale ,
+                                    ( centroids[i].z - bmin.z ) / scale );
+
+    keys[i] = ( (uint64_t)code << 32 ) | (uint64_t)i;
+  }
+
+  qsort( keys , nFac , sizeof(uint64_t) , compareSortKeys );
+
+  // Renumber the vertices in order of first use
+
+  FaceData *faces    = (FaceData*)malloc( nFac * sizeof(FaceData) );
+  Vec3     *vertices = (Vec3*)malloc( nVer * sizeof(Vec3) );
+  int      *newIDs   = (int*)malloc( nVer * sizeof(int) );
+
+  mesh->faceOrigIDs   = (int*)malloc( nFac * sizeof(int) );
+  mesh->vertexOrigIDs = (int*)malloc( nVer * sizeof(int) );
+
+  for ( int i = 0 ; i < nVer ; i++ )
+  {
+    newIDs[i] = -1;
+  }
+
+  int count = 0;
+
+  unsigned char *masks = NULL;
+
+  if ( mesh->faceMasks != NULL )
+  {
+    masks = (unsigned char*)malloc( nFac * sizeof(unsigned char) );
+  }
+
+  for ( int i = 0 ; i < nFac ; i++ )
+  {
+    int iOld = (int)( keys[i] & 0xffffffffu );
+
+    faces[i] = mesh->faces[iOld];
+    mesh->faceOrigIDs[i] = iOld;
+
+    if ( masks != NULL )
+    {
+      masks[i] = mesh->faceMasks[iOld];
+    }
+
+    for ( int j = 0 ; j < faces[i].vertexCount ; j++ )
+    {
+      int v = faces[i].vertexIDs[j];
+
+      if ( newIDs[v] < 0 )
+      {
+        newIDs[v] = count;
+        mesh->vertexOrigIDs[count++] = v;
+      }
+
+      faces[i].vertexIDs[j] = newIDs[v];
+    }
+  }
+
+  // Vertices that are not used by any face are kept at the end
+
+  for ( int i = 0 ; i < nVer ; i++ )
+  {
+    if ( newIDs[i] < 0 )
+    {
+      newIDs[i] = count;
+      mesh->vertexOrigIDs[count++] = i;
+    }
+  }
+
+  for ( int i = 0 ; i < nVer ; i++ )
+  {
+    vertices[newIDs[i]] = mesh->vertices[i];
+  }
+
+  free( mesh->faces );
+  free( mesh->vertices );
+
+  mesh->faces    = faces;
+  mesh->vertices = vertices;
+
+  if ( masks != NULL )
+  {
+    free( mesh->faceMasks );
+    mesh->faceMasks = masks;
+  }
+
+  free( centroids );
+  free( keys );
+  free( newIDs );
+}
+
+
+//------------------------------------------------------------------------------
+//  compactMesh: Converts the mesh to the compact representation
+//------------------------------------------------------------------------------
+
+
+void compactMesh
+
+  ( Mesh*       mesh )
+
+{
+  int nVer = mesh->vertexCount;
+  int nFac = mesh->faceCount;
+
+  // Offsets of the triangles of each face (a quad is split in two)
+
+  int *firstTri = (int*)malloc( ( nFac + 1 ) * sizeof(int) );
+
+  firstTri[0] = 0;
+
+  for ( int i = 0 ; i < nFac ; i++ )
+  {
+    firstTri[i+1] = firstTri[i] + mesh->faces[i].vertexCount - 2;
+  }
+
+  int nTri = firstTri[nFac];
+
+  mesh->cVertices = (Vec3f*)malloc( nVer * sizeof(Vec3f) );
+  mesh->cNormals  = (unsigned int*)malloc( nVer * sizeof(unsigned int) );
+  mesh->cIndices  = (unsigned int*)malloc( 3 * nTri * sizeof(unsigned int) );
+  mesh->cMatIDs   = (unsigned char*)malloc( nTri * sizeof(unsigned char) );
+
+#pragma omp parallel for schedule(static)
+  for ( int i = 0 ; i < nVer ; i++ )
+  {
+    mesh->cVertices[i].x = (float)mesh->vertices[i].x;
+    mesh->cVertices[i].y = (float)mesh->vertices[i].y;
+    mesh->cVertices[i].z = (float)mesh->vertices[i].z;
+
+    mesh->cNormals[i] = encodeOctNormal( &mesh->normals[i] );
+  }
+
+#pragma omp parallel for schedule(static)
+  for ( int i = 0 ; i < nFac ; i++ )
+  {
+    FaceData *face = &mesh->faces[i];
+
+    // Same triangulation as in calcFaceIntersection: (0,1,2) and (0,2,3)
+
+    for ( int k = 0 ; k < face->vertexCount - 2 ; k++ )
+    {
+      int iTri = firstTri[i] + k;
+
+      mesh->cIndices[3*iTri+0] = face->vertexIDs[0];
+      mesh->cIndices[3*iTri+1] = face->vertexIDs[k+1];
+      mesh->cIndices[3*iTri+2] = face->vertexIDs[k+2];
+      mesh->cMatIDs[iTri]      = (unsigned char)face->matID;
+    }
+  }
+
+  printf("    Mesh memory ............. : %ld kB -> %ld kB\n",
+         ( nVer * 2 * sizeof(Vec3) + nFac * sizeof(FaceData) ) / 1024 ,
+         ( nVer * ( sizeof(Vec3f) + sizeof(unsigned int) ) + nTri * ( 3 * sizeof(unsigned int) + 1 ) ) / 1024 );
+
+  if ( mesh->faceMasks != NULL )
+  {
+    unsigned char *triMasks = (unsigned char*)malloc( nTri * sizeof(unsigned char) );
+
+    for ( int i = 0 ; i < nFac ; i++ )
+    {
+      for ( int iTri = firstTri[i] ; iTri < firstTri[i+1] ; iTri++ )
+      {
+        triMasks[iTri] = mesh->faceMasks[i];
+      }
+    }
+
+    free( mesh->faceMasks );
+    mesh->faceMasks = triMasks;
+  }
+
+  // The original ID of a triangle is the one of the face it is part of
+
+  if ( mesh->faceOrigIDs != NULL )
+  {
+    int *triOrigIDs = (int*)malloc( nTri * sizeof(int) );
+
+    for ( int i = 0 ; i < nFac ; i++ )
+    {
+      for ( int iTri = firstTri[i] ; iTri < firstTri[i+1] ; iTri++ )
+      {
+        triOrigIDs[iTri] = mesh->faceOrigIDs[i];
+      }
+    }
+
+    free( mesh->faceOrigIDs );
+    mesh->faceOrigIDs = triOrigIDs;
+  }
+
+  free( firstTri );
+
+  free( mesh->vertices );
+  free( mesh->normals );
+  free( mesh->faces );
+
+  mesh->vertices  = NULL;
+  mesh->normals   = NULL;
+  mesh->faces     = NULL;
+
+  mesh->faceCount = nTri;
+  mesh->compact   = 1;
+}
+
+
 //------------------------------------------------------------------------------
 //  freeMesh: Frees the memory of the mesh
 //------------------------------------------------------------------------------
@@ -379,4 +858,14 @@ void freeMesh
 {
   free ( mesh->faces );
   free ( mesh->vertices );
+  free ( mesh->normals );
+
+  free ( mesh->cVertices );
+  free ( mesh->cNormals );
+  free ( mesh->cIndices );
+  free ( mesh->cMatIDs );
+
+  free ( mesh->faceOrigIDs );
+  free ( mesh->vertexOrigIDs );
+  free ( mesh->faceMasks );
 }
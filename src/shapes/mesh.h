@@ -47,20 +47,56 @@ typedef struct
 
 //------------------------------------------------------------------------------
 //  Declaration of the Mesh type (a mesh using vertices and faces)
+//
+//  When compact is set, the mesh only consists of triangles and the data is 
+//  stored in the compact arrays: single precision positions, octahedral
+//  encoded normals, three vertex IDs per triangle and a byte-sized material ID.
+//  The double precision arrays are freed in that case.
+//
+//  When the mesh is reordered, faceOrigIDs and vertexOrigIDs hold the IDs of
+//  the faces and vertices in the input file.
+//
+//  faceMasks is only allocated when some faces are visible to camera rays or
+//  shadow rays only (see Ray). It is NULL when all faces are hit by all rays.
 //------------------------------------------------------------------------------
 
 
 typedef struct
 {
-  Vec3       *vertices;
-  Vec3       *normals;
-  FaceData   *faces;
+  Vec3          *vertices;
+  Vec3          *normals;
+  FaceData      *faces;
   
-  int        vertexCount;
-  int        faceCount;
+  int           vertexCount;
+  int           faceCount;
+
+  int           compact;
+  Vec3f         *cVertices;
+  unsigned int  *cNormals;
+  unsigned int  *cIndices;
+  unsigned char *cMatIDs;
+
+  int           *faceOrigIDs;
+  int           *vertexOrigIDs;
+
+  unsigned char *faceMasks;
 } Mesh;
 
 
+//------------------------------------------------------------------------------
+//  initMesh: Initialises an empty mesh
+//
+//  Arguments:
+//      mesh    : Pointer to the mesh
+//
+//------------------------------------------------------------------------------
+
+
+void initMesh
+
+  ( Mesh*          mesh );
+
+
 //------------------------------------------------------------------------------
 //  readMeshData: Reads the mesh data from a file
 //
@@ -93,6 +129,45 @@ void readFaceData
     Mesh*          mesh );
 
 
+//------------------------------------------------------------------------------
+//  readMeshFile: Reads the vertices and faces from an input file. All other
+//                data in the file is ignored.
+//
+//  Arguments:
+//      fileName : Name of the input file
+//      mesh     : Pointer to an empty mesh
+//
+//  Return:
+//      int      : 1 if the file is read, 0 if it could not be opened
+//
+//------------------------------------------------------------------------------
+
+
+int readMeshFile
+
+  ( char*          fileName ,
+    Mesh*          mesh     );
+
+
+//------------------------------------------------------------------------------
+//  appendMesh: Appends the vertices and faces of a mesh to another mesh
+//
+//  Arguments:
+//      mesh    : Pointer to the mesh that is extended
+//      part    : Pointer to the mesh that is added
+//      mask    : Visibility mask of the added faces (RAY_CAMERA | RAY_SHADOW
+//                for faces that are hit by all rays)
+//
+//------------------------------------------------------------------------------
+
+
+void appendMesh
+
+  ( Mesh*          mesh ,
+    Mesh*          part ,
+    int            mask );
+
+
 //------------------------------------------------------------------------------
 //  getFace: Returns the face with the given face ID from the mesh
 //
@@ -131,7 +206,9 @@ int addVertex
 
 
 //------------------------------------------------------------------------------
-//  addFaceNormals: Adds the face normals to the mesh
+//  addFaceNormals: Adds the vertex normals to the mesh, i.e. the average of
+//                  the normals of the adjacent faces. The normals are 
+//                  computed in parallel using a vertex-to-face map.
 //
 //  Arguments:
 //      mesh    : Pointer to the mesh
@@ -140,7 +217,8 @@ int addVertex
 
 
 void addFaceNormals
-  ( Mesh* mesh );
+
+  ( Mesh*         mesh );
 
 
 //------------------------------------------------------------------------------
@@ -213,6 +291,39 @@ int calcTriangleIntersection
     Mesh*         mesh      );
 
 
+//------------------------------------------------------------------------------
+//  reorderMesh: Sorts the faces along a Morton curve through their centroids
+//               and renumbers the vertices in order of first use, such that
+//               faces and vertices that are close in space are also close in
+//               memory. The original IDs are stored in the mesh.
+//
+//  Arguments:
+//      mesh    : Pointer to the mesh
+//
+//------------------------------------------------------------------------------
+
+
+void reorderMesh
+
+  ( Mesh*         mesh );
+
+
+//------------------------------------------------------------------------------
+//  compactMesh: Converts the mesh to the compact representation. Quadrilateral
+//               faces are split into two triangles, hence the number of faces
+//               changes. Must be called after addFaceNormals.
+//
+//  Arguments:
+//      mesh    : Pointer to the mesh
+//
+//------------------------------------------------------------------------------
+
+
+void compactMesh
+
+  ( Mesh*         mesh );
+
+
 //------------------------------------------------------------------------------
 //  freeMesh: Frees the memory of the mesh
 //
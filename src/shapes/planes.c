@@ -0,0 +1,163 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <math.h>
+#include "planes.h"
+
+
+//------------------------------------------------------------------------------
+//  readPlaneData: Reads the plane data from a file
+//------------------------------------------------------------------------------
+
+
+void readPlaneData
+
+  ( FILE*       fin    ,
+    Planes*     planes )
+
+{
+  int iPla;
+  int nPla = 0;
+
+  int    matID;
+  Vec3   point,normal;
+
+  fscanf( fin , "%d" , &nPla );
+
+  for( iPla = 0 ; iPla < nPla ; iPla++ )
+  {
+    fscanf( fin , "%d %le %le %le %le %le %le" , &matID ,
+                                                 &point.x  , &point.y  , &point.z ,
+                                                 &normal.x , &normal.y , &normal.z );
+
+    addPlane( planes , point , normal , matID );
+  }
+
+  printf("    Number of planes ........ : %d\n",planes->count);
+}
+
+
+//-----------------------------------------------------------------------------
+//  addPlane: Adds a plane to the collection of planes using the given
+//            point, normal and material ID
+//-----------------------------------------------------------------------------
+
+
+int addPlane
+
+  ( Planes*      planes ,
+    Vec3         point  ,
+    Vec3         normal ,
+    int          matID  )
+
+{
+  if ( planes->count >= MAX_PLANES )
+  {
+    printf("ERROR: Maximum number of planes (%d) reached\n",MAX_PLANES);
+    return -1;
+  }
+
+  int planeID = planes->count;
+
+  unit( &normal );
+
+  planes->plane[planeID].normal = normal;
+  planes->plane[planeID].offset = dotProduct( &normal , &point );
+  planes->plane[planeID].matID  = matID;
+
+  planes->count++;
+
+  return planeID;
+}
+
+
+//-----------------------------------------------------------------------------
+//  convertLargeSpheres: Replaces large spheres by their tangent plane
+//-----------------------------------------------------------------------------
+
+
+int convertLargeSpheres
+
+  ( Spheres*     spheres   ,
+    Planes*      planes    ,
+    Vec3         viewer    ,
+    double       minRadius )
+
+{
+  int iSph;
+  int nKeep = 0;
+  int nConv = 0;
+
+  for ( iSph = 0 ; iSph < spheres->count ; iSph++ )
+  {
+    Sphere *sphere = &spheres->sphere[iSph];
+
+    if ( sphere->radius > minRadius && planes->count < MAX_PLANES )
+    {
+      // The tangent plane at the point of the sphere closest to the viewer
+
+      Vec3 normal = addVector( 1.0 , &viewer , -1.0 , &sphere->centre );
+
+      unit( &normal );
+
+      Vec3 point = addVector( 1.0 , &sphere->centre , sphere->radius , &normal );
+
+      addPlane( planes , point , normal , sphere->matID );
+
+      printf("    Sphere %d (radius %g) replaced by a plane\n",iSph,sphere->radius);
+
+      nConv++;
+    }
+    else
+    {
+      spheres->sphere[nKeep++] = *sphere;
+    }
+  }
+
+  spheres->count = nKeep;
+
+  return nConv;
+}
+
+
+//------------------------------------------------------------------------------
+//  calcPlaneIntersection: Calculates the intersection of a ray with a plane
+//------------------------------------------------------------------------------
+
+
+bool calcPlaneIntersection
+
+  ( Intersect*    intersect ,
+    Ray*          ray       ,
+    Plane*        plane     )
+
+{
+  double denom = dotProduct( &plane->normal , &ray->d );
+
+  if ( fabs( denom ) < 1.0e-12 )
+  {
+    return false;
+  }
+
+  double t = ( plane->offset - dotProduct( &plane->normal , &ray->o ) ) / denom;
+
+  if ( t > 0. && t < intersect->t )
+  {
+    intersect->t      = t;
+    intersect->matID  = plane->matID;
+    intersect->normal = plane->normal;
+
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,138 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef SHAPES_PLANES_H
+#define SHAPES_PLANES_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "spheres.h"
+#include "../util/vector.h"
+#include "../util/ray.h"
+
+#define MAX_PLANES 10
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the Plane type (an infinite plane n.x = offset)
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  Vec3       normal;
+  double     offset;
+  int        matID;
+} Plane;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the Planes type (a collection of planes)
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  Plane      plane[MAX_PLANES];
+  int        count;
+} Planes;
+
+
+//------------------------------------------------------------------------------
+//  readPlaneData: Reads the plane data from a file. Each plane is given by
+//                 its material ID, a point on the plane and its normal.
+//
+//  Arguments:
+//      fin     : File pointer to the file that contains the plane data
+//      planes  : Pointer to the planes
+//
+//------------------------------------------------------------------------------
+
+
+void readPlaneData
+
+  ( FILE*        fin    ,
+    Planes*      planes );
+
+
+//------------------------------------------------------------------------------
+//  addPlane: Adds a plane to the collection of planes using the given
+//            point, normal and material ID
+//
+//  Arguments:
+//      planes  : Pointer to the planes
+//      point   : A point on the plane
+//      normal  : Normal of the plane (does not need to be a unit vector)
+//      matID   : Material ID of the plane
+//
+//  Return:
+//      int     : The ID of the new plane, -1 if the collection is full
+//
+//------------------------------------------------------------------------------
+
+
+int addPlane
+
+  ( Planes*      planes ,
+    Vec3         point  ,
+    Vec3         normal ,
+    int          matID  );
+
+
+//------------------------------------------------------------------------------
+//  convertLargeSpheres: Replaces spheres with a radius larger than minRadius
+//                       by their tangent plane at the point closest to the
+//                       viewer. Such spheres are used in the input files to
+//                       model the ground.
+//
+//  Arguments:
+//      spheres   : Pointer to the spheres
+//      planes    : Pointer to the planes
+//      viewer    : Position of the camera
+//      minRadius : Spheres with a larger radius are converted
+//
+//  Return:
+//      int       : The number of converted spheres
+//
+//------------------------------------------------------------------------------
+
+
+int convertLargeSpheres
+
+  ( Spheres*     spheres   ,
+    Planes*      planes    ,
+    Vec3         viewer    ,
+    double       minRadius );
+
+
+//------------------------------------------------------------------------------
+//  calcPlaneIntersection: Calculates the intersection of a ray with a plane
+//
+//  Arguments:
+//      intersect : Pointer to the intersection
+//      ray       : Pointer to the ray
+//      plane     : Pointer to the plane
+//
+//  Return:
+//      bool      : True if the ray intersects the plane, false otherwise
+//------------------------------------------------------------------------------
+
+
+bool calcPlaneIntersection
+
+  ( Intersect*    intersect ,
+    Ray*          ray       ,
+    Plane*        plane     );
+
+
+#endif
+
+
@@ -31,10 +31,20 @@ void calcIntersection
     calcSphereIntersection( intersect , ray , &globdat->spheres.sphere[iShp] );
   }
 
+  for ( iShp = 0 ; iShp < globdat->planes.count ; iShp++ )
+  {
+    calcPlaneIntersection( intersect , ray , &globdat->planes.plane[iShp] );
+  }
+
   Face face;
 
   for ( iShp = 0 ; iShp < globdat->mesh.faceCount ; iShp++ )
   {
+    if ( globdat->mesh.faceMasks != NULL && !( globdat->mesh.faceMasks[iShp] & ray->mask ) )
+    {
+      continue;
+    }
+
     getFace( &face , iShp , &globdat->mesh );
 
     calcFaceIntersection( intersect , ray , &face , &globdat->mesh, iShp  );
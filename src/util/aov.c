@@ -0,0 +1,513 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "aov.h"
+
+
+//------------------------------------------------------------------------------
+//  createAOVFilm: Creates the planes of the output variables for a film
+//------------------------------------------------------------------------------
+
+
+AOVFilm* createAOVFilm
+
+  ( int           flags  ,
+    int           lights ,
+    Film*         film   )
+
+{
+  // The material ID is that of the nearest hit, which needs the depth
+
+  if ( flags & AOV_MATERIAL )
+  {
+    flags |= AOV_DEPTH;
+  }
+
+  const int size[AOV_KINDS] = { 1 , 3 , 1 , 3 , 1 , lights };
+
+  int channels = 0;
+  int index[AOV_KINDS];
+
+  for ( int k = 0 ; k < AOV_KINDS ; k++ )
+  {
+    index[k] = -1;
+
+    if ( ( flags & ( 1 << k ) ) && size[k] > 0 )
+    {
+      index[k]  = channels;
+      channels += size[k];
+    }
+  }
+
+  AOVFilm *aov = (AOVFilm*)malloc( sizeof(AOVFilm) + (long)film->bandSize*film->width*channels*sizeof(float) );
+
+  aov->flags    = flags;
+  aov->lights   = lights;
+  aov->channels = channels;
+  aov->x0       = 0;
+  aov->width    = film->width;
+  aov->y0       = 0;
+  aov->rows     = 0;
+
+  memcpy( aov->index , index , sizeof(index) );
+
+  startAOVBand( aov , film );
+
+  return aov;
+}
+
+
+//------------------------------------------------------------------------------
+//  clearAOVPlanes: Sets the stored pixels of the planes to the background
+//------------------------------------------------------------------------------
+
+
+static void clearAOVPlanes
+
+  ( AOVFilm*      aov )
+
+{
+  long pixels = (long)aov->rows * aov->width;
+
+  memset( aov->p , 0 , pixels*aov->channels*sizeof(float) );
+
+  const int depth    = aov->index[0];
+  const int material = aov->index[2];
+
+  for ( long k = 0 ; k < pixels ; k++ )
+  {
+    if ( depth >= 0 )
+    {
+      aov->p[k*aov->channels+depth] = INFINITY;
+    }
+
+    if ( material >= 0 )
+    {
+      aov->p[k*aov->channels+material] = -1.0f;
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  startAOVBand: Clears the planes and follows the current band of the film
+//------------------------------------------------------------------------------
+
+
+void startAOVBand
+
+  ( AOVFilm*      aov  ,
+    Film*         film )
+
+{
+  aov->y0   = film->y0;
+  aov->rows = film->rows;
+
+  clearAOVPlanes( aov );
+}
+
+
+//------------------------------------------------------------------------------
+//  createAOVTile: Creates the planes of the output variables for a tile
+//------------------------------------------------------------------------------
+
+
+AOVFilm* createAOVTile
+
+  ( AOVFilm*      aov  ,
+    int           size )
+
+{
+  AOVFilm *aovTile = (AOVFilm*)malloc( sizeof(AOVFilm) + (long)size*size*aov->channels*sizeof(float) );
+
+  aovTile->flags    = aov->flags;
+  aovTile->lights   = aov->lights;
+  aovTile->channels = aov->channels;
+  aovTile->x0       = 0;
+  aovTile->width    = 0;
+  aovTile->y0       = 0;
+  aovTile->rows     = 0;
+
+  memcpy( aovTile->index , aov->index , sizeof(aov->index) );
+
+  return aovTile;
+}
+
+
+//------------------------------------------------------------------------------
+//  startAOVTile: Clears the planes of a tile and sets its extent
+//------------------------------------------------------------------------------
+
+
+void startAOVTile
+
+  ( AOVFilm*      aovTile ,
+    Tile*         tile    )
+
+{
+  aovTile->x0    = tile->x0;
+  aovTile->y0    = tile->y0;
+  aovTile->width = tile->width;
+  aovTile->rows  = tile->height;
+
+  clearAOVPlanes( aovTile );
+}
+
+
+//------------------------------------------------------------------------------
+//  flushAOVTile: Adds the planes of a tile to the planes of the film
+//------------------------------------------------------------------------------
+
+
+void flushAOVTile
+
+  ( AOVFilm*      aov     ,
+    AOVFilm*      aovTile )
+
+{
+  const int *index = aov->index;
+
+  for ( int j = 0 ; j < aovTile->rows ; j++ )
+  {
+    for ( int i = 0 ; i < aovTile->width ; i++ )
+    {
+      const float *src = &aovTile->p[((long)j*aovTile->width+i)*aov->channels];
+      float       *dst = &aov->p[((long)(aovTile->y0+j-aov->y0)*aov->width+aovTile->x0+i)*aov->channels];
+
+      for ( int c = 0 ; c < aov->channels ; c++ )
+      {
+        if ( c != index[0] && c != index[2] )
+        {
+          dst[c] += src[c];
+        }
+      }
+
+      if ( index[0] >= 0 && src[index[0]] < dst[index[0]] )
+      {
+        dst[index[0]] = src[index[0]];
+
+        if ( index[2] >= 0 )
+        {
+          dst[index[2]] = src[index[2]];
+        }
+      }
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  clearAOVSample: Sets the output variables of a sample to the background
+//------------------------------------------------------------------------------
+
+
+void clearAOVSample
+
+  ( AOVSample*    sample ,
+    int           lights )
+
+{
+  sample->depth  = INFINITY;
+  sample->normal = (Vec3){ 0.0 , 0.0 , 0.0 };
+  sample->matID  = -1;
+  sample->albedo = (Color){ 0.0 , 0.0 , 0.0 };
+  sample->sun    = 0.0;
+
+  for ( int l = 0 ; l < lights ; l++ )
+  {
+    sample->lights[l] = 0.0;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  addAOVSample: Adds the output variables of a sample to a pixel
+//------------------------------------------------------------------------------
+
+
+void addAOVSample
+
+  ( AOVFilm*      aov    ,
+    int           i      ,
+    int           j      ,
+    AOVSample*    sample )
+
+{
+  float *v = &aov->p[((long)(j-aov->y0)*aov->width+i-aov->x0)*aov->channels];
+
+  const int *index = aov->index;
+
+  if ( index[0] >= 0 && sample->depth < v[index[0]] )
+  {
+    v[index[0]] = sample->depth;
+
+    if ( index[2] >= 0 )
+    {
+      v[index[2]] = sample->matID;
+    }
+  }
+
+  if ( index[1] >= 0 )
+  {
+    v[index[1]  ] += sample->normal.x;
+    v[index[1]+1] += sample->normal.y;
+    v[index[1]+2] += sample->normal.z;
+  }
+
+  if ( index[3] >= 0 )
+  {
+    v[index[3]  ] += sample->albedo.red;
+    v[index[3]+1] += sample->albedo.green;
+    v[index[3]+2] += sample->albedo.blue;
+  }
+
+  if ( index[4] >= 0 )
+  {
+    v[index[4]] += sample->sun;
+  }
+
+  for ( int l = 0 ; index[5] >= 0 && l < aov->lights ; l++ )
+  {
+    v[index[5]+l] += sample->lights[l];
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  getAOVPixel: Returns the output variables of a pixel
+//------------------------------------------------------------------------------
+
+
+void getAOVPixel
+
+  ( AOVFilm*      aov    ,
+    Film*         film   ,
+    int           i      ,
+    int           j      ,
+    float*        values )
+
+{
+  const float *v = &aov->p[((long)(j-aov->y0)*aov->width+i-aov->x0)*aov->channels];
+  const int *index = aov->index;
+
+  double wght = film->p[(j-film->y0)*film->width+i].wght;
+  float  inv  = ( wght > 0.0 ) ? 1.0 / wght : 0.0;
+
+  for ( int c = 0 ; c < aov->channels ; c++ )
+  {
+    values[c] = v[c] * inv;
+  }
+
+  if ( index[0] >= 0 )
+  {
+    values[index[0]] = v[index[0]];
+  }
+
+  if ( index[2] >= 0 )
+  {
+    values[index[2]] = v[index[2]];
+  }
+
+  // The albedo is a color, which is stored like the film in 0-255
+
+  for ( int c = 0 ; index[3] >= 0 && c < 3 ; c++ )
+  {
+    values[index[3]+c] /= 255.0f;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  getAOVChannelName: Returns the EXR name of a channel
+//------------------------------------------------------------------------------
+
+
+void getAOVChannelName
+
+  ( AOVFilm*      aov     ,
+    int           channel ,
+    char*         name    ,
+    int           size    )
+
+{
+  const char *names[AOV_KINDS][3] = { { "Z" } ,
+                                      { "N.X" , "N.Y" , "N.Z" } ,
+                                      { "materialID" } ,
+                                      { "albedo.R" , "albedo.G" , "albedo.B" } ,
+                                      { "sun" } ,
+                                      { "light" } };
+
+  for ( int k = AOV_KINDS-1 ; k >= 0 ; k-- )
+  {
+    if ( aov->index[k] >= 0 && channel >= aov->index[k] )
+    {
+      if ( k == 5 )
+      {
+        snprintf( name , size , "light%d" , channel - aov->index[k] );
+      }
+      else
+      {
+        snprintf( name , size , "%s" , names[k][channel - aov->index[k]] );
+      }
+
+      return;
+    }
+  }
+
+  snprintf( name , size , "unknown" );
+}
+
+
+//------------------------------------------------------------------------------
+//  openAOVWriter: Opens a multi-channel EXR file for the output variables
+//------------------------------------------------------------------------------
+
+
+AOVWriter* openAOVWriter
+
+  ( AOVFilm*      aov    ,
+    int           height ,
+    const char*   name   )
+
+{
+  FILE *file = fopen( name , "wb" );
+
+  if ( file == NULL )
+  {
+    printf("ERROR: Could not open file %s\n",name);
+    return NULL;
+  }
+
+  AOVWriter *writer = (AOVWriter*)malloc( sizeof(AOVWriter) );
+
+  const int channels = aov->channels;
+
+  char names[channels][16];
+  const char *sorted[channels];
+
+  writer->file   = file;
+  writer->height = height;
+  writer->next   = 0;
+  writer->order  = (int*)malloc( channels*sizeof(int) );
+  writer->buffer = (unsigned char*)malloc( WRITER_ROWS*( 8 + 4*(long)channels*aov->width ) );
+
+  // EXR needs the channels in alphabetical order, the order array gives the
+  // channel of the planes for each channel in the file (insertion sort)
+
+  for ( int c = 0 ; c < channels ; c++ )
+  {
+    getAOVChannelName( aov , c , names[c] , 16 );
+
+    int k = c;
+
+    while ( k > 0 && strcmp( names[writer->order[k-1]] , names[c] ) > 0 )
+    {
+      writer->order[k] = writer->order[k-1];
+      k--;
+    }
+
+    writer->order[k] = c;
+  }
+
+  for ( int c = 0 ; c < channels ; c++ )
+  {
+    sorted[c] = names[writer->order[c]];
+  }
+
+  writeEXRHeader( file , height , aov->width , sorted , channels );
+
+  return writer;
+}
+
+
+//------------------------------------------------------------------------------
+//  writeAOVRows: Writes the rows of the current band
+//------------------------------------------------------------------------------
+
+
+void writeAOVRows
+
+  ( AOVWriter*    writer ,
+    AOVFilm*      aov    ,
+    Film*         film   )
+
+{
+  const int  w        = aov->width;
+  const int  channels = aov->channels;
+  const long stride   = 8 + 4*(long)channels*w;
+
+  if ( aov->y0 != writer->next )
+  {
+    printf("ERROR: Row %d of the output variables is written out of order\n",aov->y0);
+    return;
+  }
+
+  for ( int j0 = aov->y0 ; j0 < aov->y0 + aov->rows ; j0 += WRITER_ROWS )
+  {
+    int n = ( j0 + WRITER_ROWS < aov->y0 + aov->rows ) ? WRITER_ROWS : aov->y0 + aov->rows - j0;
+
+    #pragma omp parallel for
+    for ( int r = 0 ; r < n ; r++ )
+    {
+      unsigned char *chunk = writer->buffer + r*stride;
+      float *row = (float*)( chunk + 8 );
+      float values[channels];
+
+      int32_t y    = writer->height-1-(j0+r);
+      int32_t size = 4*channels*w;
+
+      memcpy( chunk   , &y    , 4 );
+      memcpy( chunk+4 , &size , 4 );
+
+      for ( int i = 0 ; i < w ; i++ )
+      {
+        getAOVPixel( aov , film , i , j0+r , values );
+
+        for ( int c = 0 ; c < channels ; c++ )
+        {
+          row[c*w+i] = values[writer->order[c]];
+        }
+      }
+    }
+
+    fwrite( writer->buffer , stride , n , writer->file );
+  }
+
+  writer->next += aov->rows;
+}
+
+
+//------------------------------------------------------------------------------
+//  closeAOVWriter: Closes the file and frees the writer
+//------------------------------------------------------------------------------
+
+
+void closeAOVWriter
+
+  ( AOVWriter*    writer )
+
+{
+  if ( writer == NULL )
+  {
+    return;
+  }
+
+  fclose( writer->file );
+
+  free( writer->order );
+  free( writer->buffer );
+  free( writer );
+}
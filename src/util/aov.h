@@ -0,0 +1,321 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef UTIL_AOV_H
+#define UTIL_AOV_H
+
+#include <stdio.h>
+#include "film.h"
+#include "color.h"
+#include "vector.h"
+
+#define AOV_DEPTH     1
+#define AOV_NORMAL    2
+#define AOV_MATERIAL  4
+#define AOV_ALBEDO    8
+#define AOV_SUN       16
+#define AOV_LIGHTS    32
+#define AOV_ALL       63
+
+#define AOV_KINDS     6
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the AOVSample type (the output variables of one sample)
+//      depth   : distance to the first hit (INFINITY for the background)
+//      normal  : normal at the first hit
+//      matID   : material ID of the first hit (-1 for the background)
+//      albedo  : color of the material, or of the background (0-255)
+//      sun     : light of the sun at the hit point
+//      lights  : light of each spotlight at the hit point
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  double          depth;
+  Vec3            normal;
+  int             matID;
+  Color           albedo;
+  double          sun;
+  double*         lights;
+} AOVSample;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the AOVFilm type (the planes of the output variables). The
+//  planes follow the bands of the film, or a tile of the film for the
+//  samples of a single thread. Per pixel, the depth and material ID are
+//  those of the nearest hit, the other variables are summed and divided by
+//  the weight of the film pixel on output.
+//      flags    : the output variables (AOV_DEPTH, ...)
+//      lights   : number of spotlights
+//      channels : number of float values per pixel
+//      index    : first channel of each variable (-1 = not stored)
+//      x0       : first column that is stored (0, unless a tile)
+//      width    : width of the image, or of the tile
+//      y0, rows : rows of the image that are stored
+//      p        : the values, pixel by pixel
+//------------------------------------------------------------------------------
+
+
+typedef struct AOVFilm
+{
+  int             flags;
+  int             lights;
+  int             channels;
+  int             index[AOV_KINDS];
+  int             x0;
+  int             width;
+  int             y0;
+  int             rows;
+  float           p[];
+} AOVFilm;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the AOVWriter type (a multi-channel EXR file that is
+//  written row by row)
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  FILE*           file;
+  int             height;
+  int             next;
+  int*            order;
+  unsigned char*  buffer;
+} AOVWriter;
+
+
+//------------------------------------------------------------------------------
+//  createAOVFilm: Creates the planes of the output variables for a film
+//
+//  Arguments:
+//      flags    : the output variables (AOV_DEPTH, ...)
+//      lights   : number of spotlights
+//      film     : the film
+//
+//  Return:
+//      AOVFilm* : the planes
+//
+//------------------------------------------------------------------------------
+
+
+AOVFilm* createAOVFilm
+
+  ( int           flags  ,
+    int           lights ,
+    Film*         film   );
+
+
+//------------------------------------------------------------------------------
+//  startAOVBand: Clears the planes and follows the current band of the film
+//
+//  Arguments:
+//      aov      : the planes
+//      film     : the film, with the band started
+//
+//------------------------------------------------------------------------------
+
+
+void startAOVBand
+
+  ( AOVFilm*      aov  ,
+    Film*         film );
+
+
+//------------------------------------------------------------------------------
+//  createAOVTile: Creates the planes of the output variables for a tile, in
+//                 which a thread collects the samples of its tile
+//
+//  Arguments:
+//      aov      : the planes of the film
+//      size     : the tile size
+//
+//  Return:
+//      AOVFilm* : the planes of the tile
+//
+//------------------------------------------------------------------------------
+
+
+AOVFilm* createAOVTile
+
+  ( AOVFilm*      aov  ,
+    int           size );
+
+
+//------------------------------------------------------------------------------
+//  startAOVTile: Clears the planes of a tile and sets its extent
+//
+//  Arguments:
+//      aovTile  : the planes of the tile
+//      tile     : the tile of the film, with its extent set by startTile
+//
+//------------------------------------------------------------------------------
+
+
+void startAOVTile
+
+  ( AOVFilm*      aovTile ,
+    Tile*         tile    );
+
+
+//------------------------------------------------------------------------------
+//  flushAOVTile: Adds the planes of a tile to the planes of the film
+//
+//  Arguments:
+//      aov      : the planes of the film
+//      aovTile  : the planes of the tile
+//
+//------------------------------------------------------------------------------
+
+
+void flushAOVTile
+
+  ( AOVFilm*      aov     ,
+    AOVFilm*      aovTile );
+
+
+//------------------------------------------------------------------------------
+//  clearAOVSample: Sets the output variables of a sample to the background
+//
+//  Arguments:
+//      sample   : the output variables
+//      lights   : number of spotlights
+//
+//------------------------------------------------------------------------------
+
+
+void clearAOVSample
+
+  ( AOVSample*    sample ,
+    int           lights );
+
+
+//------------------------------------------------------------------------------
+//  addAOVSample: Adds the output variables of a sample to a pixel. A pixel
+//                must not be changed by two threads at the same time.
+//
+//  Arguments:
+//      aov      : the planes
+//      i        : column of the pixel
+//      j        : row of the pixel
+//      sample   : the output variables
+//
+//------------------------------------------------------------------------------
+
+
+void addAOVSample
+
+  ( AOVFilm*      aov    ,
+    int           i      ,
+    int           j      ,
+    AOVSample*    sample );
+
+
+//------------------------------------------------------------------------------
+//  getAOVPixel: Returns the output variables of a pixel, the depth and the
+//               normal are not normalised
+//
+//  Arguments:
+//      aov      : the planes
+//      film     : the film
+//      i        : column of the pixel
+//      j        : row of the pixel
+//      values   : the channels of the pixel
+//
+//------------------------------------------------------------------------------
+
+
+void getAOVPixel
+
+  ( AOVFilm*      aov    ,
+    Film*         film   ,
+    int           i      ,
+    int           j      ,
+    float*        values );
+
+
+//------------------------------------------------------------------------------
+//  getAOVChannelName: Returns the EXR name of a channel
+//
+//  Arguments:
+//      aov      : the planes
+//      channel  : the channel
+//      name     : the name
+//      size     : size of the name buffer
+//
+//------------------------------------------------------------------------------
+
+
+void getAOVChannelName
+
+  ( AOVFilm*      aov     ,
+    int           channel ,
+    char*         name    ,
+    int           size    );
+
+
+//------------------------------------------------------------------------------
+//  openAOVWriter: Opens a multi-channel EXR file for the output variables
+//
+//  Arguments:
+//      aov      : the planes
+//      height   : height of the image
+//      name     : name of the file
+//
+//  Return:
+//      AOVWriter* : the writer, NULL if the file cannot be opened
+//
+//------------------------------------------------------------------------------
+
+
+AOVWriter* openAOVWriter
+
+  ( AOVFilm*      aov    ,
+    int           height ,
+    const char*   name   );
+
+
+//------------------------------------------------------------------------------
+//  writeAOVRows: Writes the rows of the current band, from the first row up
+//
+//  Arguments:
+//      writer   : the writer
+//      aov      : the planes
+//      film     : the film
+//
+//------------------------------------------------------------------------------
+
+
+void writeAOVRows
+
+  ( AOVWriter*    writer ,
+    AOVFilm*      aov    ,
+    Film*         film   );
+
+
+//------------------------------------------------------------------------------
+//  closeAOVWriter: Closes the file and frees the writer
+//
+//  Arguments:
+//      writer   : the writer
+//
+//------------------------------------------------------------------------------
+
+
+void closeAOVWriter
+
+  ( AOVWriter*    writer );
+
+#endif
@@ -56,39 +56,69 @@ Vec3 computeCentroidAABB(AABB *aabb)
 }
 
 //------------------------------------------------------------------------------
-//  comparePrimitives: Compares two primitives
+//  compareCentroidX/Y/Z: Compares two primitives along one axis
 //------------------------------------------------------------------------------
 
-static int splitAxis = 0;
+int compareCentroidX(const void *a, const void *b)
+{
+  double ca = ((const PrimitiveInfo *)a)->centroid.x;
+  double cb = ((const PrimitiveInfo *)b)->centroid.x;
+
+  return (ca > cb) - (ca < cb);
+}
 
-int comparePrimitives(const void *a, const void *b)
+int compareCentroidY(const void *a, const void *b)
 {
-  const PrimitiveInfo *infoA = (const PrimitiveInfo *)a;
-  const PrimitiveInfo *infoB = (const PrimitiveInfo *)b;
+  double ca = ((const PrimitiveInfo *)a)->centroid.y;
+  double cb = ((const PrimitiveInfo *)b)->centroid.y;
 
-  double centroidA, centroidB;
-  if (splitAxis == 0)
-  {
-    centroidA = infoA->centroid.x;
-    centroidB = infoB->centroid.x;
-  }
-  else if (splitAxis == 1)
-  {
-    centroidA = infoA->centroid.y;
-    centroidB = infoB->centroid.y;
-  }
-  else
+  return (ca > cb) - (ca < cb);
+}
+
+int compareCentroidZ(const void *a, const void *b)
+{
+  double ca = ((const PrimitiveInfo *)a)->centroid.z;
+  double cb = ((const PrimitiveInfo *)b)->centroid.z;
+
+  return (ca > cb) - (ca < cb);
+}
+
+//------------------------------------------------------------------------------
+//  initBVHPrimitives: Computes the bounds and centroids of all primitives
+//------------------------------------------------------------------------------
+
+void initBVHPrimitives(BVH *bvh, Globdat *globdat)
+{
+  int faceCount = globdat->mesh.faceCount;
+  int total     = faceCount + globdat->spheres.count;
+
+  bvh->nodeCount   = 0;
+  bvh->objectCount = total;
+  bvh->primitives  = (PrimitiveInfo *)malloc(total * sizeof(PrimitiveInfo));
+  bvh->objectIDs   = (int *)malloc(total * sizeof(int));
+
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < total; i++)
   {
-    centroidA = infoA->centroid.z;
-    centroidB = infoB->centroid.z;
-  }
+    PrimitiveInfo *prim = &bvh->primitives[i];
+    prim->index = i;
 
-  if (centroidA < centroidB)
-    return -1;
-  else if (centroidA > centroidB)
-    return 1;
+    if (i < faceCount)
+    {
+      prim->isPrimitive = PRIMITIVE_FACE;
+
+      Face face;
+      getFace(&face, i, &globdat->mesh);
+      prim->bbox = computeFaceAABB(&face);
+    }
+    else
+    {
+      prim->isPrimitive = PRIMITIVE_SPHERE;
+      prim->bbox = computeSphereAABB(&globdat->spheres.sphere[i - faceCount]);
+    }
 
-  return 0;
+    prim->centroid = computeCentroidAABB(&prim->bbox);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -98,46 +128,32 @@ int comparePrimitives(const void *a, const void *b)
 
 int buildBVH(BVH *bvh, Globdat *globdat, int first, int count)
 {
-  if (bvh->nodeCount >= MAX_BVH_NODES)
+  int nodeIndex;
+
+#pragma omp atomic capture
+  nodeIndex = bvh->nodeCount++;
+
+  if (nodeIndex >= MAX_BVH_NODES)
   {
     printf("ERROR: Maximum BVH node count reached\n");
     return -1;
   }
 
-  int nodeIndex = bvh->nodeCount++;
   BVHNode *node = &bvh->nodes[nodeIndex];
+  PrimitiveInfo *primitives = bvh->primitives + first;
 
   node->bbox.min = (Vec3){DBL_MAX, DBL_MAX, DBL_MAX};
   node->bbox.max = (Vec3){-DBL_MAX, -DBL_MAX, -DBL_MAX};
 
-  PrimitiveInfo *primitives = (PrimitiveInfo *)malloc(count * sizeof(PrimitiveInfo));
+  AABB centroidBox = node->bbox;
 
   for (int i = 0; i < count; i++)
   {
-    int objIndex = first + i;
-    primitives[i].index = objIndex;
+    node->bbox.min = minVector(1.0, &node->bbox.min, 1.0, &primitives[i].bbox.min);
+    node->bbox.max = maxVector(1.0, &node->bbox.max, 1.0, &primitives[i].bbox.max);
 
-    AABB aabb;
-    if (objIndex < globdat->mesh.faceCount)
-    {
-      primitives[i].isPrimitive = PRIMITIVE_FACE;
-
-      Face face;
-      getFace(&face, objIndex, &globdat->mesh);
-      aabb = computeFaceAABB(&face);
-    }
-    else
-    {
-      primitives[i].isPrimitive = PRIMITIVE_SPHERE;
-      int sphereIndex = objIndex - globdat->mesh.faceCount;
-
-      aabb = computeSphereAABB(&globdat->spheres.sphere[sphereIndex]);
-    }
-
-    primitives[i].centroid = computeCentroidAABB(&aabb);
-
-    node->bbox.min = minVector(1.0, &node->bbox.min, 1.0, &aabb.min);
-    node->bbox.max = maxVector(1.0, &node->bbox.max, 1.0, &aabb.max);
+    centroidBox.min = minVector(1.0, &centroidBox.min, 1.0, &primitives[i].centroid);
+    centroidBox.max = maxVector(1.0, &centroidBox.max, 1.0, &primitives[i].centroid);
   }
 
   if (count <= 4)
@@ -145,39 +161,81 @@ int buildBVH(BVH *bvh, Globdat *globdat, int first, int count)
     node->firstObject = first;
     node->objectCount = count;
     node->isLeaf = 1;
-    free(primitives);
     return nodeIndex;
   }
 
-  Vec3 size = addVector(1.0, &node->bbox.max, -1.0, &node->bbox.min);
+  // Split along the axis with the largest spread of the centroids
+
+  Vec3 size = addVector(1.0, &centroidBox.max, -1.0, &centroidBox.min);
   if (size.x > size.y && size.x > size.z)
   {
-    splitAxis = 0; // X-axis
+    qsort(primitives, count, sizeof(PrimitiveInfo), compareCentroidX);
   }
   else if (size.y > size.z)
   {
-    splitAxis = 1; // Y-axis
+    qsort(primitives, count, sizeof(PrimitiveInfo), compareCentroidY);
   }
   else
   {
-    splitAxis = 2; // Z-axis
+    qsort(primitives, count, sizeof(PrimitiveInfo), compareCentroidZ);
   }
 
-  qsort(primitives, count, sizeof(PrimitiveInfo), comparePrimitives);
-
   int mid = count / 2;
+  int left, right;
 
-  node->leftChild = buildBVH(bvh, globdat, first, mid);
-  node->rightChild = buildBVH(bvh, globdat, first + mid, count - mid);
+#pragma omp task shared(left) if(count > BVH_TASK_SIZE)
+  left = buildBVH(bvh, globdat, first, mid);
 
-  node->isLeaf = 0;
+  right = buildBVH(bvh, globdat, first + mid, count - mid);
+
+#pragma omp taskwait
 
-  free(primitives);
+  node->leftChild = left;
+  node->rightChild = right;
+  node->isLeaf = 0;
 
   return nodeIndex;
 }
 
 
+//------------------------------------------------------------------------------
+//  createBVH: Creates the BVH of all faces and spheres in the scene
+//------------------------------------------------------------------------------
+
+BVH *createBVH(Globdat *globdat)
+{
+  BVH *bvh = (BVH *)malloc(sizeof(BVH));
+
+  initBVHPrimitives(bvh, globdat);
+
+#pragma omp parallel
+#pragma omp single
+  buildBVH(bvh, globdat, 0, bvh->objectCount);
+
+  for (int i = 0; i < bvh->objectCount; i++)
+  {
+    bvh->objectIDs[i] = bvh->primitives[i].index;
+  }
+
+  free(bvh->primitives);
+  bvh->primitives = NULL;
+
+  return bvh;
+}
+
+
+//------------------------------------------------------------------------------
+//  freeBVH: Frees the memory of the BVH
+//------------------------------------------------------------------------------
+
+void freeBVH(BVH *bvh)
+{
+  free(bvh->primitives);
+  free(bvh->objectIDs);
+  free(bvh);
+}
+
+
 //------------------------------------------------------------------------------
 //  intersectAABB: Intersects a ray with an AABB
 //------------------------------------------------------------------------------
@@ -217,6 +275,14 @@ void traverseBVH(BVH *bvh, Globdat *globdat, Ray *ray, Intersect *intersect)
   const Vec3 invDir = {1.0 / ray->d.x, 1.0 / ray->d.y, 1.0 / ray->d.z};
   const int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
 
+  // Infinite planes are not part of the tree and are tested first, so that
+  // their hit distance already limits the traversal
+
+  for (int i = 0; i < globdat->planes.count; i++)
+  {
+    calcPlaneIntersection(intersect, ray, &globdat->planes.plane[i]);
+  }
+
   double tMax = intersect->t;
 
   while (true)
@@ -229,10 +295,15 @@ void traverseBVH(BVH *bvh, Globdat *globdat, Ray *ray, Intersect *intersect)
       {
         for (int i = 0; i < node->objectCount; i++)
         {
-          int objIndex = node->firstObject + i;
+          int objIndex = bvh->objectIDs[node->firstObject + i];
 
           if (objIndex < globdat->mesh.faceCount)
           {
+            if (globdat->mesh.faceMasks != NULL && !(globdat->mesh.faceMasks[objIndex] & ray->mask))
+            {
+              continue;
+            }
+
             Face face;
             getFace(&face, objIndex, &globdat->mesh);
             calcFaceIntersection(intersect, ray, &face, &globdat->mesh, objIndex);
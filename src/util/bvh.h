@@ -8,6 +8,7 @@
 #include "../shapes/spheres.h"
 
 #define MAX_BVH_NODES 1000000
+#define BVH_TASK_SIZE 4096
 
 
 //------------------------------------------------------------------------------
@@ -35,17 +36,6 @@ typedef struct {
 } BVHNode;
 
 
-//------------------------------------------------------------------------------
-//  Declaration of the BVH structure
-//------------------------------------------------------------------------------
-
-
-typedef struct {
-  BVHNode nodes[MAX_BVH_NODES];
-  int nodeCount;
-} BVH;
-
-
 //------------------------------------------------------------------------------
 //  Declaration of the PrimitiveInfo structure used for combining spheres and
 //  faces in the BVH needed for sorting
@@ -56,9 +46,26 @@ typedef struct {
   int index;
   int isPrimitive;
   Vec3 centroid;
+  AABB bbox;
 } PrimitiveInfo;
 
 
+//------------------------------------------------------------------------------
+//  Declaration of the BVH structure. The leaves refer to a range in objectIDs,
+//  which holds the face and sphere indices in leaf order. The primitives are
+//  only needed while building the tree.
+//------------------------------------------------------------------------------
+
+
+typedef struct BVH {
+  BVHNode nodes[MAX_BVH_NODES];
+  int nodeCount;
+  int objectCount;
+  int *objectIDs;
+  PrimitiveInfo *primitives;
+} BVH;
+
+
 //------------------------------------------------------------------------------
 //  computeFaceAABB: Computes the AABB of a face
 //
@@ -111,7 +118,8 @@ Vec3 computeCentroidAABB
 
 
 //------------------------------------------------------------------------------
-//  comparePrimitives: Compares two primitives based on their centroids
+//  compareCentroidX/Y/Z: Compares two primitives based on the x-, y- or
+//                        z-coordinate of their centroids
 //
 //  Arguments:
 //      a    : Pointer to the first primitive
@@ -123,12 +131,39 @@ Vec3 computeCentroidAABB
 //------------------------------------------------------------------------------
 
 
-int comparePrimitives
+int compareCentroidX
+
+  ( const void*   a ,
+    const void*   b );
+
+int compareCentroidY
+
+  ( const void*   a ,
+    const void*   b );
+
+int compareCentroidZ
 
   ( const void*   a ,
     const void*   b );
 
 
+//------------------------------------------------------------------------------
+//  initBVHPrimitives: Computes the bounding boxes and centroids of all faces
+//                     and spheres (in parallel) and allocates the index array
+//
+//  Arguments:
+//      bvh       : Pointer to the BVH tree
+//      globdat   : Pointer to the global data
+//
+//------------------------------------------------------------------------------
+
+
+void initBVHPrimitives
+
+  ( BVH           *bvh     ,
+    Globdat       *globdat );
+
+
 //------------------------------------------------------------------------------
 //  buildBVH: Builds the BVH tree
 //
@@ -152,6 +187,38 @@ int buildBVH
     int           count    );
 
 
+//------------------------------------------------------------------------------
+//  createBVH: Creates the BVH of all faces and spheres in the scene. The
+//             subtrees are built in parallel using OpenMP tasks.
+//
+//  Arguments:
+//      globdat   : Pointer to the global data
+//
+//  Return:
+//      BVH*      : a pointer to the BVH tree
+//
+//------------------------------------------------------------------------------
+
+
+BVH *createBVH
+
+  ( Globdat       *globdat );
+
+
+//------------------------------------------------------------------------------
+//  freeBVH: Frees the memory of the BVH
+//
+//  Arguments:
+//      bvh       : Pointer to the BVH tree
+//
+//------------------------------------------------------------------------------
+
+
+void freeBVH
+
+  ( BVH           *bvh );
+
+
 //------------------------------------------------------------------------------
 //  intersectAABB: Intersects a ray with an AABB
 //
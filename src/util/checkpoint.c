@@ -0,0 +1,407 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <omp.h>
+#include "checkpoint.h"
+
+
+static volatile sig_atomic_t stopRequested = 0;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the header of a checkpoint file. The fields have a fixed
+//  width and no padding, so that the layout does not depend on the compiler.
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  char     magic[8];
+  int32_t  height;
+  int32_t  width;
+  int32_t  spp;
+  int32_t  tileSize;
+  int32_t  tileCount;
+  int32_t  first;
+  int32_t  pass;
+  int32_t  unused;
+  int64_t  totalSamples;
+  int64_t  activePixels;
+  int64_t  aovSize;
+} CheckpointHeader;
+
+
+//------------------------------------------------------------------------------
+//  createCheckpoint: Creates the checkpoint state of a render
+//------------------------------------------------------------------------------
+
+
+Checkpoint* createCheckpoint
+
+  ( const char*   fileName ,
+    double        interval ,
+    Film*         film     ,
+    int           spp      ,
+    int           tileSize )
+
+{
+  Checkpoint *checkpoint = (Checkpoint*)malloc( sizeof(Checkpoint) );
+
+  snprintf( checkpoint->fileName , sizeof(checkpoint->fileName) , "%s" , fileName );
+
+  checkpoint->interval     = interval;
+  checkpoint->lastWrite    = omp_get_wtime();
+  checkpoint->spp          = spp;
+  checkpoint->tileSize     = tileSize;
+  checkpoint->tileCount    = getTileCount( film , tileSize );
+  checkpoint->first        = 0;
+  checkpoint->pass         = 0;
+  checkpoint->totalSamples = 0;
+  checkpoint->activePixels = 0;
+  checkpoint->tileDone     = (unsigned char*)calloc( checkpoint->tileCount , 1 );
+  checkpoint->aovData      = NULL;
+  checkpoint->aovSize      = 0;
+  checkpoint->busy         = 0;
+  checkpoint->snapshot     = NULL;
+  checkpoint->snapshotDone = NULL;
+  checkpoint->snapshotAOV  = NULL;
+
+  if ( interval > 0.0 )
+  {
+    checkpoint->snapshot     = createFilm( film->height , film->width );
+    checkpoint->snapshotDone = (unsigned char*)calloc( checkpoint->tileCount , 1 );
+  }
+
+  return checkpoint;
+}
+
+
+//------------------------------------------------------------------------------
+//  freeCheckpoint: Frees the checkpoint state
+//------------------------------------------------------------------------------
+
+
+void freeCheckpoint
+
+  ( Checkpoint*   checkpoint )
+
+{
+  if ( checkpoint == NULL )
+  {
+    return;
+  }
+
+  free( checkpoint->tileDone );
+  free( checkpoint->snapshot );
+  free( checkpoint->snapshotDone );
+  free( checkpoint->snapshotAOV );
+  free( checkpoint );
+}
+
+
+//------------------------------------------------------------------------------
+//  startCheckpointPass: Starts a new pass
+//------------------------------------------------------------------------------
+
+
+void startCheckpointPass
+
+  ( Checkpoint*   checkpoint ,
+    int           first      ,
+    int           pass       )
+
+{
+  if ( checkpoint->first == first && checkpoint->pass == pass )
+  {
+    return;
+  }
+
+  checkpoint->first        = first;
+  checkpoint->pass         = pass;
+  checkpoint->activePixels = 0;
+
+  memset( checkpoint->tileDone , 0 , checkpoint->tileCount );
+}
+
+
+//------------------------------------------------------------------------------
+//  finishCheckpointTile: Marks a tile as finished
+//------------------------------------------------------------------------------
+
+
+int finishCheckpointTile
+
+  ( Checkpoint*   checkpoint   ,
+    Film*         film         ,
+    int           tile         ,
+    long          totalSamples ,
+    long          activePixels )
+
+{
+  checkpoint->tileDone[tile] = 1;
+  checkpoint->totalSamples   = totalSamples;
+  checkpoint->activePixels   = activePixels;
+
+  int busy;
+
+  #pragma omp atomic read
+  busy = checkpoint->busy;
+
+  if ( checkpoint->snapshot == NULL || busy ||
+       omp_get_wtime() - checkpoint->lastWrite < checkpoint->interval )
+  {
+    return 0;
+  }
+
+  if ( checkpoint->snapshotAOV == NULL && checkpoint->aovSize > 0 )
+  {
+    checkpoint->snapshotAOV = (float*)malloc( checkpoint->aovSize * sizeof(float) );
+  }
+
+  memcpy( checkpoint->snapshot->p , film->p , (long)film->rows*film->width*sizeof(Pixel) );
+  memcpy( checkpoint->snapshotDone , checkpoint->tileDone , checkpoint->tileCount );
+  memcpy( checkpoint->snapshotAOV , checkpoint->aovData , checkpoint->aovSize*sizeof(float) );
+
+  checkpoint->snapshotSamples = totalSamples;
+  checkpoint->snapshotPixels  = activePixels;
+
+  #pragma omp atomic write
+  checkpoint->busy = 1;
+
+  checkpoint->lastWrite = omp_get_wtime();
+
+  return 1;
+}
+
+
+//------------------------------------------------------------------------------
+//  storeCheckpoint: Writes a state to the checkpoint file
+//------------------------------------------------------------------------------
+
+
+static int storeCheckpoint
+
+  ( Checkpoint*     checkpoint   ,
+    Film*           film         ,
+    unsigned char*  tileDone     ,
+    float*          aovData      ,
+    long            totalSamples ,
+    long            activePixels )
+
+{
+  char tmpName[56];
+
+  snprintf( tmpName , sizeof(tmpName) , "%s.tmp" , checkpoint->fileName );
+
+  FILE *fp = fopen( tmpName , "wb" );
+
+  if ( fp == NULL )
+  {
+    printf("ERROR: Checkpoint file '%s' cannot be written\n",tmpName);
+    return -1;
+  }
+
+  CheckpointHeader header;
+
+  memset( &header , 0 , sizeof(header) );
+  memcpy( header.magic , CHECKPOINT_MAGIC , 8 );
+
+  header.height       = film->height;
+  header.width        = film->width;
+  header.spp          = checkpoint->spp;
+  header.tileSize     = checkpoint->tileSize;
+  header.tileCount    = checkpoint->tileCount;
+  header.first        = checkpoint->first;
+  header.pass         = checkpoint->pass;
+  header.totalSamples = totalSamples;
+  header.activePixels = activePixels;
+  header.aovSize      = checkpoint->aovSize;
+
+  long pixels = (long)film->rows * film->width;
+
+  int ok = fwrite( &header , sizeof(header) , 1 , fp ) == 1 &&
+           fwrite( tileDone , 1 , checkpoint->tileCount , fp ) == (size_t)checkpoint->tileCount &&
+           fwrite( film->p , sizeof(Pixel) , pixels , fp ) == (size_t)pixels &&
+           fwrite( aovData , sizeof(float) , checkpoint->aovSize , fp ) == (size_t)checkpoint->aovSize;
+
+  if ( fclose( fp ) != 0 || !ok )
+  {
+    printf("ERROR: Checkpoint file '%s' cannot be written\n",tmpName);
+    remove( tmpName );
+    return -1;
+  }
+
+#ifdef _WIN32
+  remove( checkpoint->fileName );
+#endif
+
+  if ( rename( tmpName , checkpoint->fileName ) != 0 )
+  {
+    printf("ERROR: Checkpoint file '%s' cannot be written\n",checkpoint->fileName);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+//  writeCheckpoint: Writes the checkpoint file
+//------------------------------------------------------------------------------
+
+
+int writeCheckpoint
+
+  ( Checkpoint*   checkpoint ,
+    Film*         film       )
+
+{
+  int status = storeCheckpoint( checkpoint , film , checkpoint->tileDone , checkpoint->aovData ,
+                                checkpoint->totalSamples , checkpoint->activePixels );
+
+  checkpoint->lastWrite = omp_get_wtime();
+
+  return status;
+}
+
+
+//------------------------------------------------------------------------------
+//  writeCheckpointSnapshot: Writes the snapshot to the checkpoint file
+//------------------------------------------------------------------------------
+
+
+int writeCheckpointSnapshot
+
+  ( Checkpoint*   checkpoint )
+
+{
+  int status = storeCheckpoint( checkpoint , checkpoint->snapshot , checkpoint->snapshotDone ,
+                                checkpoint->snapshotAOV , checkpoint->snapshotSamples ,
+                                checkpoint->snapshotPixels );
+
+  #pragma omp atomic write
+  checkpoint->busy = 0;
+
+  return status;
+}
+
+
+//------------------------------------------------------------------------------
+//  readCheckpoint: Reads the checkpoint file into the film and the state
+//------------------------------------------------------------------------------
+
+
+int readCheckpoint
+
+  ( Checkpoint*   checkpoint ,
+    Film*         film       )
+
+{
+  FILE *fp = fopen( checkpoint->fileName , "rb" );
+
+  if ( fp == NULL )
+  {
+    return 0;
+  }
+
+  CheckpointHeader header;
+
+  if ( fread( &header , sizeof(header) , 1 , fp ) != 1 ||
+       memcmp( header.magic , CHECKPOINT_MAGIC , 8 ) != 0 ||
+       header.height    != film->height           ||
+       header.width     != film->width            ||
+       film->rows       != film->height           ||
+       header.spp       != checkpoint->spp        ||
+       header.tileSize  != checkpoint->tileSize   ||
+       header.tileCount != checkpoint->tileCount  ||
+       header.aovSize   != checkpoint->aovSize    )
+  {
+    printf("WARNING: Checkpoint file '%s' belongs to another render\n",checkpoint->fileName);
+    fclose( fp );
+    return 0;
+  }
+
+  long pixels = (long)film->rows * film->width;
+
+  if ( fread( checkpoint->tileDone , 1 , checkpoint->tileCount , fp ) != (size_t)checkpoint->tileCount ||
+       fread( film->p , sizeof(Pixel) , pixels , fp ) != (size_t)pixels ||
+       fread( checkpoint->aovData , sizeof(float) , checkpoint->aovSize , fp ) != (size_t)checkpoint->aovSize )
+  {
+    printf("WARNING: Checkpoint file '%s' is incomplete\n",checkpoint->fileName);
+
+    memset( checkpoint->tileDone , 0 , checkpoint->tileCount );
+    memset( film->p , 0 , pixels*sizeof(Pixel) );
+
+    fclose( fp );
+    return 0;
+  }
+
+  fclose( fp );
+
+  checkpoint->first        = header.first;
+  checkpoint->pass         = header.pass;
+  checkpoint->totalSamples = header.totalSamples;
+  checkpoint->activePixels = header.activePixels;
+
+  return 1;
+}
+
+
+//------------------------------------------------------------------------------
+//  handleStopSignal: Requests a stop, the next signal ends the program
+//------------------------------------------------------------------------------
+
+
+static void handleStopSignal
+
+  ( int   sig )
+
+{
+  stopRequested = 1;
+
+  signal( sig , SIG_DFL );
+}
+
+
+//------------------------------------------------------------------------------
+//  installCheckpointSignals: Lets SIGINT and SIGTERM request a stop
+//------------------------------------------------------------------------------
+
+
+void installCheckpointSignals
+
+  ( void )
+
+{
+  stopRequested = 0;
+
+  signal( SIGINT  , handleStopSignal );
+  signal( SIGTERM , handleStopSignal );
+}
+
+
+//------------------------------------------------------------------------------
+//  checkpointStopRequested: Returns 1 if a stop has been requested
+//------------------------------------------------------------------------------
+
+
+int checkpointStopRequested
+
+  ( void )
+
+{
+  return stopRequested != 0;
+}
@@ -0,0 +1,241 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef UTIL_CHECKPOINT_H
+#define UTIL_CHECKPOINT_H
+
+#include "film.h"
+
+#define CHECKPOINT_MAGIC "RTCKPT02"
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the Checkpoint type (the state of a render that is stored
+//  in a file). The samples are counter based, so the state consists of the
+//  film and the progress of the current pass.
+//      fileName     : name of the checkpoint file
+//      interval     : time between two checkpoints (seconds)
+//      lastWrite    : time of the last checkpoint
+//      spp          : samples per pixel of the render
+//      tileSize     : size of the tiles
+//      tileCount    : number of tiles of the film
+//      first        : first sample of the current pass
+//      pass         : number of the current pass
+//      totalSamples : samples that have been added to the film
+//      activePixels : pixels that got samples in the current pass
+//      tileDone     : tiles that are finished in the current pass
+//      aovData      : planes of the output variables that are stored with
+//                     the film (NULL = none)
+//      aovSize      : number of values of the planes
+//      busy         : 1 while a thread writes a snapshot
+//      snapshot     : copy of the film that is written (NULL = interval 0)
+//      snapshotDone : copy of the finished tiles
+//      snapshotAOV  : copy of the planes of the output variables
+//      snapshotSamples : copy of the samples that have been added
+//      snapshotPixels  : copy of the pixels with samples in the pass
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  char            fileName[48];
+  double          interval;
+  double          lastWrite;
+  int             spp;
+  int             tileSize;
+  int             tileCount;
+  int             first;
+  int             pass;
+  long            totalSamples;
+  long            activePixels;
+  unsigned char*  tileDone;
+  float*          aovData;
+  long            aovSize;
+  int             busy;
+  Film*           snapshot;
+  unsigned char*  snapshotDone;
+  float*          snapshotAOV;
+  long            snapshotSamples;
+  long            snapshotPixels;
+} Checkpoint;
+
+
+//------------------------------------------------------------------------------
+//  createCheckpoint: Creates the checkpoint state of a render
+//
+//  Arguments:
+//      fileName : name of the checkpoint file
+//      interval : time between two checkpoints (seconds)
+//      film     : the film, which must hold the whole image
+//      spp      : samples per pixel of the render
+//      tileSize : size of the tiles
+//
+//  Return:
+//      Checkpoint* : the checkpoint state
+//
+//------------------------------------------------------------------------------
+
+
+Checkpoint* createCheckpoint
+
+  ( const char*   fileName ,
+    double        interval ,
+    Film*         film     ,
+    int           spp      ,
+    int           tileSize );
+
+
+//------------------------------------------------------------------------------
+//  freeCheckpoint: Frees the checkpoint state (the file is kept)
+//
+//  Arguments:
+//      checkpoint : the checkpoint state
+//
+//------------------------------------------------------------------------------
+
+
+void freeCheckpoint
+
+  ( Checkpoint*   checkpoint );
+
+
+//------------------------------------------------------------------------------
+//  startCheckpointPass: Starts a new pass, unless the pass is the one that
+//                       was read from the checkpoint file
+//
+//  Arguments:
+//      checkpoint : the checkpoint state
+//      first      : first sample of the pass
+//      pass       : number of the pass
+//
+//------------------------------------------------------------------------------
+
+
+void startCheckpointPass
+
+  ( Checkpoint*   checkpoint ,
+    int           first      ,
+    int           pass       );
+
+
+//------------------------------------------------------------------------------
+//  finishCheckpointTile: Marks a tile as finished and copies the film and the
+//                        state when the interval has passed and no snapshot
+//                        is being written. The tile must have been added to
+//                        the film, and other threads must not add tiles at
+//                        the same time.
+//
+//  Arguments:
+//      checkpoint   : the checkpoint state
+//      film         : the film
+//      tile         : ID of the tile
+//      totalSamples : samples that have been added to the film
+//      activePixels : pixels that got samples in the current pass
+//
+//  Return:
+//      int          : 1 if the snapshot is taken, the caller then writes it
+//                     with writeCheckpointSnapshot
+//
+//------------------------------------------------------------------------------
+
+
+int finishCheckpointTile
+
+  ( Checkpoint*   checkpoint   ,
+    Film*         film         ,
+    int           tile         ,
+    long          totalSamples ,
+    long          activePixels );
+
+
+//------------------------------------------------------------------------------
+//  writeCheckpoint: Writes the checkpoint file. The file is written under a
+//                   temporary name first, so that an interrupted write keeps
+//                   the previous checkpoint.
+//
+//  Arguments:
+//      checkpoint : the checkpoint state
+//      film       : the film
+//
+//  Return:
+//      int        : 0 on success, -1 if the file could not be written
+//
+//------------------------------------------------------------------------------
+
+
+int writeCheckpoint
+
+  ( Checkpoint*   checkpoint ,
+    Film*         film       );
+
+
+//------------------------------------------------------------------------------
+//  writeCheckpointSnapshot: Writes the snapshot of finishCheckpointTile to the
+//                           checkpoint file, while other threads continue to
+//                           add tiles to the film
+//
+//  Arguments:
+//      checkpoint : the checkpoint state
+//
+//  Return:
+//      int        : 0 on success, -1 if the file could not be written
+//
+//------------------------------------------------------------------------------
+
+
+int writeCheckpointSnapshot
+
+  ( Checkpoint*   checkpoint );
+
+
+//------------------------------------------------------------------------------
+//  readCheckpoint: Reads the checkpoint file into the film and the state
+//
+//  Arguments:
+//      checkpoint : the checkpoint state
+//      film       : the film
+//
+//  Return:
+//      int        : 1 if the checkpoint is read, 0 if there is no file or if
+//                   it belongs to another render
+//
+//------------------------------------------------------------------------------
+
+
+int readCheckpoint
+
+  ( Checkpoint*   checkpoint ,
+    Film*         film       );
+
+
+//------------------------------------------------------------------------------
+//  installCheckpointSignals: Lets SIGINT and SIGTERM request a stop instead
+//                            of ending the program. A second signal ends the
+//                            program directly.
+//------------------------------------------------------------------------------
+
+
+void installCheckpointSignals
+
+  ( void );
+
+
+//------------------------------------------------------------------------------
+//  checkpointStopRequested: Returns 1 if a stop has been requested by a
+//                           signal
+//------------------------------------------------------------------------------
+
+
+int checkpointStopRequested
+
+  ( void );
+
+#endif
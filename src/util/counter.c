@@ -0,0 +1,84 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+#include <stdint.h>
+#include <omp.h>
+#include "counter.h"
+
+
+//------------------------------------------------------------------------------
+//  getCounterLine: Returns line k of the counters, aligned to a cache line
+//------------------------------------------------------------------------------
+
+
+static long* getCounterLine
+
+  ( ThreadCounters*  counters ,
+    int              k        )
+
+{
+  uintptr_t base = (uintptr_t)counters->line;
+
+  base = ( base + COUNTER_LINE - 1 ) / COUNTER_LINE * COUNTER_LINE;
+
+  return (long*)base + (long)k * COUNTER_VALUES;
+}
+
+
+//------------------------------------------------------------------------------
+//  resetThreadCounters: Sets all counters to zero
+//------------------------------------------------------------------------------
+
+
+void resetThreadCounters
+
+  ( ThreadCounters*  counters )
+
+{
+  memset( counters->line , 0 , sizeof(counters->line) );
+}
+
+
+//------------------------------------------------------------------------------
+//  getThreadCounter: Returns the values of the calling thread
+//------------------------------------------------------------------------------
+
+
+long* getThreadCounter
+
+  ( ThreadCounters*  counters )
+
+{
+  return getCounterLine( counters , omp_get_thread_num() % COUNTER_THREADS );
+}
+
+
+//------------------------------------------------------------------------------
+//  sumThreadCounters: Returns the sum of a value over all threads
+//------------------------------------------------------------------------------
+
+
+long sumThreadCounters
+
+  ( ThreadCounters*  counters ,
+    int              value    )
+
+{
+  long sum = 0;
+
+  for ( int k = 0 ; k < COUNTER_THREADS ; k++ )
+  {
+    sum += getCounterLine( counters , k )[value];
+  }
+
+  return sum;
+}
@@ -0,0 +1,83 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef UTIL_COUNTER_H
+#define UTIL_COUNTER_H
+
+#define COUNTER_THREADS  64    // threads with their own counters
+#define COUNTER_LINE     64    // size of a cache line in bytes
+#define COUNTER_VALUES   ( COUNTER_LINE / (int)sizeof(long) )
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the ThreadCounters type (statistics counters that every 
+//  thread updates without locks). Each thread has a cache line of values, so 
+//  that the threads do not share cache lines. The array has one line extra, 
+//  in which the lines are aligned at run time.
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  long            line[COUNTER_THREADS+1][COUNTER_VALUES];
+} ThreadCounters;
+
+
+//------------------------------------------------------------------------------
+//  resetThreadCounters: Sets all counters to zero
+//
+//  Arguments:
+//      counters : the counters
+//
+//------------------------------------------------------------------------------
+
+
+void resetThreadCounters
+
+  ( ThreadCounters*  counters );
+
+
+//------------------------------------------------------------------------------
+//  getThreadCounter: Returns the values of the calling thread
+//
+//  Arguments:
+//      counters : the counters
+//
+//  Return:
+//      long*    : COUNTER_VALUES values on a cache line of their own
+//
+//------------------------------------------------------------------------------
+
+
+long* getThreadCounter
+
+  ( ThreadCounters*  counters );
+
+
+//------------------------------------------------------------------------------
+//  sumThreadCounters: Returns the sum of a value over all threads
+//
+//  Arguments:
+//      counters : the counters
+//      value    : index of the value
+//
+//  Return:
+//      long     : the sum
+//
+//------------------------------------------------------------------------------
+
+
+long sumThreadCounters
+
+  ( ThreadCounters*  counters ,
+    int              value    );
+
+#endif
@@ -0,0 +1,443 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "deflate.h"
+
+#define HASH_BITS    15
+#define HASH_SIZE    (1 << HASH_BITS)
+#define WINDOW_SIZE  32768
+#define MIN_MATCH    3
+#define MAX_MATCH    258
+#define MAX_CHAIN    16
+#define ADLER_BASE   65521
+
+
+//------------------------------------------------------------------------------
+//  Base values and number of extra bits of the length and distance codes
+//------------------------------------------------------------------------------
+
+
+static const int lengthBase[29] = 
+  { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+
+static const int lengthExtra[29] = 
+  { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+static const int distBase[30] = 
+  { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+    513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+
+static const int distExtra[30] = 
+  { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+    8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the BitWriter type (deflate bits are written from the least
+//  significant bit of each byte up)
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  unsigned char  *out;
+  long           pos;
+  uint64_t       buffer;
+  int            count;
+} BitWriter;
+
+
+//------------------------------------------------------------------------------
+//  putBits: Appends the lowest n bits of value
+//------------------------------------------------------------------------------
+
+
+static inline void putBits
+
+  ( BitWriter*   bw    ,
+    uint32_t     value ,
+    int          n     )
+
+{
+  bw->buffer |= (uint64_t)value << bw->count;
+  bw->count  += n;
+
+  while ( bw->count >= 8 )
+  {
+    bw->out[bw->pos++] = (unsigned char)bw->buffer;
+    bw->buffer >>= 8;
+    bw->count   -= 8;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  putCode: Appends a Huffman code, which is stored from its most significant
+//           bit down
+//------------------------------------------------------------------------------
+
+
+static inline void putCode
+
+  ( BitWriter*   bw   ,
+    uint32_t     code ,
+    int          n    )
+
+{
+  uint32_t reversed = 0;
+
+  for ( int k = 0 ; k < n ; k++ )
+  {
+    reversed = ( reversed << 1 ) | ( ( code >> k ) & 1 );
+  }
+
+  putBits( bw , reversed , n );
+}
+
+
+//------------------------------------------------------------------------------
+//  putSymbol: Appends a literal/length symbol with the fixed Huffman code
+//------------------------------------------------------------------------------
+
+
+static inline void putSymbol
+
+  ( BitWriter*   bw     ,
+    int          symbol )
+
+{
+  if ( symbol < 144 )
+  {
+    putCode( bw , 0x30 + symbol , 8 );
+  }
+  else if ( symbol < 256 )
+  {
+    putCode( bw , 0x190 + symbol - 144 , 9 );
+  }
+  else if ( symbol < 280 )
+  {
+    putCode( bw , symbol - 256 , 7 );
+  }
+  else
+  {
+    putCode( bw , 0xc0 + symbol - 280 , 8 );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  putMatch: Appends a length/distance pair
+//------------------------------------------------------------------------------
+
+
+static void putMatch
+
+  ( BitWriter*   bw       ,
+    int          length   ,
+    int          distance )
+
+{
+  int l = 28;
+
+  while ( lengthBase[l] > length )
+  {
+    l--;
+  }
+
+  putSymbol( bw , 257 + l );
+  putBits  ( bw , length - lengthBase[l] , lengthExtra[l] );
+
+  int d = 29;
+
+  while ( distBase[d] > distance )
+  {
+    d--;
+  }
+
+  putCode( bw , d , 5 );
+  putBits( bw , distance - distBase[d] , distExtra[d] );
+}
+
+
+//------------------------------------------------------------------------------
+//  hash3: Hash of the three bytes at p
+//------------------------------------------------------------------------------
+
+
+static inline int hash3
+
+  ( const unsigned char* p )
+
+{
+  uint32_t v = p[0] | ( p[1] << 8 ) | ( p[2] << 16 );
+
+  return (int)( ( v * 2654435761u ) >> ( 32 - HASH_BITS ) );
+}
+
+
+//------------------------------------------------------------------------------
+//  deflateBlockBound: Returns the largest compressed size of n bytes
+//------------------------------------------------------------------------------
+
+
+long deflateBlockBound
+
+  ( long                 n   )
+
+{
+  return n + n / 8 + 16;
+}
+
+
+//------------------------------------------------------------------------------
+//  deflateBlock: Compresses data into a deflate block
+//------------------------------------------------------------------------------
+
+
+long deflateBlock
+
+  ( const unsigned char* in  ,
+    long                 n   ,
+    unsigned char*       out )
+
+{
+  BitWriter bw = { out , 0 , 0 , 0 };
+
+  int *head = (int*)malloc( HASH_SIZE * sizeof(int) );
+  int *prev = (int*)malloc( ( n > 0 ? n : 1 ) * sizeof(int) );
+
+  for ( int h = 0 ; h < HASH_SIZE ; h++ )
+  {
+    head[h] = -1;
+  }
+
+  // Block header: not final, fixed Huffman codes
+
+  putBits( &bw , 2 , 3 );
+
+  long i = 0;
+
+  while ( i < n )
+  {
+    int bestLength   = 0;
+    int bestDistance = 0;
+
+    if ( i + MIN_MATCH <= n )
+    {
+      int  h         = hash3( in + i );
+      long candidate = head[h];
+      int  maxLength = ( n - i < MAX_MATCH ) ? (int)( n - i ) : MAX_MATCH;
+
+      for ( int chain = 0 ; chain < MAX_CHAIN && candidate >= 0 && i - candidate <= WINDOW_SIZE ; chain++ )
+      {
+        int length = 0;
+
+        while ( length < maxLength && in[candidate+length] == in[i+length] )
+        {
+          length++;
+        }
+
+        if ( length > bestLength )
+        {
+          bestLength   = length;
+          bestDistance = (int)( i - candidate );
+
+          if ( length == maxLength )
+          {
+            break;
+          }
+        }
+
+        candidate = prev[candidate];
+      }
+    }
+
+    if ( bestLength >= MIN_MATCH )
+    {
+      putMatch( &bw , bestLength , bestDistance );
+    }
+    else
+    {
+      putSymbol( &bw , in[i] );
+      bestLength = 1;
+    }
+
+    // Insert all positions of the literal or match in the hash chains
+
+    for ( long k = i ; k < i + bestLength ; k++ )
+    {
+      if ( k + MIN_MATCH <= n )
+      {
+        int h = hash3( in + k );
+
+        prev[k] = head[h];
+        head[h] = (int)k;
+      }
+    }
+
+    i += bestLength;
+  }
+
+  // End of block, followed by an empty stored block that aligns the output
+  // to a byte boundary
+
+  putSymbol( &bw , 256 );
+  putBits  ( &bw , 0 , 3 );
+
+  if ( bw.count > 0 )
+  {
+    putBits( &bw , 0 , 8 - bw.count );
+  }
+
+  out[bw.pos++] = 0x00;
+  out[bw.pos++] = 0x00;
+  out[bw.pos++] = 0xff;
+  out[bw.pos++] = 0xff;
+
+  free( head );
+  free( prev );
+
+  return bw.pos;
+}
+
+
+//------------------------------------------------------------------------------
+//  deflateFinish: Writes the final (empty) block of a deflate stream
+//------------------------------------------------------------------------------
+
+
+long deflateFinish
+
+  ( unsigned char*       out )
+
+{
+  // A final stored block without data
+
+  out[0] = 0x01;
+  out[1] = 0x00;
+  out[2] = 0x00;
+  out[3] = 0xff;
+  out[4] = 0xff;
+
+  return 5;
+}
+
+
+//------------------------------------------------------------------------------
+//  updateAdler32: Updates an Adler-32 checksum with data
+//------------------------------------------------------------------------------
+
+
+uint32_t updateAdler32
+
+  ( uint32_t             adler ,
+    const unsigned char* in    ,
+    long                 n     )
+
+{
+  uint32_t s1 = adler & 0xffff;
+  uint32_t s2 = adler >> 16;
+
+  while ( n > 0 )
+  {
+    // 5552 is the largest number of bytes for which s2 does not overflow
+
+    long chunk = ( n < 5552 ) ? n : 5552;
+
+    for ( long k = 0 ; k < chunk ; k++ )
+    {
+      s1 += in[k];
+      s2 += s1;
+    }
+
+    s1 %= ADLER_BASE;
+    s2 %= ADLER_BASE;
+
+    in += chunk;
+    n  -= chunk;
+  }
+
+  return ( s2 << 16 ) | s1;
+}
+
+
+//------------------------------------------------------------------------------
+//  combineAdler32: Returns the Adler-32 checksum of two concatenated parts
+//------------------------------------------------------------------------------
+
+
+uint32_t combineAdler32
+
+  ( uint32_t             adler1 ,
+    uint32_t             adler2 ,
+    long                 n2     )
+
+{
+  uint64_t rem  = (uint64_t)( n2 % ADLER_BASE );
+  uint64_t sum1 = adler1 & 0xffff;
+  uint64_t sum2 = ( rem * sum1 ) % ADLER_BASE;
+
+  sum1 += ( adler2 & 0xffff ) + ADLER_BASE - 1;
+  sum2 += ( adler1 >> 16 ) + ( adler2 >> 16 ) + ADLER_BASE - rem;
+
+  sum1 %= ADLER_BASE;
+  sum2 %= ADLER_BASE;
+
+  return (uint32_t)( ( sum2 << 16 ) | sum1 );
+}
+
+
+//------------------------------------------------------------------------------
+//  updateCRC32: Updates a CRC-32 checksum with data
+//------------------------------------------------------------------------------
+
+
+uint32_t updateCRC32
+
+  ( uint32_t             crc ,
+    const unsigned char* in  ,
+    long                 n   )
+
+{
+  static uint32_t table[256];
+  static int      filled = 0;
+
+  #pragma omp critical (crc32Table)
+  if ( !filled )
+  {
+    for ( uint32_t b = 0 ; b < 256 ; b++ )
+    {
+      uint32_t c = b;
+
+      for ( int k = 0 ; k < 8 ; k++ )
+      {
+        c = ( c & 1 ) ? 0xedb88320u ^ ( c >> 1 ) : c >> 1;
+      }
+
+      table[b] = c;
+    }
+
+    filled = 1;
+  }
+
+  crc = ~crc;
+
+  for ( long k = 0 ; k < n ; k++ )
+  {
+    crc = table[( crc ^ in[k] ) & 0xff] ^ ( crc >> 8 );
+  }
+
+  return ~crc;
+}
@@ -0,0 +1,140 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef UTIL_DEFLATE_H
+#define UTIL_DEFLATE_H
+
+#include <stdint.h>
+
+
+//------------------------------------------------------------------------------
+//  deflateBlockBound: Returns the largest compressed size of n bytes
+//
+//  Arguments:
+//      n       : number of bytes
+//
+//  Return:
+//      long    : the number of bytes of the output buffer
+//
+//------------------------------------------------------------------------------
+
+
+long deflateBlockBound
+
+  ( long                 n   );
+
+
+//------------------------------------------------------------------------------
+//  deflateBlock: Compresses data into a (non final) deflate block with the 
+//                fixed Huffman codes and LZ77 matches within the data, 
+//                followed by an empty stored block to end on a byte boundary.
+//                Blocks of independent parts of a stream can therefore be
+//                compressed in parallel and concatenated. The stream is ended
+//                with deflateFinish.
+//
+//  Arguments:
+//      in      : the data
+//      n       : number of bytes of the data
+//      out     : output buffer of at least deflateBlockBound(n) bytes
+//
+//  Return:
+//      long    : the number of bytes written to out
+//
+//------------------------------------------------------------------------------
+
+
+long deflateBlock
+
+  ( const unsigned char* in  ,
+    long                 n   ,
+    unsigned char*       out );
+
+
+//------------------------------------------------------------------------------
+//  deflateFinish: Writes the final (empty) block of a deflate stream
+//
+//  Arguments:
+//      out     : output buffer of at least 5 bytes
+//
+//  Return:
+//      long    : the number of bytes written to out
+//
+//------------------------------------------------------------------------------
+
+
+long deflateFinish
+
+  ( unsigned char*       out );
+
+
+//------------------------------------------------------------------------------
+//  updateAdler32: Updates an Adler-32 checksum (start value 1) with data
+//
+//  Arguments:
+//      adler   : the checksum of the preceding data
+//      in      : the data
+//      n       : number of bytes of the data
+//
+//  Return:
+//      uint32_t : the checksum
+//
+//------------------------------------------------------------------------------
+
+
+uint32_t updateAdler32
+
+  ( uint32_t             adler ,
+    const unsigned char* in    ,
+    long                 n     );
+
+
+//------------------------------------------------------------------------------
+//  combineAdler32: Returns the Adler-32 checksum of two concatenated parts
+//
+//  Arguments:
+//      adler1  : checksum of the first part
+//      adler2  : checksum of the second part
+//      n2      : number of bytes of the second part
+//
+//  Return:
+//      uint32_t : the checksum of both parts
+//
+//------------------------------------------------------------------------------
+
+
+uint32_t combineAdler32
+
+  ( uint32_t             adler1 ,
+    uint32_t             adler2 ,
+    long                 n2     );
+
+
+//------------------------------------------------------------------------------
+//  updateCRC32: Updates a CRC-32 checksum (start value 0) with data
+//
+//  Arguments:
+//      crc     : the checksum of the preceding data
+//      in      : the data
+//      n       : number of bytes of the data
+//
+//  Return:
+//      uint32_t : the checksum
+//
+//------------------------------------------------------------------------------
+
+
+uint32_t updateCRC32
+
+  ( uint32_t             crc ,
+    const unsigned char* in  ,
+    long                 n   );
+
+#endif
@@ -0,0 +1,336 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <math.h>
+#include "denoise.h"
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the DenoiseFeature type (the features of a pixel that guide
+//  the filter)
+//      normal  : unit normal of the first hit (zero for the background)
+//      depth   : distance to the first hit (INFINITY for the background)
+//      albedo  : color of the material (0-1)
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  float           normal[3];
+  float           depth;
+  float           albedo[3];
+} DenoiseFeature;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the DenoiseLight type (the value of a pixel that is
+//  filtered)
+//      light   : mean color divided by the albedo
+//      var     : variance of the luminance of the mean light
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  float           light[3];
+  float           var;
+} DenoiseLight;
+
+
+static const float kernel[5] = { 1.0f/16.0f , 1.0f/4.0f , 3.0f/8.0f , 1.0f/4.0f , 1.0f/16.0f };
+
+
+//------------------------------------------------------------------------------
+//  getLuminance: Returns the luminance of a color
+//------------------------------------------------------------------------------
+
+
+static float getLuminance
+
+  ( const float*  c )
+
+{
+  return 0.2126f*c[0] + 0.7152f*c[1] + 0.0722f*c[2];
+}
+
+
+//------------------------------------------------------------------------------
+//  getFeatureWeight: Returns the edge-stopping weight of the features of two
+//                    pixels
+//------------------------------------------------------------------------------
+
+
+static float getFeatureWeight
+
+  ( const DenoiseFeature*  p    ,
+    const DenoiseFeature*  q    ,
+    int                    step )
+
+{
+  // The background only mixes with the background
+
+  if ( isinf( p->depth ) || isinf( q->depth ) )
+  {
+    return ( isinf( p->depth ) && isinf( q->depth ) ) ? 1.0f : 0.0f;
+  }
+
+  float dot = p->normal[0]*q->normal[0] + p->normal[1]*q->normal[1] + p->normal[2]*q->normal[2];
+
+  if ( dot <= 0.0f )
+  {
+    return 0.0f;
+  }
+
+  float wn = powf( dot , DENOISE_SIGMA_NORMAL );
+  float wz = fabsf( p->depth - q->depth ) / ( DENOISE_SIGMA_DEPTH * step * p->depth + 1.0e-6f );
+
+  float da = 0.0f;
+
+  for ( int c = 0 ; c < 3 ; c++ )
+  {
+    da += ( p->albedo[c] - q->albedo[c] ) * ( p->albedo[c] - q->albedo[c] );
+  }
+
+  return wn * expf( -wz - da / ( DENOISE_SIGMA_ALBEDO * DENOISE_SIGMA_ALBEDO ) );
+}
+
+
+//------------------------------------------------------------------------------
+//  getFilteredVariance: Returns the variance of a pixel, smoothed by a 3x3
+//                       Gaussian to make the edge-stopping weight of the light
+//                       robust at low sample counts
+//------------------------------------------------------------------------------
+
+
+static float getFilteredVariance
+
+  ( const DenoiseLight*  src    ,
+    int                  width  ,
+    int                  height ,
+    int                  x      ,
+    int                  y      )
+
+{
+  const float g[2] = { 0.25f , 0.125f };
+
+  float sum  = 0.0f;
+  float wsum = 0.0f;
+
+  for ( int dy = -1 ; dy <= 1 ; dy++ )
+  {
+    for ( int dx = -1 ; dx <= 1 ; dx++ )
+    {
+      int qx = x + dx;
+      int qy = y + dy;
+
+      if ( qx < 0 || qy < 0 || qx >= width || qy >= height )
+      {
+        continue;
+      }
+
+      float w = g[abs(dx)] * g[abs(dy)];
+
+      sum  += w * src[(long)qy*width+qx].var;
+      wsum += w;
+    }
+  }
+
+  return sum / wsum;
+}
+
+
+//------------------------------------------------------------------------------
+//  denoiseFilm: Filters the pixels of the film with an edge-avoiding a-trous
+//               wavelet filter
+//------------------------------------------------------------------------------
+
+
+void denoiseFilm
+
+  ( Film*         film   ,
+    AOVFilm*      aov    ,
+    int           levels )
+
+{
+  const int  width  = film->width;
+  const int  height = film->rows;
+  const long pixels = (long)width * height;
+
+  const int depth  = aov->index[0];
+  const int normal = aov->index[1];
+  const int albedo = aov->index[3];
+
+  if ( depth < 0 || normal < 0 || albedo < 0 || levels <= 0 )
+  {
+    return;
+  }
+
+  DenoiseFeature *feature = (DenoiseFeature*)malloc( pixels*sizeof(DenoiseFeature) );
+  DenoiseLight   *buffer  = (DenoiseLight*)malloc( 2*pixels*sizeof(DenoiseLight) );
+
+  DenoiseLight *src = buffer;
+  DenoiseLight *dst = buffer + pixels;
+
+  // The light is the mean color of a pixel divided by its albedo, so that the
+  // texture of the materials is not blurred. The variance of the mean follows
+  // from the squared luminances of the samples.
+
+  #pragma omp parallel for
+  for ( int y = 0 ; y < height ; y++ )
+  {
+    float values[aov->channels];
+
+    for ( int x = 0 ; x < width ; x++ )
+    {
+      const long k = (long)y*width+x;
+      const Pixel *p = &film->p[k];
+
+      DenoiseFeature *f = &feature[k];
+      DenoiseLight   *l = &src[k];
+
+      getAOVPixel( aov , film , x , film->y0+y , values );
+
+      float len = sqrtf( values[normal]*values[normal] + values[normal+1]*values[normal+1] +
+                         values[normal+2]*values[normal+2] );
+
+      for ( int c = 0 ; c < 3 ; c++ )
+      {
+        f->normal[c] = ( len > 0.0f ) ? values[normal+c] / len : 0.0f;
+        f->albedo[c] = values[albedo+c];
+      }
+
+      f->depth = values[depth];
+
+      float inv = ( p->wght > 0.0f ) ? 1.0f / p->wght : 0.0f;
+
+      l->light[0] = inv * p->c.red   / fmaxf( f->albedo[0] , 0.01f );
+      l->light[1] = inv * p->c.green / fmaxf( f->albedo[1] , 0.01f );
+      l->light[2] = inv * p->c.blue  / fmaxf( f->albedo[2] , 0.01f );
+
+      float scale = fmaxf( getLuminance( f->albedo ) , 0.01f );
+      float lum   = getLuminance( l->light );
+
+      if ( p->wght < 1.5f )
+      {
+        l->var = lum * lum;
+      }
+      else
+      {
+        float mean = inv * ( 0.2126f*p->c.red + 0.7152f*p->c.green + 0.0722f*p->c.blue );
+        float var  = ( p->lum2 * inv - mean*mean ) / ( p->wght - 1.0f );
+
+        l->var = fmaxf( var , 0.0f ) / ( scale * scale );
+      }
+    }
+  }
+
+  // Each level doubles the distance between the taps of the kernel. The
+  // variance is filtered along with the light, with the squared weights.
+
+  for ( int level = 0 ; level < levels ; level++ )
+  {
+    const int step = 1 << level;
+
+    #pragma omp parallel for
+    for ( int y = 0 ; y < height ; y++ )
+    {
+      for ( int x = 0 ; x < width ; x++ )
+      {
+        const long k = (long)y*width+x;
+
+        const DenoiseFeature *fp = &feature[k];
+        const DenoiseLight   *lp = &src[k];
+
+        float sigma = DENOISE_SIGMA_COLOR * sqrtf( getFilteredVariance( src , width , height , x , y ) ) + 1.0e-4f;
+        float lum   = getLuminance( lp->light );
+
+        float sum[3] = { 0.0f , 0.0f , 0.0f };
+        float var    = 0.0f;
+        float wsum   = 0.0f;
+
+        for ( int dy = -2 ; dy <= 2 ; dy++ )
+        {
+          int qy = y + dy*step;
+
+          if ( qy < 0 || qy >= height )
+          {
+            continue;
+          }
+
+          for ( int dx = -2 ; dx <= 2 ; dx++ )
+          {
+            int qx = x + dx*step;
+
+            if ( qx < 0 || qx >= width )
+            {
+              continue;
+            }
+
+            const long q = (long)qy*width+qx;
+
+            if ( film->p[q].wght <= 0.0f )
+            {
+              continue;
+            }
+
+            float w = kernel[dx+2] * kernel[dy+2] * getFeatureWeight( fp , &feature[q] , step ) *
+                      expf( -fabsf( lum - getLuminance( src[q].light ) ) / sigma );
+
+            sum[0] += w * src[q].light[0];
+            sum[1] += w * src[q].light[1];
+            sum[2] += w * src[q].light[2];
+            var    += w * w * src[q].var;
+            wsum   += w;
+          }
+        }
+
+        if ( wsum > 0.0f )
+        {
+          dst[k].light[0] = sum[0] / wsum;
+          dst[k].light[1] = sum[1] / wsum;
+          dst[k].light[2] = sum[2] / wsum;
+          dst[k].var      = var / ( wsum * wsum );
+        }
+        else
+        {
+          dst[k] = *lp;
+        }
+      }
+    }
+
+    DenoiseLight *tmp = src;
+
+    src = dst;
+    dst = tmp;
+  }
+
+  // The filtered light is multiplied by the albedo again and stored as the
+  // sum of the samples, so that the weights of the film are kept
+
+  #pragma omp parallel for
+  for ( long k = 0 ; k < pixels ; k++ )
+  {
+    Pixel *p = &film->p[k];
+
+    if ( p->wght <= 0.0f )
+    {
+      continue;
+    }
+
+    p->c.red   = p->wght * src[k].light[0] * fmaxf( feature[k].albedo[0] , 0.01f );
+    p->c.green = p->wght * src[k].light[1] * fmaxf( feature[k].albedo[1] , 0.01f );
+    p->c.blue  = p->wght * src[k].light[2] * fmaxf( feature[k].albedo[2] , 0.01f );
+  }
+
+  free( feature );
+  free( buffer );
+}
@@ -0,0 +1,51 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef UTIL_DENOISE_H
+#define UTIL_DENOISE_H
+
+#include "film.h"
+#include "aov.h"
+
+#define DENOISE_FEATURES     (AOV_DEPTH | AOV_NORMAL | AOV_ALBEDO)
+
+#define DENOISE_SIGMA_COLOR  4.0     // in standard deviations of the pixel
+#define DENOISE_SIGMA_NORMAL 64.0    // exponent of the normal weight
+#define DENOISE_SIGMA_DEPTH  0.05    // relative depth difference per pixel
+#define DENOISE_SIGMA_ALBEDO 0.1     // difference of the albedo (0-1)
+
+
+//------------------------------------------------------------------------------
+//  denoiseFilm: Filters the pixels of the film with an edge-avoiding a-trous
+//               wavelet filter (Dammertz et al., 2010). The light is divided
+//               by the albedo before filtering and multiplied again after.
+//               Each level applies a 5x5 B3-spline kernel with holes of
+//               2^level pixels, whose weights drop across edges of the
+//               normal, depth and albedo planes and across differences of
+//               the light that are large compared to the standard error of
+//               the pixel (Schied et al., 2017).
+//
+//  Arguments:
+//      film    : the film, which must hold the whole image
+//      aov     : the planes of the output variables, with the depth, the
+//                normal and the albedo (DENOISE_FEATURES)
+//      levels  : number of levels of the filter
+//
+//------------------------------------------------------------------------------
+
+
+void denoiseFilm
+
+  ( Film*         film   ,
+    AOVFilm*      aov    ,
+    int           levels );
+
+#endif
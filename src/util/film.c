@@ -14,13 +14,16 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <stdint.h>
 #include "film.h"
+#include "deflate.h"
 
 const int bytesPerPixel = 3; 
 const int fileHeaderSize = 14;
 const int infoHeaderSize = 40;
 
 const char *RESOLUTION = "Resolution";
+const char *MAXMEMORY  = "MaxMemory";
 
 //------------------------------------------------------------------------------
 //  readFilmData: Reads the film data from a file
@@ -32,8 +35,9 @@ Film *readFilmData
   ( FILE*       fin )
 
 {
-  int height = 0;
-  int width  = 0;
+  int    height    = 0;
+  int    width     = 0;
+  double maxMemory = 0.0;
 
   char label[20] = "None";
 
@@ -45,15 +49,37 @@ Film *readFilmData
     {
       fscanf( fin , "%d %d" , &height , &width );
     }
+    else if( strcmp( label , MAXMEMORY ) == 0 )
+    {
+      fscanf( fin , "%le" , &maxMemory );
+    }
 
     fscanf( fin , "%s" , label );
   }
 
+  // With a memory limit (in MB), the film only stores a band of rows and the
+  // image is written to the output files band by band while it is rendered
+
+  int bandSize = height;
+
+  if ( maxMemory > 0.0 && width > 0 )
+  {
+    double rows = maxMemory * 1024.0 * 1024.0 / ( width * sizeof(Pixel) );
+
+    bandSize = ( rows < height ) ? (int)rows : height;
+  }
+
   printf("  FILM\n");
   printf("    Size .................... : %d x %d pixels\n",height,width);
+
+  if ( bandSize < height )
+  {
+    printf("    Band size ............... : %d rows\n",bandSize);
+  }
+
   printf("\n");  
   
-  return createFilm( height , width );
+  return createFilmBand( height , width , bandSize );
 }
 
 
@@ -66,15 +92,35 @@ Film *createFilm
   ( int     height , 
     int     width  )
 
+{
+  return createFilmBand( height , width , height );
+}
+
+
+//------------------------------------------------------------------------------
+//  createFilmBand: Creates a film that stores a band of rows of the image
+//------------------------------------------------------------------------------
+
+Film *createFilmBand
+
+  ( int     height   , 
+    int     width    ,
+    int     bandSize )
+
 {
   int iPix;
+
+  bandSize = ( bandSize < 1 ) ? 1 : ( bandSize > height ? height : bandSize );
   
-  Film *film = (Film*)malloc( height*width*sizeof(Pixel));
+  Film *film = (Film*)malloc( sizeof(Film) + (size_t)bandSize*width*sizeof(Pixel) );
 
-  film -> height = height;
-  film -> width  = width;
+  film -> height   = height;
+  film -> width    = width;
+  film -> y0       = 0;
+  film -> rows     = bandSize;
+  film -> bandSize = bandSize;
 
-  const int nPix = height*width;
+  const int nPix = bandSize*width;
 
   for ( iPix = 0 ; iPix < nPix ; iPix++ )
   {
@@ -82,12 +128,31 @@ Film *createFilm
     film->p[iPix].c.green = 0.0;
     film->p[iPix].c.blue  = 0.0;
     film->p[iPix].wght    = 0.0;
+    film->p[iPix].lum2    = 0.0;
   }
   
   return film;
 }
 
 
+//------------------------------------------------------------------------------
+//  startFilmBand: Moves the band of the film to a new first row
+//------------------------------------------------------------------------------
+
+
+void startFilmBand
+
+  ( Film*   film  ,
+    int     y0    )
+
+{
+  film->y0   = y0;
+  film->rows = ( y0 + film->bandSize < film->height ) ? film->bandSize : film->height - y0;
+
+  memset( film->p , 0 , (size_t)film->rows*film->width*sizeof(Pixel) );
+}
+
+
 //------------------------------------------------------------------------------
 //  storePixelRGB: Stores a pixel in the film
 //------------------------------------------------------------------------------
@@ -101,71 +166,1069 @@ void storePixelRGB
     Color*  color )
 
 {
-  const int w = film->width;
+  addPixelSample( film , i , j , color , 1.0 );
+}
+
+
+//------------------------------------------------------------------------------
+//  addPixelSample: Adds a weighted sample to a pixel in the film
+//------------------------------------------------------------------------------
 
-  film->p[(j*w+i)].c.red   += (float)(color->red);
-  film->p[(j*w+i)].c.green += (float)(color->green); 
-  film->p[(j*w+i)].c.blue  += (float)(color->blue);
 
-  film->p[(j*w+i)].wght    += 1.0;
+void addPixelSample
+  
+  ( Film*   film   ,
+    int     i      , 
+    int     j      ,
+    Color*  color  ,
+    double  weight )
+
+{
+  Pixel *p = &film->p[(j-film->y0)*film->width+i];
+
+  double lum = 0.2126*color->red + 0.7152*color->green + 0.0722*color->blue;
+
+  p->c.red   += weight*color->red;
+  p->c.green += weight*color->green; 
+  p->c.blue  += weight*color->blue;
+
+  p->wght    += weight;
+  p->lum2    += weight*lum*lum;
 }
 
-//-----------------------------------------------------------------------------
-//  saveToBitmap: Saves the film to a bitmap file
-//-----------------------------------------------------------------------------
 
-void saveToBitmap
+//------------------------------------------------------------------------------
+//  getPixelError: Returns the standard error of the mean of a pixel
+//------------------------------------------------------------------------------
 
-  ( Film* film          , 
-    char* imageFileName )
+
+double getPixelError
+  
+  ( Film*   film  ,
+    int     i     , 
+    int     j     )
 
 {
-  BMPFile *bmpfile = (BMPFile*)malloc( film->height*film->width*3*sizeof(float));
-  bmpfile->filename = imageFileName;
+  Pixel *p = &film->p[(j-film->y0)*film->width+i];
 
-  unsigned char padding[3] = {0, 0, 0};
-  int paddingSize = (4 - (film->width*bytesPerPixel) % 4) % 4;
+  if ( p->wght < 1.5 )
+  {
+    return 255.0;
+  }
+
+  double mean = ( 0.2126*p->c.red + 0.7152*p->c.green + 0.0722*p->c.blue ) / p->wght;
+  double var  = ( p->lum2 / p->wght - mean*mean ) * p->wght / ( p->wght - 1.0 );
+
+  if ( var <= 0.0 )
+  {
+    return 0.0;
+  }
+
+  // The output is gamma corrected as sqrt(255*L), the error is scaled with 
+  // the derivative of this function
 
-  unsigned char* fileHeader = createBitmapFileHeader(film->height, film->width, paddingSize);
-  unsigned char* infoHeader = createBitmapInfoHeader(film->height, film->width);
+  return sqrt( var / p->wght ) * sqrt( 255.0 ) / ( 2.0 * sqrt( fmax( mean , 1.0 ) ) );
+}
 
-  FILE* imageFile = fopen(imageFileName, "wb");
+//------------------------------------------------------------------------------
+//  getFilmError: Returns the average error of the pixels of the film
+//------------------------------------------------------------------------------
 
-  fwrite(fileHeader, 1, fileHeaderSize, imageFile);
-  fwrite(infoHeader, 1, infoHeaderSize, imageFile);
 
-  int i;
+double getFilmError
+  
+  ( Film*   film  )
 
-  const int nPix = film->height*film->width;
+{
+  double error = 0.0;
+  long   count = 0;
 
-  float factor;
+  // Pixels without samples are not rendered by this process
 
-  for ( i = 0 ; i < nPix ; i++ )
+  #pragma omp parallel for reduction(+:error,count)
+  for ( int j = film->y0 ; j < film->y0 + film->rows ; j++ )
   {
-    if ( film->p[i].wght < 1.0e-3 )
+    for ( int i = 0 ; i < film->width ; i++ )
     {
-      factor = 0.0;
+      if ( film->p[(j-film->y0)*film->width+i].wght > 0.0 )
+      {
+        error += getPixelError( film , i , j );
+        count++;
+      }
     }
-    else
+  }
+
+  return ( count > 0 ) ? error / count : 0.0;
+}
+
+
+//------------------------------------------------------------------------------
+//  createTile: Creates a tile buffer
+//------------------------------------------------------------------------------
+
+
+Tile *createTile
+
+  ( int     size  )
+
+{
+  Tile *tile = (Tile*)malloc( sizeof(Tile) + size*size*sizeof(Pixel) );
+
+  tile->x0     = 0;
+  tile->y0     = 0;
+  tile->width  = 0;
+  tile->height = 0;
+
+  return tile;
+}
+
+
+//------------------------------------------------------------------------------
+//  getTileCount: Returns the number of tiles of the film
+//------------------------------------------------------------------------------
+
+
+int getTileCount
+
+  ( Film*   film  ,
+    int     size  )
+
+{
+  return ( ( film->width + size - 1 ) / size ) * ( ( film->rows + size - 1 ) / size );
+}
+
+
+//------------------------------------------------------------------------------
+//  compareTileDistance: Compares two tiles by their distance to the centre
+//------------------------------------------------------------------------------
+
+
+static int compareTileDistance
+
+  ( const void*   a ,
+    const void*   b )
+
+{
+  const long *ta = (const long*)a;
+  const long *tb = (const long*)b;
+
+  if ( ta[0] != tb[0] )
+  {
+    return ( ta[0] < tb[0] ) ? -1 : 1;
+  }
+
+  return ( ta[1] < tb[1] ) ? -1 : ( ta[1] > tb[1] );
+}
+
+
+//------------------------------------------------------------------------------
+//  getCentreOutTileOrder: Returns the tiles sorted by their distance to the
+//                         centre of the film
+//------------------------------------------------------------------------------
+
+
+void getCentreOutTileOrder
+
+  ( Film*   film  ,
+    int     size  ,
+    int*    order )
+
+{
+  int tilesX = ( film->width + size - 1 ) / size;
+  int count  = getTileCount( film , size );
+
+  long *keys = (long*)malloc( 2*count*sizeof(long) );
+
+  // Twice the distance of the tile centre to the film centre, in pixels
+
+  for ( int id = 0 ; id < count ; id++ )
+  {
+    long dx = 2*( id % tilesX )*size + size - film->width;
+    long dy = 2*( id / tilesX )*size + size - film->rows;
+
+    keys[2*id  ] = dx*dx + dy*dy;
+    keys[2*id+1] = id;
+  }
+
+  qsort( keys , count , 2*sizeof(long) , compareTileDistance );
+
+  for ( int k = 0 ; k < count ; k++ )
+  {
+    order[k] = (int)keys[2*k+1];
+  }
+
+  free( keys );
+}
+
+
+//------------------------------------------------------------------------------
+//  startTile: Sets the extent of a tile and clears its samples
+//------------------------------------------------------------------------------
+
+
+void startTile
+
+  ( Tile*   tile  ,
+    Film*   film  ,
+    int     size  ,
+    int     id    )
+
+{
+  int tilesX = ( film->width + size - 1 ) / size;
+
+  int yEnd   = film->y0 + film->rows;
+
+  tile->x0     = ( id % tilesX ) * size;
+  tile->y0     = film->y0 + ( id / tilesX ) * size;
+  tile->width  = ( tile->x0 + size < film->width ) ? size : film->width - tile->x0;
+  tile->height = ( tile->y0 + size < yEnd        ) ? size : yEnd        - tile->y0;
+
+  memset( tile->p , 0 , tile->width*tile->height*sizeof(Pixel) );
+}
+
+
+//------------------------------------------------------------------------------
+//  addTileSample: Adds a weighted sample to a pixel of a tile
+//------------------------------------------------------------------------------
+
+
+void addTileSample
+
+  ( Tile*   tile   ,
+    int     i      ,
+    int     j      ,
+    Color*  color  ,
+    double  weight )
+
+{
+  Pixel *p = &tile->p[(j-tile->y0)*tile->width+(i-tile->x0)];
+
+  double lum = 0.2126*color->red + 0.7152*color->green + 0.0722*color->blue;
+
+  p->c.red   += weight*color->red;
+  p->c.green += weight*color->green;
+  p->c.blue  += weight*color->blue;
+
+  p->wght    += weight;
+  p->lum2    += weight*lum*lum;
+}
+
+
+//------------------------------------------------------------------------------
+//  flushTile: Adds the samples of a tile to the film
+//------------------------------------------------------------------------------
+
+
+void flushTile
+
+  ( Film*   film  ,
+    Tile*   tile  )
+
+{
+  for ( int j = 0 ; j < tile->height ; j++ )
+  {
+    Pixel *src = &tile->p[j*tile->width];
+    Pixel *dst = &film->p[(tile->y0-film->y0+j)*film->width+tile->x0];
+
+    for ( int i = 0 ; i < tile->width ; i++ )
     {
-      factor = 1.0/(255.0*film->p[i].wght);
+      dst[i].c.red   += src[i].c.red;
+      dst[i].c.green += src[i].c.green;
+      dst[i].c.blue  += src[i].c.blue;
+      dst[i].wght    += src[i].wght;
+      dst[i].lum2    += src[i].lum2;
     }
-	
-    bmpfile->data[3*i+2] = (unsigned char)(sqrt(film->p[i].c.red   * factor) * 255.0);
-    bmpfile->data[3*i+1] = (unsigned char)(sqrt(film->p[i].c.green * factor) * 255.0);
-    bmpfile->data[3*i+0] = (unsigned char)(sqrt(film->p[i].c.blue  * factor) * 255.0);
   }
- 
-  for( i=0; i<film->height; i++)
+}
+
+//------------------------------------------------------------------------------
+//  getLinearRow: Computes the linear color of the pixels in row j of the film.
+//                The channels are stored with the given stride, so that both
+//                interleaved and planar rows can be filled.
+//------------------------------------------------------------------------------
+
+
+static void getLinearRow
+
+  ( Film*   film   ,
+    int     j      ,
+    float*  red    ,
+    float*  green  ,
+    float*  blue   ,
+    int     stride )
+
+{
+  const Pixel *p = &film->p[(j-film->y0)*film->width];
+
+  #pragma omp simd
+  for ( int i = 0 ; i < film->width ; i++ )
   {
-    fwrite((bmpfile->data+(i*film->width*bytesPerPixel)), bytesPerPixel, film->width, imageFile);
-    fwrite(padding, 1, paddingSize, imageFile);
+    float factor = ( p[i].wght < 1.0e-3f ) ? 0.0f : 1.0f / ( 255.0f * p[i].wght );
+
+    red  [i*stride] = (float)p[i].c.red   * factor;
+    green[i*stride] = (float)p[i].c.green * factor;
+    blue [i*stride] = (float)p[i].c.blue  * factor;
   }
-  
-  fclose(imageFile);
-  
-  free( film );
-  free( bmpfile );
+}
+
+
+//------------------------------------------------------------------------------
+//  writeInt: Writes a little endian 32 or 64 bit integer
+//------------------------------------------------------------------------------
+
+
+static void writeInt
+
+  ( FILE*      file  ,
+    uint64_t   value ,
+    int        bytes )
+
+{
+  unsigned char data[8];
+
+  for ( int k = 0 ; k < bytes ; k++ )
+  {
+    data[k] = (unsigned char)( value >> ( 8*k ) );
+  }
+
+  fwrite( data , 1 , bytes , file );
+}
+
+
+//------------------------------------------------------------------------------
+//  writeAttribute: Writes the name, type and size of an EXR header attribute
+//------------------------------------------------------------------------------
+
+
+static void writeAttribute
+
+  ( FILE*        file ,
+    const char*  name ,
+    const char*  type ,
+    int          size )
+
+{
+  fwrite( name , 1 , strlen(name)+1 , file );
+  fwrite( type , 1 , strlen(type)+1 , file );
+  writeInt( file , size , 4 );
+}
+
+
+//------------------------------------------------------------------------------
+//  openOutputFile: Opens an output file of a film writer
+//------------------------------------------------------------------------------
+
+
+static FILE* openOutputFile
+
+  ( char*   fileName )
+
+{
+  if ( fileName == NULL )
+  {
+    return NULL;
+  }
+
+  FILE* file = fopen( fileName , "wb" );
+
+  if ( file == NULL )
+  {
+    printf("ERROR: Could not open file %s\n",fileName);
+  }
+
+  return file;
+}
+
+
+//------------------------------------------------------------------------------
+//  writeEXRHeader: Writes the header and the offset table of a scanline EXR
+//                  file. The scanlines are stored from the bottom to the top
+//                  of the image (decreasing y), which is the order of the rows
+//                  in the film.
+//------------------------------------------------------------------------------
+
+
+void writeEXRHeader
+
+  ( FILE*         file     ,
+    int           height   ,
+    int           width    ,
+    const char**  channels ,
+    int           count    )
+
+{
+  // Magic number and version 2 (single part scanline file)
+
+  const unsigned char magic[4] = { 0x76 , 0x2f , 0x31 , 0x01 };
+
+  fwrite( magic , 1 , 4 , file );
+  writeInt( file , 2 , 4 );
+
+  // The channels are stored as 32 bit floats
+
+  int listSize = 1;
+
+  for ( int c = 0 ; c < count ; c++ )
+  {
+    listSize += strlen( channels[c] ) + 1 + 16;
+  }
+
+  writeAttribute( file , "channels" , "chlist" , listSize );
+
+  for ( int c = 0 ; c < count ; c++ )
+  {
+    fwrite( channels[c] , 1 , strlen( channels[c] ) + 1 , file );
+    writeInt( file , 2 , 4 );  // FLOAT
+    writeInt( file , 0 , 4 );  // pLinear and reserved
+    writeInt( file , 1 , 4 );  // xSampling
+    writeInt( file , 1 , 4 );  // ySampling
+  }
+
+  fputc( 0 , file );
+
+  writeAttribute( file , "compression" , "compression" , 1 );
+  fputc( 0 , file );
+
+  for ( int k = 0 ; k < 2 ; k++ )
+  {
+    writeAttribute( file , k == 0 ? "dataWindow" : "displayWindow" , "box2i" , 16 );
+    writeInt( file , 0        , 4 );
+    writeInt( file , 0        , 4 );
+    writeInt( file , width-1  , 4 );
+    writeInt( file , height-1 , 4 );
+  }
+
+  writeAttribute( file , "lineOrder" , "lineOrder" , 1 );
+  fputc( 1 , file );
+
+  float one = 1.0f;
+  float zero[2] = { 0.0f , 0.0f };
+
+  writeAttribute( file , "pixelAspectRatio" , "float" , 4 );
+  fwrite( &one , 4 , 1 , file );
+
+  writeAttribute( file , "screenWindowCenter" , "v2f" , 8 );
+  fwrite( zero , 4 , 2 , file );
+
+  writeAttribute( file , "screenWindowWidth" , "float" , 4 );
+  fwrite( &one , 4 , 1 , file );
+
+  fputc( 0 , file );
+
+  // Offset table: every scanline is a chunk of the row number, the data size 
+  // and the values of the row, channel after channel
+
+  const uint64_t chunkSize = 8 + 4*(uint64_t)count*width;
+  const uint64_t start     = (uint64_t)ftell( file ) + 8*(uint64_t)height;
+
+  for ( int y = 0 ; y < height ; y++ )
+  {
+    writeInt( file , start + (uint64_t)( height-1-y )*chunkSize , 8 );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  clampByte: Converts a value to an 8 bit value, values above 255 become 255
+//------------------------------------------------------------------------------
+
+
+static inline unsigned char clampByte
+
+  ( double   v )
+
+{
+  return (unsigned char)( v < 255.0 ? v : 255.0 );
+}
+
+
+//------------------------------------------------------------------------------
+//  tonemapRow: Converts row j of the film to 8 bit colors, in BGR order for 
+//              bitmaps and in RGB order for PNG images. The default gamma of
+//              2 is a square root.
+//------------------------------------------------------------------------------
+
+
+static void tonemapRow
+
+  ( FilmWriter*     writer ,
+    Film*           film   ,
+    int             j      ,
+    unsigned char*  out    ,
+    int             bgr    )
+
+{
+  const Pixel *p = &film->p[(j-film->y0)*film->width];
+
+  const double exposure = writer->exposure;
+  const double invGamma = 1.0 / writer->gamma;
+
+  const int r = bgr ? 2 : 0;
+  const int b = bgr ? 0 : 2;
+
+  if ( writer->gamma == 2.0 )
+  {
+    #pragma omp simd
+    for ( int i = 0 ; i < film->width ; i++ )
+    {
+      float factor = ( p[i].wght < 1.0e-3 ) ? 0.0 : exposure/(255.0*p[i].wght);
+
+      out[3*i+r] = clampByte( sqrt(p[i].c.red   * factor) * 255.0 );
+      out[3*i+1] = clampByte( sqrt(p[i].c.green * factor) * 255.0 );
+      out[3*i+b] = clampByte( sqrt(p[i].c.blue  * factor) * 255.0 );
+    }
+  }
+  else
+  {
+    for ( int i = 0 ; i < film->width ; i++ )
+    {
+      float factor = ( p[i].wght < 1.0e-3 ) ? 0.0 : exposure/(255.0*p[i].wght);
+
+      out[3*i+r] = clampByte( pow(p[i].c.red   * factor , invGamma) * 255.0 );
+      out[3*i+1] = clampByte( pow(p[i].c.green * factor , invGamma) * 255.0 );
+      out[3*i+b] = clampByte( pow(p[i].c.blue  * factor , invGamma) * 255.0 );
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  countRow: Converts the number of samples of row j to grey values (BGR)
+//------------------------------------------------------------------------------
+
+
+static void countRow
+
+  ( FilmWriter*     writer ,
+    Film*           film   ,
+    int             j      ,
+    unsigned char*  out    )
+
+{
+  const Pixel *p = &film->p[(j-film->y0)*film->width];
+
+  #pragma omp simd
+  for ( int i = 0 ; i < film->width ; i++ )
+  {
+    double level = 255.0 * p[i].wght / writer->maxSamples;
+
+    unsigned char grey = clampByte( level );
+
+    out[3*i+0] = grey;
+    out[3*i+1] = grey;
+    out[3*i+2] = grey;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  paeth: The Paeth predictor of PNG
+//------------------------------------------------------------------------------
+
+
+static inline unsigned char paeth
+
+  ( int a ,
+    int b ,
+    int c )
+
+{
+  int p  = a + b - c;
+  int pa = abs( p - a );
+  int pb = abs( p - b );
+  int pc = abs( p - c );
+
+  if ( pa <= pb && pa <= pc )
+  {
+    return (unsigned char)a;
+  }
+
+  return (unsigned char)( ( pb <= pc ) ? b : c );
+}
+
+
+//------------------------------------------------------------------------------
+//  compressPNGBlock: Tonemaps, filters and compresses the film rows y0 up to
+//                    y1. The PNG rows run from the top of the image down, so
+//                    the block starts with row y1-1. The first row of a block
+//                    uses the Sub filter and the others the Paeth filter, so 
+//                    that blocks do not depend on each other.
+//------------------------------------------------------------------------------
+
+
+static unsigned char* compressPNGBlock
+
+  ( FilmWriter*   writer ,
+    Film*         film   ,
+    int           y0     ,
+    int           y1     ,
+    PNGBlock*     block  )
+
+{
+  const int stride = 3*film->width;
+
+  long rawSize = (long)( 1 + stride ) * ( y1 - y0 );
+
+  unsigned char *raw   = (unsigned char*)malloc( rawSize );
+  unsigned char *rows  = (unsigned char*)malloc( 2*stride );
+  unsigned char *above = NULL;
+
+  for ( int j = y1-1 ; j >= y0 ; j-- )
+  {
+    unsigned char *row = rows + ( j % 2 )*stride;
+    unsigned char *dst = raw + (long)( y1-1-j )*( 1 + stride );
+
+    tonemapRow( writer , film , j , row , 0 );
+
+    if ( above == NULL )
+    {
+      dst[0] = 1;
+
+      for ( int k = 0 ; k < stride ; k++ )
+      {
+        dst[1+k] = row[k] - ( k >= 3 ? row[k-3] : 0 );
+      }
+    }
+    else
+    {
+      dst[0] = 4;
+
+      for ( int k = 0 ; k < stride ; k++ )
+      {
+        int a = ( k >= 3 ) ? row[k-3]   : 0;
+        int c = ( k >= 3 ) ? above[k-3] : 0;
+
+        dst[1+k] = row[k] - paeth( a , above[k] , c );
+      }
+    }
+
+    above = row;
+  }
+
+  unsigned char *data = (unsigned char*)malloc( deflateBlockBound( rawSize ) );
+
+  block->size    = deflateBlock( raw , rawSize , data );
+  block->rawSize = rawSize;
+  block->adler   = updateAdler32( 1 , raw , rawSize );
+
+  free( raw );
+  free( rows );
+
+  return data;
+}
+
+
+//------------------------------------------------------------------------------
+//  writePNGChunk: Writes a PNG chunk with its length and checksum
+//------------------------------------------------------------------------------
+
+
+static void writePNGChunk
+
+  ( FILE*                file ,
+    const char*          type ,
+    const unsigned char* data ,
+    long                 size )
+
+{
+  unsigned char length[4] = { size >> 24 , size >> 16 , size >> 8 , size };
+
+  uint32_t crc = updateCRC32( 0 , (const unsigned char*)type , 4 );
+  crc = updateCRC32( crc , data , size );
+
+  unsigned char check[4] = { crc >> 24 , crc >> 16 , crc >> 8 , crc };
+
+  fwrite( length , 1 , 4 , file );
+  fwrite( type , 1 , 4 , file );
+  fwrite( data , 1 , size , file );
+  fwrite( check , 1 , 4 , file );
+}
+
+
+//------------------------------------------------------------------------------
+//  writePNG: Writes the PNG file from the compressed blocks. The blocks are
+//            stored from the bottom of the image up and written in reverse.
+//------------------------------------------------------------------------------
+
+
+static void writePNG
+
+  ( FilmWriter*   writer )
+
+{
+  const unsigned char signature[8] = { 0x89 , 'P' , 'N' , 'G' , '\r' , '\n' , 0x1a , '\n' };
+
+  unsigned char header[13] = 
+    { writer->width  >> 24 , writer->width  >> 16 , writer->width  >> 8 , writer->width  ,
+      writer->height >> 24 , writer->height >> 16 , writer->height >> 8 , writer->height ,
+      8 , 2 , 0 , 0 , 0 };  // 8 bit RGB, deflate, no interlacing
+
+  fwrite( signature , 1 , 8 , writer->png );
+  writePNGChunk( writer->png , "IHDR" , header , 13 );
+
+  // zlib header (deflate with a 32 kB window)
+
+  const unsigned char zlibHeader[2] = { 0x78 , 0x01 };
+
+  writePNGChunk( writer->png , "IDAT" , zlibHeader , 2 );
+
+  long *offsets = (long*)malloc( ( writer->blockCount + 1 ) * sizeof(long) );
+  long maxSize = 0;
+
+  offsets[0] = 0;
+
+  for ( int k = 0 ; k < writer->blockCount ; k++ )
+  {
+    offsets[k+1] = offsets[k] + writer->blocks[k].size;
+    maxSize = ( writer->blocks[k].size > maxSize ) ? writer->blocks[k].size : maxSize;
+  }
+
+  unsigned char *data = (unsigned char*)malloc( maxSize + 1 );
+  uint32_t adler = 1;
+
+  for ( int k = writer->blockCount-1 ; k >= 0 ; k-- )
+  {
+    PNGBlock *block = &writer->blocks[k];
+
+    fseek( writer->pngData , offsets[k] , SEEK_SET );
+
+    if ( fread( data , 1 , block->size , writer->pngData ) != (size_t)block->size )
+    {
+      printf("ERROR: Could not read the compressed image\n");
+      break;
+    }
+
+    writePNGChunk( writer->png , "IDAT" , data , block->size );
+
+    adler = combineAdler32( adler , block->adler , block->rawSize );
+  }
+
+  unsigned char end[9];
+  long n = deflateFinish( end );
+
+  end[n++] = adler >> 24;
+  end[n++] = adler >> 16;
+  end[n++] = adler >> 8;
+  end[n++] = adler;
+
+  writePNGChunk( writer->png , "IDAT" , end , n );
+  writePNGChunk( writer->png , "IEND" , NULL , 0 );
+
+  free( offsets );
+  free( data );
+}
+
+
+//------------------------------------------------------------------------------
+//  openFilmWriter: Opens the output files of a film
+//------------------------------------------------------------------------------
+
+
+FilmWriter* openFilmWriter
+
+  ( Film*   film       ,
+    char*   imageName  ,
+    char*   pfmName    ,
+    char*   exrName    ,
+    char*   countName  ,
+    int     maxSamples )
+
+{
+  FilmWriter *writer = (FilmWriter*)malloc( sizeof(FilmWriter) );
+
+  writer->height     = film->height;
+  writer->width      = film->width;
+  writer->next       = 0;
+  writer->maxSamples = maxSamples;
+  writer->exposure   = 1.0;
+  writer->gamma      = 2.0;
+
+  char *dot = ( imageName != NULL ) ? strrchr( imageName , '.' ) : NULL;
+  int  png  = ( dot != NULL && strcmp( dot , ".png" ) == 0 );
+
+  writer->bmp     = openOutputFile( png ? NULL : imageName );
+  writer->png     = openOutputFile( png ? imageName : NULL );
+  writer->pngData = ( writer->png != NULL ) ? tmpfile() : NULL;
+  writer->pfm     = openOutputFile( pfmName   );
+  writer->exr     = openOutputFile( exrName   );
+  writer->counts  = openOutputFile( countName );
+
+  writer->blocks     = NULL;
+  writer->blockCount = 0;
+
+  writer->buffer = (unsigned char*)malloc( WRITER_ROWS * ( 12*(long)film->width + 8 ) );
+
+  int paddingSize = (4 - (film->width*bytesPerPixel) % 4) % 4;
+
+  FILE *bitmaps[2] = { writer->bmp , writer->counts };
+
+  for ( int k = 0 ; k < 2 ; k++ )
+  {
+    if ( bitmaps[k] != NULL )
+    {
+      fwrite( createBitmapFileHeader( film->height , film->width , paddingSize ) , 1 , fileHeaderSize , bitmaps[k] );
+      fwrite( createBitmapInfoHeader( film->height , film->width ) , 1 , infoHeaderSize , bitmaps[k] );
+    }
+  }
+
+  // A negative PFM scale denotes little endian data. The rows are stored 
+  // from the bottom to the top of the image, like in the film.
+
+  if ( writer->pfm != NULL )
+  {
+    fprintf( writer->pfm , "PF\n%d %d\n-1.0\n" , film->width , film->height );
+  }
+
+  if ( writer->exr != NULL )
+  {
+    const char *channels[3] = { "B" , "G" , "R" };
+
+    writeEXRHeader( writer->exr , film->height , film->width , channels , 3 );
+  }
+
+  return writer;
+}
+
+
+//------------------------------------------------------------------------------
+//  writeFilmRows: Writes the rows of the band of the film to the output files
+//------------------------------------------------------------------------------
+
+
+void writeFilmRows
+
+  ( FilmWriter*   writer ,
+    Film*         film   )
+
+{
+  const int w = film->width;
+
+  const int paddingSize = (4 - (w*bytesPerPixel) % 4) % 4;
+  const int bmpStride   = w*bytesPerPixel + paddingSize;
+  const int pfmStride   = 12*w;
+  const int exrStride   = 12*w + 8;
+
+  if ( film->y0 != writer->next )
+  {
+    printf("ERROR: Row %d of the film is written out of order\n",film->y0);
+    return;
+  }
+
+  // The rows are converted in parallel, in groups of WRITER_ROWS rows that 
+  // are written to each file with a single fwrite
+
+  for ( int j0 = film->y0 ; j0 < film->y0 + film->rows ; j0 += WRITER_ROWS )
+  {
+    int n = ( j0 + WRITER_ROWS < film->y0 + film->rows ) ? WRITER_ROWS : film->y0 + film->rows - j0;
+
+    if ( writer->bmp != NULL )
+    {
+      #pragma omp parallel for
+      for ( int r = 0 ; r < n ; r++ )
+      {
+        unsigned char *out = writer->buffer + r*bmpStride;
+
+        tonemapRow( writer , film , j0+r , out , 1 );
+        memset( out + w*bytesPerPixel , 0 , paddingSize );
+      }
+
+      fwrite( writer->buffer , bmpStride , n , writer->bmp );
+    }
+
+    if ( writer->counts != NULL )
+    {
+      #pragma omp parallel for
+      for ( int r = 0 ; r < n ; r++ )
+      {
+        unsigned char *out = writer->buffer + r*bmpStride;
+
+        countRow( writer , film , j0+r , out );
+        memset( out + w*bytesPerPixel , 0 , paddingSize );
+      }
+
+      fwrite( writer->buffer , bmpStride , n , writer->counts );
+    }
+
+    if ( writer->pfm != NULL )
+    {
+      #pragma omp parallel for
+      for ( int r = 0 ; r < n ; r++ )
+      {
+        float *row = (float*)( writer->buffer + r*pfmStride );
+
+        getLinearRow( film , j0+r , row , row+1 , row+2 , 3 );
+      }
+
+      fwrite( writer->buffer , pfmStride , n , writer->pfm );
+    }
+
+    if ( writer->exr != NULL )
+    {
+      // The EXR chunks are stored from the bottom of the image up 
+
+      #pragma omp parallel for
+      for ( int r = 0 ; r < n ; r++ )
+      {
+        unsigned char *chunk = writer->buffer + (long)r*exrStride;
+        float *row = (float*)( chunk + 8 );
+
+        int32_t y    = film->height-1-(j0+r);
+        int32_t size = 12*w;
+
+        memcpy( chunk   , &y    , 4 );
+        memcpy( chunk+4 , &size , 4 );
+
+        getLinearRow( film , j0+r , row+2*w , row+w , row , 1 );
+      }
+
+      fwrite( writer->buffer , exrStride , n , writer->exr );
+    }
+  }
+
+  // The PNG rows are compressed in blocks of PNG_BLOCK_ROWS rows in parallel
+  // and stored in the temporary file until the writer is closed
+
+  if ( writer->png != NULL )
+  {
+    int nBlocks = ( film->rows + PNG_BLOCK_ROWS - 1 ) / PNG_BLOCK_ROWS;
+
+    writer->blocks = (PNGBlock*)realloc( writer->blocks , ( writer->blockCount + nBlocks ) * sizeof(PNGBlock) );
+
+    PNGBlock *blocks = writer->blocks + writer->blockCount;
+    unsigned char **data = (unsigned char**)malloc( nBlocks * sizeof(unsigned char*) );
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for ( int k = 0 ; k < nBlocks ; k++ )
+    {
+      int y0 = film->y0 + k*PNG_BLOCK_ROWS;
+      int y1 = ( y0 + PNG_BLOCK_ROWS < film->y0 + film->rows ) ? y0 + PNG_BLOCK_ROWS : film->y0 + film->rows;
+
+      data[k] = compressPNGBlock( writer , film , y0 , y1 , &blocks[k] );
+    }
+
+    for ( int k = 0 ; k < nBlocks ; k++ )
+    {
+      fwrite( data[k] , 1 , blocks[k].size , writer->pngData );
+      free( data[k] );
+    }
+
+    writer->blockCount += nBlocks;
+
+    free( data );
+  }
+
+  writer->next += film->rows;
+}
+
+
+//------------------------------------------------------------------------------
+//  closeFilmWriter: Closes the output files and frees the writer
+//------------------------------------------------------------------------------
+
+
+void closeFilmWriter
+
+  ( FilmWriter*   writer )
+
+{
+  if ( writer->next != writer->height )
+  {
+    printf("ERROR: Only %d of the %d rows of the film are written\n",writer->next,writer->height);
+  }
+
+  if ( writer->png != NULL && writer->pngData != NULL )
+  {
+    writePNG( writer );
+  }
+
+  FILE *files[6] = { writer->bmp , writer->png , writer->pngData , 
+                     writer->pfm , writer->exr , writer->counts };
+
+  for ( int k = 0 ; k < 6 ; k++ )
+  {
+    if ( files[k] != NULL )
+    {
+      fclose( files[k] );
+    }
+  }
+
+  free( writer->blocks );
+  free( writer->buffer );
+  free( writer );
+}
+
+
+//------------------------------------------------------------------------------
+//  saveToPFM: Saves the linear pixel values of the film as a PFM file
+//------------------------------------------------------------------------------
+
+
+void saveToPFM
+
+  ( Film* film          , 
+    char* imageFileName )
+
+{
+  FilmWriter *writer = openFilmWriter( film , NULL , imageFileName , NULL , NULL , 0 );
+
+  writeFilmRows( writer , film );
+  closeFilmWriter( writer );
+}
+
+
+//------------------------------------------------------------------------------
+//  saveToEXR: Saves the linear pixel values of the film as an EXR file
+//------------------------------------------------------------------------------
+
+
+void saveToEXR
+
+  ( Film* film          , 
+    char* imageFileName )
+
+{
+  FilmWriter *writer = openFilmWriter( film , NULL , NULL , imageFileName , NULL , 0 );
+
+  writeFilmRows( writer , film );
+  closeFilmWriter( writer );
+}
+
+
+//-----------------------------------------------------------------------------
+//  saveToBitmap: Saves the film to a bitmap file
+//-----------------------------------------------------------------------------
+
+void saveToBitmap
+
+  ( Film* film          , 
+    char* imageFileName )
+
+{
+  FilmWriter *writer = openFilmWriter( film , imageFileName , NULL , NULL , NULL , 0 );
+
+  writeFilmRows( writer , film );
+  closeFilmWriter( writer );
+  
+  free( film );
+}
+
+
+//------------------------------------------------------------------------------
+//  saveSampleCountBitmap: Saves the number of samples per pixel as a bitmap
+//------------------------------------------------------------------------------
+
+
+void saveSampleCountBitmap
+
+  ( Film* film          , 
+    char* imageFileName ,
+    int   maxSamples    )
+
+{
+  FilmWriter *writer = openFilmWriter( film , NULL , NULL , NULL , imageFileName , maxSamples );
+
+  writeFilmRows( writer , film );
+  closeFilmWriter( writer );
 }
 
 
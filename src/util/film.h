@@ -14,6 +14,7 @@
 #define UTIL_FILM_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include "color.h"
 
 //------------------------------------------------------------------------------
@@ -30,6 +31,9 @@ typedef struct
 
 //------------------------------------------------------------------------------
 //  Declaration of the Pixel type (a pixel in the film)
+//      c       : sum of the weighted sample colors
+//      wght    : sum of the weights (number of samples)
+//      lum2    : sum of the weighted squared sample luminances
 //------------------------------------------------------------------------------
 
 
@@ -37,11 +41,19 @@ typedef struct
 {
   Color           c;
   float           wght;
+  float           lum2;
 } Pixel;
 
 
 //------------------------------------------------------------------------------
 //  Declaration of the Film type (a film)
+//      height   : height of the image
+//      width    : width of the image
+//      y0       : first image row that is stored in p
+//      rows     : number of rows that is stored in p
+//      bandSize : largest number of rows that fits in p (height, unless the
+//                 image is rendered in bands)
+//      p        : the pixels of the stored rows
 //------------------------------------------------------------------------------
 
 
@@ -49,10 +61,90 @@ typedef struct
 {
   int             height;
   int             width;
+  int             y0;
+  int             rows;
+  int             bandSize;
   Pixel           p[];
 } Film;
 
 
+//------------------------------------------------------------------------------
+//  Declaration of the Tile type (a block of the film that is rendered by a 
+//  single thread)
+//      x0,y0   : first pixel of the tile in the film
+//      width   : number of pixels in a row (smaller at the edge of the film)
+//      height  : number of rows (smaller at the edge of the film)
+//      p       : the samples of the tile, in scanline order
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  int             x0;
+  int             y0;
+  int             width;
+  int             height;
+  Pixel           p[];
+} Tile;
+
+
+#define WRITER_ROWS      64    // rows that are converted in parallel
+#define PNG_BLOCK_ROWS   16    // rows that are compressed by one thread
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the PNGBlock type (a compressed block of rows of a PNG 
+//  image, stored in the temporary file of the writer)
+//      size     : number of compressed bytes
+//      rawSize  : number of filtered bytes
+//      adler    : Adler-32 checksum of the filtered bytes
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  long            size;
+  long            rawSize;
+  uint32_t        adler;
+} PNGBlock;
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the FilmWriter type (output files that are written row by
+//  row, while the film is rendered)
+//      next     : next image row that is written
+//      exposure : factor of the pixel values in the 8 bit images
+//      gamma    : gamma of the 8 bit images (2 = square root)
+//      bmp      : bitmap file
+//      png      : PNG file, written when the writer is closed
+//      pngData  : temporary file with the compressed PNG blocks
+//      pfm      : linear PFM file
+//      exr      : linear EXR file
+//      counts   : bitmap of the number of samples per pixel
+//      buffer   : encoded rows, written with a single fwrite
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  int             height;
+  int             width;
+  int             next;
+  int             maxSamples;
+  double          exposure;
+  double          gamma;
+  FILE            *bmp;
+  FILE            *png;
+  FILE            *pngData;
+  PNGBlock        *blocks;
+  int             blockCount;
+  FILE            *pfm;
+  FILE            *exr;
+  FILE            *counts;
+  unsigned char   *buffer;
+} FilmWriter;
+
+
 //------------------------------------------------------------------------------
 //  readFilmData: Reads the film data from a file
 //
@@ -89,6 +181,45 @@ Film *createFilm
     int           width  );
 
 
+//------------------------------------------------------------------------------
+//  createFilmBand: Creates a film that stores at most bandSize rows of the 
+//                  image at a time. The first band starts at row 0.
+//
+//  Arguments:
+//      height   : height of the image
+//      width    : width of the image
+//      bandSize : number of rows in a band
+//
+//  Return:
+//      Film*    : a pointer to the film
+//
+//------------------------------------------------------------------------------
+
+
+Film *createFilmBand
+
+  ( int           height   , 
+    int           width    ,
+    int           bandSize );
+
+
+//------------------------------------------------------------------------------
+//  startFilmBand: Moves the band of the film to the rows starting at y0 and
+//                 clears its pixels
+//
+//  Arguments:
+//      film    : the film
+//      y0      : first row of the new band
+//
+//------------------------------------------------------------------------------
+
+
+void startFilmBand
+
+  ( Film*         film  ,
+    int           y0    );
+
+
 //------------------------------------------------------------------------------
 //  storePixelRGB: Stores a pixel in the film
 //
@@ -109,6 +240,182 @@ void storePixelRGB
     Color*        color );
 
 
+//------------------------------------------------------------------------------
+//  addPixelSample: Adds a weighted sample to a pixel in the film
+//
+//  Arguments:
+//      film    : Film in which the sample is stored
+//      i       : row index of the pixel
+//      j       : column index of the pixel
+//      color   : color of the sample
+//      weight  : weight of the sample
+//
+//------------------------------------------------------------------------------
+
+
+void addPixelSample
+  
+  ( Film*         film   ,
+    int           i      , 
+    int           j      ,
+    Color*        color  ,
+    double        weight );
+
+
+//------------------------------------------------------------------------------
+//  getPixelError: Returns the standard error of the mean of a pixel, 
+//                 expressed in levels of the 8 bit output image
+//
+//  Arguments:
+//      film    : Film that contains the pixel
+//      i       : row index of the pixel
+//      j       : column index of the pixel
+//
+//  Return:
+//      double  : the estimated error, 255 if there are less than 2 samples
+//
+//------------------------------------------------------------------------------
+
+
+double getPixelError
+  
+  ( Film*         film  ,
+    int           i     , 
+    int           j     );
+
+
+//------------------------------------------------------------------------------
+//  getFilmError: Returns the average error of the pixels of the film
+//
+//  Arguments:
+//      film    : the film
+//
+//  Return:
+//      double  : the average of getPixelError over the pixels with samples
+//
+//------------------------------------------------------------------------------
+
+
+double getFilmError
+  
+  ( Film*         film  );
+
+
+//------------------------------------------------------------------------------
+//  createTile: Creates a tile buffer for tiles of size x size pixels
+//
+//  Arguments:
+//      size    : the tile size
+//
+//  Return:
+//      Tile*   : a pointer to the tile (to be freed with free)
+//
+//------------------------------------------------------------------------------
+
+
+Tile *createTile
+
+  ( int           size  );
+
+
+//------------------------------------------------------------------------------
+//  getTileCount: Returns the number of tiles of the film
+//
+//  Arguments:
+//      film    : the film
+//      size    : the tile size
+//
+//  Return:
+//      int     : the number of tiles
+//
+//------------------------------------------------------------------------------
+
+
+int getTileCount
+
+  ( Film*         film  ,
+    int           size  );
+
+
+//------------------------------------------------------------------------------
+//  getCentreOutTileOrder: Returns the tiles sorted by their distance to the
+//                         centre of the film, so that the centre of the image
+//                         is rendered first
+//
+//  Arguments:
+//      film    : the film
+//      size    : the tile size
+//      order   : the numbers of the tiles (getTileCount values)
+//
+//------------------------------------------------------------------------------
+
+
+void getCentreOutTileOrder
+
+  ( Film*         film  ,
+    int           size  ,
+    int*          order );
+
+
+//------------------------------------------------------------------------------
+//  startTile: Sets the extent of a tile and clears its samples. The tiles are
+//             numbered row by row.
+//
+//  Arguments:
+//      tile    : the tile buffer
+//      film    : the film
+//      size    : the tile size
+//      id      : the number of the tile
+//
+//------------------------------------------------------------------------------
+
+
+void startTile
+
+  ( Tile*         tile  ,
+    Film*         film  ,
+    int           size  ,
+    int           id    );
+
+
+//------------------------------------------------------------------------------
+//  addTileSample: Adds a weighted sample to a pixel of a tile
+//
+//  Arguments:
+//      tile    : the tile
+//      i       : column index of the pixel in the film
+//      j       : row index of the pixel in the film
+//      color   : color of the sample
+//      weight  : weight of the sample
+//
+//------------------------------------------------------------------------------
+
+
+void addTileSample
+
+  ( Tile*         tile   ,
+    int           i      ,
+    int           j      ,
+    Color*        color  ,
+    double        weight );
+
+
+//------------------------------------------------------------------------------
+//  flushTile: Adds the samples of a tile to the film
+//
+//  Arguments:
+//      film    : the film
+//      tile    : the tile
+//
+//------------------------------------------------------------------------------
+
+
+void flushTile
+
+  ( Film*         film  ,
+    Tile*         tile  );
+
+
 //------------------------------------------------------------------------------
 //  createBitmapFileHeader: Creates the bitmap file header
 //
@@ -164,4 +471,146 @@ void saveToBitmap
   ( Film*         film          , 
     char*         imageFileName );
 
+
+
+//------------------------------------------------------------------------------
+//  openFilmWriter: Opens the output files of a film and writes their headers.
+//                 The 8 bit images have exposure 1 and gamma 2, unless these
+//                 fields of the writer are changed.
+//
+//  Arguments:
+//      film       : the film
+//      imageName  : name of the 8 bit image, a PNG file if the name ends with
+//                   .png and a bitmap otherwise (NULL = not written)
+//      pfmName    : name of the linear PFM file (NULL = not written)
+//      exrName    : name of the linear EXR file (NULL = not written)
+//      countName  : name of the sample count bitmap (NULL = not written)
+//      maxSamples : number of samples that is shown as white in the counts
+//
+//  Return:
+//      FilmWriter* : the writer
+//
+//------------------------------------------------------------------------------
+
+
+FilmWriter* openFilmWriter
+
+  ( Film*         film       ,
+    char*         imageName  ,
+    char*         pfmName    ,
+    char*         exrName    ,
+    char*         countName  ,
+    int           maxSamples );
+
+
+//------------------------------------------------------------------------------
+//  writeFilmRows: Writes the rows that are stored in the film to the output
+//                 files. The bands must be written from the first row up.
+//
+//  Arguments:
+//      writer  : the writer
+//      film    : the film
+//
+//------------------------------------------------------------------------------
+
+
+void writeFilmRows
+
+  ( FilmWriter*   writer ,
+    Film*         film   );
+
+
+//------------------------------------------------------------------------------
+//  closeFilmWriter: Closes the output files and frees the writer
+//
+//  Arguments:
+//      writer  : the writer
+//
+//------------------------------------------------------------------------------
+
+
+void closeFilmWriter
+
+  ( FilmWriter*   writer );
+
+
+//------------------------------------------------------------------------------
+//  writeEXRHeader: Writes the header and the offset table of an uncompressed
+//                  scanline EXR file with float channels. The scanlines 
+//                  must follow from the bottom to the top of the image, each
+//                  as a chunk of the row number, the data size and the 
+//                  values of the row, channel after channel.
+//
+//  Arguments:
+//      file     : the file
+//      height   : height of the image
+//      width    : width of the image
+//      channels : names of the channels, in alphabetical order
+//      count    : number of channels
+//
+//------------------------------------------------------------------------------
+
+
+void writeEXRHeader
+
+  ( FILE*         file     ,
+    int           height   ,
+    int           width    ,
+    const char**  channels ,
+    int           count    );
+
+
+//------------------------------------------------------------------------------
+//  saveToPFM: Saves the linear (not gamma corrected) pixel values of the film
+//             as a Portable Float Map. The film must hold the whole image.
+//
+//  Arguments:
+//      film          : Film that is saved
+//      imageFileName : Name of the PFM file
+//
+//------------------------------------------------------------------------------
+
+
+void saveToPFM
+
+  ( Film*         film          , 
+    char*         imageFileName );
+
+
+//------------------------------------------------------------------------------
+//  saveToEXR: Saves the linear pixel values of the film as an uncompressed
+//             scanline OpenEXR file with 32 bit float R, G and B channels. 
+//             The film must hold the whole image.
+//
+//  Arguments:
+//      film          : Film that is saved
+//      imageFileName : Name of the EXR file
+//
+//------------------------------------------------------------------------------
+
+
+void saveToEXR
+
+  ( Film*         film          , 
+    char*         imageFileName );
+
+
+//------------------------------------------------------------------------------
+//  saveSampleCountBitmap: Saves the number of samples of each pixel as a
+//                         grey scale bitmap (white = maxSamples)
+//
+//  Arguments:
+//      film          : Film that contains the sample counts
+//      imageFileName : Name of the bitmap file
+//      maxSamples    : Number of samples that is shown as white
+//
+//------------------------------------------------------------------------------
+
+
+void saveSampleCountBitmap
+
+  ( Film*         film          , 
+    char*         imageFileName ,
+    int           maxSamples    );
+
 #endif
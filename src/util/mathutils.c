@@ -45,4 +45,39 @@ bool quadratic
 }
 
 
+//------------------------------------------------------------------------------
+//  expandBits: spreads the lower 10 bits of v such that there are two zero
+//  bits between each of them
+//------------------------------------------------------------------------------
+
+static unsigned int expandBits
+
+  ( unsigned int v )
+
+{
+  v = ( v * 0x00010001u ) & 0xFF0000FFu;
+  v = ( v * 0x00000101u ) & 0x0F00F00Fu;
+  v = ( v * 0x00000011u ) & 0xC30C30C3u;
+  v = ( v * 0x00000005u ) & 0x49249249u;
+
+  return v;
+}
+
 
+//------------------------------------------------------------------------------
+//  mortonCode: Computes the 30 bit Morton code of a point in the unit cube
+//------------------------------------------------------------------------------
+
+unsigned int mortonCode
+
+  ( double     x    ,
+    double     y    , 
+    double     z    )
+
+{
+  unsigned int ix = (unsigned int)fmin( fmax( x * 1024.0 , 0.0 ) , 1023.0 );
+  unsigned int iy = (unsigned int)fmin( fmax( y * 1024.0 , 0.0 ) , 1023.0 );
+  unsigned int iz = (unsigned int)fmin( fmax( z * 1024.0 , 0.0 ) , 1023.0 );
+
+  return ( expandBits( ix ) << 2 ) | ( expandBits( iy ) << 1 ) | expandBits( iz );
+}
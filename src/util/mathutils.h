@@ -42,6 +42,27 @@ bool quadratic
     double          c  , 
     double*         t0 ,
     double*         t1 );
+
+
+//------------------------------------------------------------------------------
+//  mortonCode: Computes the 30 bit Morton code (Z-order curve) of a point in
+//  the unit cube
+//
+//  Arguments
+//     x       : x-coordinate, between 0 and 1
+//     y       : y-coordinate, between 0 and 1
+//     z       : z-coordinate, between 0 and 1
+//
+//  Returns
+//     unsigned int : the Morton code, 10 bits per coordinate.
+//------------------------------------------------------------------------------
+
+
+unsigned int mortonCode
+
+  ( double          x  ,
+    double          y  ,
+    double          z  );
     
 
 #endif
@@ -0,0 +1,237 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "preview.h"
+
+
+//------------------------------------------------------------------------------
+//  createPreview: Creates the preview of a film
+//------------------------------------------------------------------------------
+
+
+Preview* createPreview
+
+  ( const char*   fileName ,
+    double        interval ,
+    Film*         film     ,
+    int           tileSize ,
+    double        exposure ,
+    double        gamma    )
+
+{
+  Preview *preview = (Preview*)malloc( sizeof(Preview) );
+
+  snprintf( preview->fileName , sizeof(preview->fileName) , "%s" , fileName );
+
+  preview->interval  = interval;
+  preview->lastWrite = omp_get_wtime();
+  preview->exposure  = exposure;
+  preview->gamma     = gamma;
+  preview->blocksX   = ( film->width  + PREVIEW_SCALE - 1 ) / PREVIEW_SCALE;
+  preview->blocksY   = ( film->height + PREVIEW_SCALE - 1 ) / PREVIEW_SCALE;
+  preview->blocks    = (Color*)calloc( preview->blocksX*preview->blocksY , sizeof(Color) );
+  preview->film      = createFilm( film->height , film->width );
+  preview->tileSize  = tileSize;
+  preview->tilesX    = ( film->width + tileSize - 1 ) / tileSize;
+  preview->tileCount = getTileCount( film , tileSize );
+  preview->locks     = (omp_lock_t*)malloc( preview->tileCount*sizeof(omp_lock_t) );
+
+  for ( int t = 0 ; t < preview->tileCount ; t++ )
+  {
+    omp_init_lock( &preview->locks[t] );
+  }
+
+  return preview;
+}
+
+
+//------------------------------------------------------------------------------
+//  freePreview: Frees the preview
+//------------------------------------------------------------------------------
+
+
+void freePreview
+
+  ( Preview*      preview )
+
+{
+  if ( preview == NULL )
+  {
+    return;
+  }
+
+  for ( int t = 0 ; t < preview->tileCount ; t++ )
+  {
+    omp_destroy_lock( &preview->locks[t] );
+  }
+
+  free( preview->locks );
+  free( preview->blocks );
+  free( preview->film );
+  free( preview );
+}
+
+
+//------------------------------------------------------------------------------
+//  getPreviewBlockPixel: Returns the pixel that is traced for a block
+//------------------------------------------------------------------------------
+
+
+void getPreviewBlockPixel
+
+  ( Preview*      preview ,
+    int           block   ,
+    int*          i       ,
+    int*          j       )
+
+{
+  *i = ( block % preview->blocksX ) * PREVIEW_SCALE + PREVIEW_SCALE/2;
+  *j = ( block / preview->blocksX ) * PREVIEW_SCALE + PREVIEW_SCALE/2;
+
+  if ( *i >= preview->film->width )
+  {
+    *i = preview->film->width - 1;
+  }
+
+  if ( *j >= preview->film->height )
+  {
+    *j = preview->film->height - 1;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  flushPreviewTile: Adds the samples of a tile to the film
+//------------------------------------------------------------------------------
+
+
+void flushPreviewTile
+
+  ( Preview*      preview ,
+    Film*         film    ,
+    Tile*         tile    ,
+    AOVFilm*      aov     ,
+    AOVFilm*      aovTile ,
+    int           id      )
+
+{
+  if ( preview != NULL )
+  {
+    omp_set_lock( &preview->locks[id] );
+  }
+
+  flushTile( film , tile );
+
+  if ( aov != NULL )
+  {
+    flushAOVTile( aov , aovTile );
+  }
+
+  if ( preview != NULL )
+  {
+    omp_unset_lock( &preview->locks[id] );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  takePreviewSnapshot: Copies the film when a preview is due
+//------------------------------------------------------------------------------
+
+
+int takePreviewSnapshot
+
+  ( Preview*      preview ,
+    Film*         film    )
+
+{
+  if ( omp_get_wtime() - preview->lastWrite < preview->interval )
+  {
+    return 0;
+  }
+
+  int size = preview->tileSize;
+
+  for ( int t = 0 ; t < preview->tileCount ; t++ )
+  {
+    int x0 = ( t % preview->tilesX ) * size;
+    int y0 = ( t / preview->tilesX ) * size;
+    int nx = ( x0 + size < film->width  ) ? size : film->width  - x0;
+    int ny = ( y0 + size < film->height ) ? size : film->height - y0;
+
+    omp_set_lock( &preview->locks[t] );
+
+    for ( int j = y0 ; j < y0 + ny ; j++ )
+    {
+      memcpy( &preview->film->p[(long)j*film->width+x0] , &film->p[(long)j*film->width+x0] , nx*sizeof(Pixel) );
+    }
+
+    omp_unset_lock( &preview->locks[t] );
+  }
+
+  preview->lastWrite = omp_get_wtime();
+
+  return 1;
+}
+
+
+//------------------------------------------------------------------------------
+//  writePreview: Writes the snapshot to the preview file
+//------------------------------------------------------------------------------
+
+
+void writePreview
+
+  ( Preview*      preview )
+
+{
+  Film *film = preview->film;
+
+  // Pixels without samples get the color of their block
+
+  for ( int j = 0 ; j < film->height ; j++ )
+  {
+    for ( int i = 0 ; i < film->width ; i++ )
+    {
+      Pixel *p = &film->p[(long)j*film->width+i];
+
+      if ( p->wght <= 0.0 )
+      {
+        p->c    = preview->blocks[( j / PREVIEW_SCALE )*preview->blocksX + i / PREVIEW_SCALE];
+        p->wght = 1.0;
+      }
+    }
+  }
+
+  char tmpName[56];
+
+  snprintf( tmpName , sizeof(tmpName) , "%s.tmp" , preview->fileName );
+
+  FilmWriter *writer = openFilmWriter( film , tmpName , NULL , NULL , NULL , 1 );
+
+  writer->exposure = preview->exposure;
+  writer->gamma    = preview->gamma;
+
+  writeFilmRows( writer , film );
+  closeFilmWriter( writer );
+
+#ifdef _WIN32
+  remove( preview->fileName );
+#endif
+
+  if ( rename( tmpName , preview->fileName ) != 0 )
+  {
+    printf("ERROR: Preview file '%s' cannot be written\n",preview->fileName);
+  }
+}
@@ -0,0 +1,189 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef UTIL_PREVIEW_H
+#define UTIL_PREVIEW_H
+
+#include <omp.h>
+#include "film.h"
+#include "aov.h"
+#include "color.h"
+
+#define PREVIEW_SCALE 8    // pixels per block of the low resolution pass
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the Preview type (a bitmap of the current film that is
+//  overwritten while rendering). Pixels without samples show the color of
+//  their block in a low resolution pass with one sample per block.
+//      fileName   : name of the preview file
+//      interval   : time between two previews (seconds)
+//      lastWrite  : time of the last snapshot
+//      exposure   : factor of the pixel values
+//      gamma      : gamma of the bitmap
+//      blocksX    : number of blocks in a row
+//      blocksY    : number of blocks in a column
+//      blocks     : colors of the low resolution pass
+//      film       : snapshot of the film
+//      tileSize   : size of the tiles of the film
+//      tilesX     : number of tiles in a row
+//      tileCount  : number of tiles of the film
+//      locks      : a lock for each tile, held while the tile is added to the
+//                   film or copied to the snapshot
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  char            fileName[48];
+  double          interval;
+  double          lastWrite;
+  double          exposure;
+  double          gamma;
+  int             blocksX;
+  int             blocksY;
+  Color*          blocks;
+  Film*           film;
+  int             tileSize;
+  int             tilesX;
+  int             tileCount;
+  omp_lock_t*     locks;
+} Preview;
+
+
+//------------------------------------------------------------------------------
+//  createPreview: Creates the preview of a film
+//
+//  Arguments:
+//      fileName : name of the preview file
+//      interval : time between two previews (seconds)
+//      film     : the film, which must hold the whole image
+//      tileSize : size of the tiles of the film
+//      exposure : factor of the pixel values
+//      gamma    : gamma of the bitmap
+//
+//  Return:
+//      Preview* : the preview
+//
+//------------------------------------------------------------------------------
+
+
+Preview* createPreview
+
+  ( const char*   fileName ,
+    double        interval ,
+    Film*         film     ,
+    int           tileSize ,
+    double        exposure ,
+    double        gamma    );
+
+
+//------------------------------------------------------------------------------
+//  freePreview: Frees the preview (the file is kept)
+//
+//  Arguments:
+//      preview  : the preview
+//
+//------------------------------------------------------------------------------
+
+
+void freePreview
+
+  ( Preview*      preview );
+
+
+//------------------------------------------------------------------------------
+//  getPreviewBlockPixel: Returns the pixel that is traced for a block in the
+//                        low resolution pass
+//
+//  Arguments:
+//      preview  : the preview
+//      block    : the number of the block, row by row
+//      i        : column of the pixel
+//      j        : row of the pixel
+//
+//------------------------------------------------------------------------------
+
+
+void getPreviewBlockPixel
+
+  ( Preview*      preview ,
+    int           block   ,
+    int*          i       ,
+    int*          j       );
+
+
+//------------------------------------------------------------------------------
+//  flushPreviewTile: Adds the samples of a tile to the film (see flushTile),
+//                    and its output variables to the planes of the film (see
+//                    flushAOVTile). The tile is locked against a snapshot of
+//                    the preview meanwhile.
+//
+//  Arguments:
+//      preview  : the preview (NULL = no preview)
+//      film     : the film
+//      tile     : the tile
+//      aov      : the planes of the output variables (NULL = none)
+//      aovTile  : the output variables of the tile
+//      id       : the number of the tile
+//
+//------------------------------------------------------------------------------
+
+
+void flushPreviewTile
+
+  ( Preview*      preview ,
+    Film*         film    ,
+    Tile*         tile    ,
+    AOVFilm*      aov     ,
+    AOVFilm*      aovTile ,
+    int           id      );
+
+
+//------------------------------------------------------------------------------
+//  takePreviewSnapshot: Copies the film when the interval has passed. The
+//                       film is copied tile by tile, so that the other
+//                       threads can add their tiles with flushPreviewTile in
+//                       the meantime. Only one thread may take snapshots.
+//
+//  Arguments:
+//      preview  : the preview
+//      film     : the film
+//
+//  Return:
+//      int      : 1 if the snapshot is taken, the caller then writes it with
+//                 writePreview
+//
+//------------------------------------------------------------------------------
+
+
+int takePreviewSnapshot
+
+  ( Preview*      preview ,
+    Film*         film    );
+
+
+//------------------------------------------------------------------------------
+//  writePreview: Writes the snapshot to the preview file. The file is written
+//                under a temporary name first, so that a viewer never reads
+//                a partial file.
+//
+//  Arguments:
+//      preview  : the preview
+//
+//------------------------------------------------------------------------------
+
+
+void writePreview
+
+  ( Preview*      preview );
+
+#endif
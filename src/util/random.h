@@ -0,0 +1,77 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef UTIL_RANDOM_H
+#define UTIL_RANDOM_H
+
+
+//------------------------------------------------------------------------------
+//  The random numbers are counter based: a random number is a hash of the 
+//  pixel index, the sample index and the dimension (the how-many-th random 
+//  number of the sample). There is no state that is shared between threads, 
+//  so that the rendered image does not depend on the number of threads or 
+//  the schedule.
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+//  pcgHash: PCG output permutation used as a 32 bit integer hash. Defined in 
+//           the header so that it can be inlined and vectorised.
+//
+//  Arguments:
+//      v       : value that is hashed
+//
+//  Return:
+//      unsigned int : the hashed value
+//------------------------------------------------------------------------------
+
+
+static inline unsigned int pcgHash
+
+  ( unsigned int   v )
+
+{
+  unsigned int state = v * 747796405u + 2891336453u;
+  unsigned int word  = ( ( state >> ( ( state >> 28u ) + 4u ) ) ^ state ) * 277803737u;
+
+  return ( word >> 22u ) ^ word;
+}
+
+
+//------------------------------------------------------------------------------
+//  hashRandom: Returns the random number of a given pixel, sample and 
+//              dimension, uniformly distributed in [0,1)
+//
+//  Arguments:
+//      pixel   : index of the pixel
+//      sample  : index of the sample
+//      dim     : dimension
+//
+//  Return:
+//      double  : random number in [0,1)
+//------------------------------------------------------------------------------
+
+
+static inline double hashRandom
+
+  ( unsigned int   pixel  ,
+    unsigned int   sample ,
+    unsigned int   dim    )
+
+{
+  unsigned int h = pcgHash( pixel ^ pcgHash( sample ^ pcgHash( dim ) ) );
+
+  return h * ( 1.0 / 4294967296.0 );
+}
+
+#endif
+
+
@@ -36,13 +36,19 @@ typedef struct
 //  Ray:   structure to store the propoperties of a ray
 //      o      : origin (Vec3)
 //      d      : direction (Vec3)
+//      mask   : type of the ray (RAY_CAMERA or RAY_SHADOW). Faces with a 
+//               visibility mask are only hit by rays of a matching type.
 //------------------------------------------------------------------------------
 
+#define RAY_CAMERA 1
+#define RAY_SHADOW 2
+
 
 typedef struct 
 {
   Vec3        o;
   Vec3        d;
+  int         mask;
 } Ray;
 
 
@@ -0,0 +1,602 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "region.h"
+
+
+#define PIXEL_BYTES     32    // red, green and blue as doubles, wght and lum2 as floats
+#define RECORDS_OFFSET  24
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the header of a partial film file. The file stores every
+//  value in little-endian order, so that the processes of a render may run on
+//  different machines:
+//      0  magic[8]      16  int32 height     32  double exposure
+//      8  int32 version 20  int32 width      40  double gamma
+//      12 int32 size    24  int64 records
+//  The exposure and gamma of the render are stored, so that the merged 8 bit
+//  image is the one that a single process would write.
+//  The header is followed by the tiles: x0, y0, width and height as int32,
+//  and the pixels row by row in PIXEL_BYTES.
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  char     magic[8];
+  int32_t  version;
+  int32_t  size;
+  int32_t  height;
+  int32_t  width;
+  int64_t  records;
+  double   exposure;
+  double   gamma;
+} PartialHeader;
+
+
+//------------------------------------------------------------------------------
+//  putValue: Stores the lowest bytes of a value in little-endian order
+//------------------------------------------------------------------------------
+
+
+static void putValue
+
+  ( unsigned char*  buf   ,
+    uint64_t        value ,
+    int             bytes )
+
+{
+  for ( int b = 0 ; b < bytes ; b++ )
+  {
+    buf[b] = (unsigned char)( value >> ( 8 * b ) );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  getValue: Reads a value that is stored in little-endian order
+//------------------------------------------------------------------------------
+
+
+static uint64_t getValue
+
+  ( const unsigned char*  buf   ,
+    int                   bytes )
+
+{
+  uint64_t value = 0;
+
+  for ( int b = 0 ; b < bytes ; b++ )
+  {
+    value |= (uint64_t)buf[b] << ( 8 * b );
+  }
+
+  return value;
+}
+
+
+//------------------------------------------------------------------------------
+//  putPixels: Stores a row of pixels in the format of the file
+//------------------------------------------------------------------------------
+
+
+static void putPixels
+
+  ( unsigned char*  buf   ,
+    const Pixel*    p     ,
+    int             count )
+
+{
+  for ( int i = 0 ; i < count ; i++ )
+  {
+    unsigned char *out = buf + i * PIXEL_BYTES;
+
+    uint64_t c[3];
+    uint32_t w[2];
+
+    memcpy( &c[0] , &p[i].c.red   , 8 );
+    memcpy( &c[1] , &p[i].c.green , 8 );
+    memcpy( &c[2] , &p[i].c.blue  , 8 );
+    memcpy( &w[0] , &p[i].wght    , 4 );
+    memcpy( &w[1] , &p[i].lum2    , 4 );
+
+    putValue( out      , c[0] , 8 );
+    putValue( out + 8  , c[1] , 8 );
+    putValue( out + 16 , c[2] , 8 );
+    putValue( out + 24 , w[0] , 4 );
+    putValue( out + 28 , w[1] , 4 );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  getPixel: Reads pixel i of a row in the format of the file
+//------------------------------------------------------------------------------
+
+
+static Pixel getPixel
+
+  ( const unsigned char*  buf ,
+    int                   i   )
+
+{
+  const unsigned char *in = buf + i * PIXEL_BYTES;
+
+  uint64_t c[3] = { getValue( in , 8 ) , getValue( in + 8 , 8 ) , getValue( in + 16 , 8 ) };
+  uint32_t w[2] = { (uint32_t)getValue( in + 24 , 4 ) , (uint32_t)getValue( in + 28 , 4 ) };
+
+  Pixel p;
+
+  memcpy( &p.c.red   , &c[0] , 8 );
+  memcpy( &p.c.green , &c[1] , 8 );
+  memcpy( &p.c.blue  , &c[2] , 8 );
+  memcpy( &p.wght    , &w[0] , 4 );
+  memcpy( &p.lum2    , &w[1] , 4 );
+
+  return p;
+}
+
+
+//------------------------------------------------------------------------------
+//  readHeader: Reads the header of a partial film file. Returns 0 on success,
+//              -1 if the file is not a partial film and -2 if it has another
+//              version or header size.
+//------------------------------------------------------------------------------
+
+
+static int readHeader
+
+  ( FILE*           fp     ,
+    PartialHeader*  header )
+
+{
+  unsigned char buf[PARTIAL_HEADER_SIZE];
+
+  if ( fread( buf , 1 , 16 , fp ) != 16 || memcmp( buf , PARTIAL_MAGIC , 8 ) != 0 )
+  {
+    return -1;
+  }
+
+  memcpy( header->magic , buf , 8 );
+
+  header->version = (int32_t)getValue( buf + 8  , 4 );
+  header->size    = (int32_t)getValue( buf + 12 , 4 );
+
+  if ( header->version != PARTIAL_VERSION || header->size != PARTIAL_HEADER_SIZE )
+  {
+    return -2;
+  }
+
+  if ( fread( buf + 16 , 1 , PARTIAL_HEADER_SIZE - 16 , fp ) != PARTIAL_HEADER_SIZE - 16 )
+  {
+    return -1;
+  }
+
+  header->height  = (int32_t)getValue( buf + 16 , 4 );
+  header->width   = (int32_t)getValue( buf + 20 , 4 );
+  header->records = (int64_t)getValue( buf + RECORDS_OFFSET , 8 );
+
+  uint64_t bits[2] = { getValue( buf + 32 , 8 ) , getValue( buf + 40 , 8 ) };
+
+  memcpy( &header->exposure , &bits[0] , 8 );
+  memcpy( &header->gamma    , &bits[1] , 8 );
+
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+//  getTileRect: Returns the part of a tile of the band that lies in the crop
+//               window, the width or height is 0 if there is no overlap
+//------------------------------------------------------------------------------
+
+
+static void getTileRect
+
+  ( Region*   region ,
+    Film*     film   ,
+    int       id     ,
+    int       rect[4] )
+
+{
+  int size   = region->tileSize;
+  int tilesX = ( film->width + size - 1 ) / size;
+  int yEnd   = film->y0 + film->rows;
+
+  int x0 = ( id % tilesX ) * size;
+  int y0 = film->y0 + ( id / tilesX ) * size;
+  int x1 = ( x0 + size < film->width ) ? x0 + size : film->width;
+  int y1 = ( y0 + size < yEnd        ) ? y0 + size : yEnd;
+
+  rect[0] = ( x0 > region->x0 ) ? x0 : region->x0;
+  rect[1] = ( y0 > region->y0 ) ? y0 : region->y0;
+  rect[2] = ( ( x1 < region->x1 ) ? x1 : region->x1 ) - rect[0];
+  rect[3] = ( ( y1 < region->y1 ) ? y1 : region->y1 ) - rect[1];
+
+  if ( rect[2] < 0 || rect[3] < 0 )
+  {
+    rect[2] = 0;
+    rect[3] = 0;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  createRegion: Creates a region and opens its partial film file
+//------------------------------------------------------------------------------
+
+
+Region* createRegion
+
+  ( Film*         film      ,
+    int           tileSize  ,
+    const int*    crop      ,
+    int           firstTile ,
+    int           lastTile  ,
+    const char*   claimDir  ,
+    const char*   fileName  ,
+    double        exposure  ,
+    double        gamma     )
+
+{
+  FILE *fp = fopen( fileName , "wb" );
+
+  if ( fp == NULL )
+  {
+    printf("ERROR: Partial film file '%s' cannot be opened\n",fileName);
+    return NULL;
+  }
+
+  Region *region = (Region*)malloc( sizeof(Region) );
+
+  region->x0 = 0;
+  region->y0 = 0;
+  region->x1 = film->width;
+  region->y1 = film->height;
+
+  if ( crop != NULL && crop[2] > crop[0] && crop[3] > crop[1] )
+  {
+    region->x0 = ( crop[0] > 0           ) ? crop[0] : 0;
+    region->y0 = ( crop[1] > 0           ) ? crop[1] : 0;
+    region->x1 = ( crop[2] < film->width  ) ? crop[2] : film->width;
+    region->y1 = ( crop[3] < film->height ) ? crop[3] : film->height;
+  }
+
+  region->firstTile = firstTile;
+  region->lastTile  = lastTile;
+
+  snprintf( region->claimDir , sizeof(region->claimDir) , "%s" , claimDir ? claimDir : "" );
+
+  region->tileSize   = tileSize;
+  region->tileOffset = 0;
+  region->tileCount  = 0;
+  region->owned      = NULL;
+  region->fp         = fp;
+  region->records    = 0;
+
+  unsigned char header[PARTIAL_HEADER_SIZE];
+
+  memcpy( header , PARTIAL_MAGIC , 8 );
+
+  putValue( header + 8  , PARTIAL_VERSION     , 4 );
+  putValue( header + 12 , PARTIAL_HEADER_SIZE , 4 );
+  putValue( header + 16 , film->height        , 4 );
+  putValue( header + 20 , film->width         , 4 );
+  putValue( header + RECORDS_OFFSET , 0       , 8 );
+
+  uint64_t bits[2];
+
+  memcpy( &bits[0] , &exposure , 8 );
+  memcpy( &bits[1] , &gamma    , 8 );
+
+  putValue( header + 32 , bits[0] , 8 );
+  putValue( header + 40 , bits[1] , 8 );
+
+  fwrite( header , 1 , PARTIAL_HEADER_SIZE , fp );
+
+  return region;
+}
+
+
+//------------------------------------------------------------------------------
+//  startRegionBand: Starts a band of the film
+//------------------------------------------------------------------------------
+
+
+void startRegionBand
+
+  ( Region*       region ,
+    Film*         film   )
+
+{
+  region->tileOffset += region->tileCount;
+  region->tileCount   = getTileCount( film , region->tileSize );
+
+  free( region->owned );
+
+  region->owned = (unsigned char*)calloc( region->tileCount , 1 );
+}
+
+
+//------------------------------------------------------------------------------
+//  claimRegionTile: Decides if this process renders a tile of the band
+//------------------------------------------------------------------------------
+
+
+int claimRegionTile
+
+  ( Region*       region ,
+    Film*         film   ,
+    int           id     )
+
+{
+  if ( region->owned[id] != TILE_UNKNOWN )
+  {
+    return region->owned[id] == TILE_OWNED;
+  }
+
+  int globalID = region->tileOffset + id;
+  int rect[4];
+
+  getTileRect( region , film , id , rect );
+
+  region->owned[id] = TILE_SKIPPED;
+
+  if ( rect[2] == 0 || rect[3] == 0 || globalID < region->firstTile ||
+       ( region->lastTile >= 0 && globalID > region->lastTile ) )
+  {
+    return 0;
+  }
+
+  // The first process that creates the lock file of a tile renders it
+
+  if ( region->claimDir[0] != '\0' )
+  {
+    char lockName[96];
+
+    snprintf( lockName , sizeof(lockName) , "%s/tile_%d.lock" , region->claimDir , globalID );
+
+    int fd = open( lockName , O_CREAT | O_EXCL | O_WRONLY , 0644 );
+
+    if ( fd < 0 )
+    {
+      return 0;
+    }
+
+    close( fd );
+  }
+
+  region->owned[id] = TILE_OWNED;
+
+  return 1;
+}
+
+
+//------------------------------------------------------------------------------
+//  insideRegion: Returns 1 if a pixel lies in the crop window
+//------------------------------------------------------------------------------
+
+
+int insideRegion
+
+  ( Region*       region ,
+    int           i      ,
+    int           j      )
+
+{
+  return i >= region->x0 && i < region->x1 && j >= region->y0 && j < region->y1;
+}
+
+
+//------------------------------------------------------------------------------
+//  writeRegionTiles: Appends the rendered tiles of the band to the file
+//------------------------------------------------------------------------------
+
+
+void writeRegionTiles
+
+  ( Region*       region ,
+    Film*         film   )
+
+{
+  unsigned char *buf = (unsigned char*)malloc( (size_t)film->width * PIXEL_BYTES );
+
+  for ( int id = 0 ; id < region->tileCount ; id++ )
+  {
+    if ( region->owned[id] != TILE_OWNED )
+    {
+      continue;
+    }
+
+    int rect[4];
+
+    getTileRect( region , film , id , rect );
+
+    for ( int k = 0 ; k < 4 ; k++ )
+    {
+      putValue( buf + 4 * k , (uint32_t)rect[k] , 4 );
+    }
+
+    fwrite( buf , 1 , 16 , region->fp );
+
+    for ( int j = rect[1] ; j < rect[1] + rect[3] ; j++ )
+    {
+      putPixels( buf , &film->p[(j-film->y0)*film->width+rect[0]] , rect[2] );
+      fwrite( buf , (size_t)rect[2] * PIXEL_BYTES , 1 , region->fp );
+    }
+
+    region->records++;
+  }
+
+  free( buf );
+}
+
+
+//------------------------------------------------------------------------------
+//  closeRegion: Closes the partial film file and frees the region
+//------------------------------------------------------------------------------
+
+
+long closeRegion
+
+  ( Region*       region )
+
+{
+  long records = region->records;
+
+  // The number of tiles is stored in the header once all tiles are written
+
+  unsigned char buf[8];
+
+  putValue( buf , (uint64_t)records , 8 );
+
+  fseek( region->fp , RECORDS_OFFSET , SEEK_SET );
+  fwrite( buf , 1 , 8 , region->fp );
+  fclose( region->fp );
+
+  free( region->owned );
+  free( region );
+
+  return records;
+}
+
+
+//------------------------------------------------------------------------------
+//  readPartialFilmHeader: Reads the image size and the tone mapping of a
+//                         partial film file
+//------------------------------------------------------------------------------
+
+
+int readPartialFilmHeader
+
+  ( const char*   fileName ,
+    int*          height   ,
+    int*          width    ,
+    double*       exposure ,
+    double*       gamma    )
+
+{
+  FILE *fp = fopen( fileName , "rb" );
+
+  if ( fp == NULL )
+  {
+    return -1;
+  }
+
+  PartialHeader header;
+
+  int status = readHeader( fp , &header );
+
+  fclose( fp );
+
+  if ( status != 0 )
+  {
+    return status;
+  }
+
+  *height   = header.height;
+  *width    = header.width;
+  *exposure = header.exposure;
+  *gamma    = header.gamma;
+
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+//  addPartialFilm: Adds the tiles of a partial film file to a film
+//------------------------------------------------------------------------------
+
+
+long addPartialFilm
+
+  ( Film*         film     ,
+    const char*   fileName )
+
+{
+  FILE *fp = fopen( fileName , "rb" );
+
+  if ( fp == NULL )
+  {
+    return -1;
+  }
+
+  PartialHeader header;
+
+  if ( readHeader( fp , &header ) != 0 ||
+       header.height != film->height || header.width != film->width ||
+       film->rows != film->height )
+  {
+    fclose( fp );
+    return -1;
+  }
+
+  unsigned char *row = (unsigned char*)malloc( (size_t)film->width * PIXEL_BYTES );
+
+  long record;
+
+  for ( record = 0 ; record < header.records ; record++ )
+  {
+    int rect[4];
+
+    if ( fread( row , 1 , 16 , fp ) != 16 )
+    {
+      break;
+    }
+
+    for ( int k = 0 ; k < 4 ; k++ )
+    {
+      rect[k] = (int32_t)getValue( row + 4 * k , 4 );
+    }
+
+    if ( rect[0] < 0 || rect[1] < 0 || rect[2] < 0 || rect[3] < 0 ||
+         rect[0] + rect[2] > film->width || rect[1] + rect[3] > film->height )
+    {
+      break;
+    }
+
+    int complete = 1;
+
+    for ( int j = rect[1] ; j < rect[1] + rect[3] && complete ; j++ )
+    {
+      complete = fread( row , (size_t)rect[2] * PIXEL_BYTES , 1 , fp ) == 1 || rect[2] == 0;
+
+      for ( int i = 0 ; i < rect[2] && complete ; i++ )
+      {
+        Pixel *p = &film->p[j*film->width+rect[0]+i];
+        Pixel  q = getPixel( row , i );
+
+        p->c.red   += q.c.red;
+        p->c.green += q.c.green;
+        p->c.blue  += q.c.blue;
+        p->wght    += q.wght;
+        p->lum2    += q.lum2;
+      }
+    }
+
+    if ( !complete )
+    {
+      break;
+    }
+  }
+
+  free( row );
+  fclose( fp );
+
+  return ( record == header.records ) ? record : -1;
+}
@@ -0,0 +1,234 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef UTIL_REGION_H
+#define UTIL_REGION_H
+
+#include <stdio.h>
+#include "film.h"
+
+#define PARTIAL_MAGIC       "RTPARTFM"
+#define PARTIAL_VERSION     3
+#define PARTIAL_HEADER_SIZE 48
+
+#define TILE_UNKNOWN  0
+#define TILE_OWNED    1
+#define TILE_SKIPPED  2
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the Region type (the part of the image that is rendered by
+//  this process). The tiles are numbered row by row over the whole image,
+//  also when the film is rendered in bands.
+//      x0,y0,x1,y1 : crop window, x1 and y1 are not included
+//      firstTile   : first tile that is rendered
+//      lastTile    : last tile that is rendered (-1 = up to the last tile)
+//      claimDir    : directory in which the tiles are claimed with lock
+//                    files ("" = no claims)
+//      tileSize    : size of the tiles
+//      tileOffset  : ID of the first tile of the current band
+//      tileCount   : number of tiles of the current band
+//      owned       : state of each tile of the current band
+//      fp          : the partial film file
+//      records     : number of tiles in the partial film file
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  int             x0, y0, x1, y1;
+  int             firstTile;
+  int             lastTile;
+  char            claimDir[64];
+  int             tileSize;
+  int             tileOffset;
+  int             tileCount;
+  unsigned char*  owned;
+  FILE*           fp;
+  long            records;
+} Region;
+
+
+//------------------------------------------------------------------------------
+//  createRegion: Creates a region and opens its partial film file
+//
+//  Arguments:
+//      film      : the film
+//      tileSize  : size of the tiles
+//      crop      : crop window x0, y0, x1, y1 (NULL = whole image)
+//      firstTile : first tile that is rendered
+//      lastTile  : last tile that is rendered (-1 = up to the last tile)
+//      claimDir  : directory for the lock files (NULL or "" = no claims)
+//      fileName  : name of the partial film file
+//      exposure  : factor of the pixel values of the 8 bit image
+//      gamma     : gamma of the 8 bit image
+//
+//  Return:
+//      Region*   : the region, NULL if the file cannot be opened
+//
+//------------------------------------------------------------------------------
+
+
+Region* createRegion
+
+  ( Film*         film      ,
+    int           tileSize  ,
+    const int*    crop      ,
+    int           firstTile ,
+    int           lastTile  ,
+    const char*   claimDir  ,
+    const char*   fileName  ,
+    double        exposure  ,
+    double        gamma     );
+
+
+//------------------------------------------------------------------------------
+//  startRegionBand: Starts a band of the film, the tiles of the previous
+//                   bands must have been written
+//
+//  Arguments:
+//      region    : the region
+//      film      : the film, with the band started
+//
+//------------------------------------------------------------------------------
+
+
+void startRegionBand
+
+  ( Region*       region ,
+    Film*         film   );
+
+
+//------------------------------------------------------------------------------
+//  claimRegionTile: Decides if this process renders a tile of the band. A
+//                   tile is rendered when it overlaps the crop window, lies
+//                   in the tile range and, with a claim directory, when its
+//                   lock file could be created. The decision is kept for
+//                   the following passes.
+//
+//  Arguments:
+//      region    : the region
+//      film      : the film
+//      id        : ID of the tile in the band
+//
+//  Return:
+//      int       : 1 if the tile is rendered, 0 otherwise
+//
+//------------------------------------------------------------------------------
+
+
+int claimRegionTile
+
+  ( Region*       region ,
+    Film*         film   ,
+    int           id     );
+
+
+//------------------------------------------------------------------------------
+//  insideRegion: Returns 1 if a pixel lies in the crop window
+//
+//  Arguments:
+//      region    : the region
+//      i         : column of the pixel
+//      j         : row of the pixel
+//
+//------------------------------------------------------------------------------
+
+
+int insideRegion
+
+  ( Region*       region ,
+    int           i      ,
+    int           j      );
+
+
+//------------------------------------------------------------------------------
+//  writeRegionTiles: Appends the rendered tiles of the band, cut to the crop
+//                    window, to the partial film file
+//
+//  Arguments:
+//      region    : the region
+//      film      : the film
+//
+//------------------------------------------------------------------------------
+
+
+void writeRegionTiles
+
+  ( Region*       region ,
+    Film*         film   );
+
+
+//------------------------------------------------------------------------------
+//  closeRegion: Closes the partial film file and frees the region
+//
+//  Arguments:
+//      region    : the region
+//
+//  Return:
+//      long      : the number of tiles in the partial film file
+//
+//------------------------------------------------------------------------------
+
+
+long closeRegion
+
+  ( Region*       region );
+
+
+//------------------------------------------------------------------------------
+//  readPartialFilmHeader: Reads the image size and the tone mapping of a
+//                         partial film file
+//
+//  Arguments:
+//      fileName  : name of the partial film file
+//      height    : height of the image
+//      width     : width of the image
+//      exposure  : factor of the pixel values of the 8 bit image
+//      gamma     : gamma of the 8 bit image
+//
+//  Return:
+//      int       : 0 on success, -1 if the file is not a partial film, -2 if
+//                  it has another version or header size
+//
+//------------------------------------------------------------------------------
+
+
+int readPartialFilmHeader
+
+  ( const char*   fileName ,
+    int*          height   ,
+    int*          width    ,
+    double*       exposure ,
+    double*       gamma    );
+
+
+//------------------------------------------------------------------------------
+//  addPartialFilm: Adds the tiles of a partial film file to a film, the
+//                  colors and the weights of the pixels are summed
+//
+//  Arguments:
+//      film      : the film, which must hold the whole image
+//      fileName  : name of the partial film file
+//
+//  Return:
+//      long      : number of tiles that is added, -1 if the file does not
+//                  fit the film
+//
+//------------------------------------------------------------------------------
+
+
+long addPartialFilm
+
+  ( Film*         film     ,
+    const char*   fileName );
+
+#endif
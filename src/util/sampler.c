@@ -0,0 +1,332 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+#include <math.h>
+#include "sampler.h"
+#include "random.h"
+
+const char *SAMPLER_NAMES[] = { "random" , "stratified" , "sobol" , "halton" , "cmj" };
+
+const int PRIMES[] = { 2,  3,  5,  7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+                      59, 61, 67, 71, 73, 79, 83, 89, 97,101,103,107,109,113,127,131 };
+
+#define NUM_PRIMES 32
+
+#define TO_DOUBLE ( 1.0 / 4294967296.0 )
+
+
+//------------------------------------------------------------------------------
+//  reverseBits: Reverses the order of the bits of a 32 bit integer
+//------------------------------------------------------------------------------
+
+
+static unsigned int reverseBits
+
+  ( unsigned int x )
+
+{
+  x = ( ( x >> 1 ) & 0x55555555u ) | ( ( x & 0x55555555u ) << 1 );
+  x = ( ( x >> 2 ) & 0x33333333u ) | ( ( x & 0x33333333u ) << 2 );
+  x = ( ( x >> 4 ) & 0x0F0F0F0Fu ) | ( ( x & 0x0F0F0F0Fu ) << 4 );
+  x = ( ( x >> 8 ) & 0x00FF00FFu ) | ( ( x & 0x00FF00FFu ) << 8 );
+
+  return ( x >> 16 ) | ( x << 16 );
+}
+
+
+//------------------------------------------------------------------------------
+//  owenScramble: Nested uniform (Owen) scrambling of the bits of x, using the 
+//                hash-based permutation of Burley (2020)
+//------------------------------------------------------------------------------
+
+
+static unsigned int owenScramble
+
+  ( unsigned int x    ,
+    unsigned int seed )
+
+{
+  x  = reverseBits( x );
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+
+  return reverseBits( x );
+}
+
+
+//------------------------------------------------------------------------------
+//  sobol2D: The first two dimensions of the Sobol sequence
+//------------------------------------------------------------------------------
+
+
+static void sobol2D
+
+  ( unsigned int   index ,
+    unsigned int*  x     ,
+    unsigned int*  y     )
+
+{
+  unsigned int v = 1u << 31;
+
+  *x = reverseBits( index );
+  *y = 0;
+
+  for ( ; index != 0 ; index >>= 1 )
+  {
+    if ( index & 1u )
+    {
+      *y ^= v;
+    }
+
+    v ^= v >> 1;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+//  radicalInverse: Scrambled radical inverse of index in the given base. Each
+//                  digit is shifted by a random amount that depends on the 
+//                  seed and the position of the digit.
+//------------------------------------------------------------------------------
+
+
+static double radicalInverse
+
+  ( int          base  ,
+    unsigned int index ,
+    unsigned int seed  )
+
+{
+  double invBase = 1.0 / base;
+  double factor  = invBase;
+  double result  = 0.0;
+
+  for ( int k = 0 ; factor > 1.0e-10 ; k++ )
+  {
+    unsigned int digit = index % base;
+    unsigned int shift = pcgHash( seed ^ pcgHash( k ) ) % base;
+
+    result += ( ( digit + shift ) % base ) * factor;
+    index  /= base;
+    factor *= invBase;
+  }
+
+  return result;
+}
+
+
+//------------------------------------------------------------------------------
+//  permuteIndex: Random permutation of i in [0,l) (Kensler, 2013)
+//------------------------------------------------------------------------------
+
+
+static unsigned int permuteIndex
+
+  ( unsigned int i ,
+    unsigned int l ,
+    unsigned int p )
+
+{
+  unsigned int w = l - 1;
+
+  w |= w >> 1;
+  w |= w >> 2;
+  w |= w >> 4;
+  w |= w >> 8;
+  w |= w >> 16;
+
+  do
+  {
+    i ^= p;
+    i *= 0xe170893du;
+    i ^= p >> 16;
+    i ^= ( i & w ) >> 4;
+    i ^= p >> 8;
+    i *= 0x0929eb3fu;
+    i ^= p >> 23;
+    i ^= ( i & w ) >> 1;
+    i *= 1 | p >> 27;
+    i *= 0x6935fa69u;
+    i ^= ( i & w ) >> 11;
+    i *= 0x74dcb303u;
+    i ^= ( i & w ) >> 2;
+    i *= 0x9e501cc3u;
+    i ^= ( i & w ) >> 2;
+    i *= 0xc860a3dfu;
+    i &= w;
+    i ^= i >> 5;
+  } 
+  while ( i >= l );
+
+  return ( i + p ) % l;
+}
+
+
+//------------------------------------------------------------------------------
+//  getSamplerType: Returns the sampler type with the given name
+//------------------------------------------------------------------------------
+
+
+int getSamplerType
+
+  ( char*     name )
+
+{
+  for ( int i = 0 ; i < 5 ; i++ )
+  {
+    if ( strcmp( name , SAMPLER_NAMES[i] ) == 0 )
+    {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+
+//------------------------------------------------------------------------------
+//  getSamplerName: Returns the name of a sampler type
+//------------------------------------------------------------------------------
+
+
+const char* getSamplerName
+
+  ( int       type )
+
+{
+  return SAMPLER_NAMES[type];
+}
+
+
+//------------------------------------------------------------------------------
+//  initSampler: Initialises the sampler
+//------------------------------------------------------------------------------
+
+
+void initSampler
+
+  ( Sampler*  sampler ,
+    int       type    ,
+    int       spp     )
+
+{
+  sampler->type   = type;
+  sampler->spp    = spp;
+  sampler->pixel  = 0;
+  sampler->sample = 0;
+}
+
+
+//------------------------------------------------------------------------------
+//  startSample: Sets the pixel and sample index of the sampler
+//------------------------------------------------------------------------------
+
+
+void startSample
+
+  ( Sampler*       sampler ,
+    unsigned int   pixel   ,
+    unsigned int   sample  )
+
+{
+  sampler->pixel  = pixel;
+  sampler->sample = sample;
+}
+
+
+//------------------------------------------------------------------------------
+//  getSample2D: Returns a 2D sample point in [0,1)^2 for the current sample
+//------------------------------------------------------------------------------
+
+
+void getSample2D
+
+  ( Sampler*  sampler ,
+    int       dim     ,
+    double*   u       ,
+    double*   v       )
+
+{
+  unsigned int pixel  = sampler->pixel;
+  unsigned int sample = sampler->sample;
+  unsigned int seed   = pcgHash( pixel ^ pcgHash( 0x9e3779b9u * ( dim + 1 ) ) );
+
+  if ( sampler->type == SAMPLER_STRATIFIED )
+  {
+    // Jittered n x n grid, the strata are visited in a random order per 
+    // pixel and dimension
+
+    int n = (int)sqrt( (double)sampler->spp );
+    int s = sample;
+
+    if ( n > 0 && (int)sample < n * n )
+    {
+      s = permuteIndex( sample , n * n , seed );
+    }
+    else
+    {
+      n = 1;
+    }
+
+    *u = ( s % n + hashRandom( pixel , sample , 2*dim   ) ) / n;
+    *v = ( s / n + hashRandom( pixel , sample , 2*dim+1 ) ) / n;
+  }
+  else if ( sampler->type == SAMPLER_SOBOL )
+  {
+    // Owen-scrambled Sobol points, with a shuffled index per pixel and
+    // dimension (Burley, 2020)
+
+    unsigned int x,y;
+
+    sobol2D( owenScramble( sample , seed ) , &x , &y );
+
+    *u = owenScramble( x , pcgHash( seed ^ 0x68bc21ebu ) ) * TO_DOUBLE;
+    *v = owenScramble( y , pcgHash( seed ^ 0x02e5be93u ) ) * TO_DOUBLE;
+  }
+  else if ( sampler->type == SAMPLER_HALTON && 2 * dim + 1 < NUM_PRIMES )
+  {
+    // Each dimension pair has its own two primes. Deeper dimensions use the
+    // random numbers below, so that no two dimensions share a base.
+
+    int b = 2 * dim;
+
+    *u = radicalInverse( PRIMES[b]   , sample , seed );
+    *v = radicalInverse( PRIMES[b+1] , sample , pcgHash( seed ) );
+  }
+  else if ( sampler->type == SAMPLER_CMJ )
+  {
+    // Correlated multi-jittered sampling (Kensler, 2013), for any number of
+    // samples N = m x n
+
+    unsigned int N = sampler->spp;
+    unsigned int m = (unsigned int)sqrt( (double)N );
+    unsigned int n = ( N + m - 1 ) / m;
+    unsigned int s = permuteIndex( sample % N , N , seed * 0x51633e2du );
+
+    unsigned int sx = permuteIndex( s % m , m , seed * 0x68bc21ebu );
+    unsigned int sy = permuteIndex( s / m , n , seed * 0x02e5be93u );
+
+    double jx = hashRandom( pixel , sample , 2*dim   );
+    double jy = hashRandom( pixel , sample , 2*dim+1 );
+
+    *u = ( s % m + ( sy + jx ) / n ) / m;
+    *v = ( s / m + ( sx + jy ) / m ) / n;
+  }
+  else
+  {
+    *u = hashRandom( pixel , sample , 2*dim   );
+    *v = hashRandom( pixel , sample , 2*dim+1 );
+  }
+}
@@ -0,0 +1,139 @@
+/*------------------------------------------------------------------------------
+ *  This file is part of a small RayTracer code, that is used in the course
+ *  Scientific Computing for Mechanical Engineering (4EM30) at the Department
+ *  Mechanical Engineering at Eindhoven University of Technology.
+ *
+ *  (c) 2020-2024 Joris Remmers, TU/e
+ *
+ *  Versions:
+ *  19/10/2026 |              | First version
+ *----------------------------------------------------------------------------*/
+
+#ifndef UTIL_SAMPLER_H
+#define UTIL_SAMPLER_H
+
+#define SAMPLER_RANDOM      0
+#define SAMPLER_STRATIFIED  1
+#define SAMPLER_SOBOL       2
+#define SAMPLER_HALTON      3
+#define SAMPLER_CMJ         4
+
+//  Every part of the renderer that needs random numbers uses its own pair of
+//  dimensions, so that the patterns of the different parts are not correlated
+
+#define SAMPLER_DIM_PIXEL   0
+#define SAMPLER_DIM_LENS    1
+#define SAMPLER_DIM_LIGHT_SELECT  2
+#define SAMPLER_DIM_LIGHT   3
+
+
+//------------------------------------------------------------------------------
+//  Declaration of the Sampler type (generates the sample positions of a pixel)
+//      type    : SAMPLER_RANDOM, SAMPLER_STRATIFIED, SAMPLER_SOBOL,
+//                SAMPLER_HALTON or SAMPLER_CMJ
+//      spp     : number of samples per pixel (size of the pattern)
+//      pixel   : index of the current pixel
+//      sample  : index of the current sample
+//------------------------------------------------------------------------------
+
+
+typedef struct
+{
+  int            type;
+  int            spp;
+  unsigned int   pixel;
+  unsigned int   sample;
+} Sampler;
+
+
+//------------------------------------------------------------------------------
+//  getSamplerType: Returns the sampler type with the given name
+//
+//  Arguments:
+//      name    : random, stratified, sobol, halton or cmj
+//
+//  Return:
+//      int     : the type, -1 if the name is unknown
+//------------------------------------------------------------------------------
+
+
+int getSamplerType
+
+  ( char*          name );
+
+
+//------------------------------------------------------------------------------
+//  getSamplerName: Returns the name of a sampler type
+//
+//  Arguments:
+//      type    : the sampler type
+//
+//  Return:
+//      char*   : the name
+//------------------------------------------------------------------------------
+
+
+const char* getSamplerName
+
+  ( int            type );
+
+
+//------------------------------------------------------------------------------
+//  initSampler: Initialises the sampler
+//
+//  Arguments:
+//      sampler : Pointer to the sampler
+//      type    : the sampler type
+//      spp     : number of samples per pixel
+//
+//------------------------------------------------------------------------------
+
+
+void initSampler
+
+  ( Sampler*       sampler ,
+    int            type    ,
+    int            spp     );
+
+
+//------------------------------------------------------------------------------
+//  startSample: Sets the pixel and sample index of the sampler
+//
+//  Arguments:
+//      sampler : Pointer to the sampler
+//      pixel   : index of the pixel
+//      sample  : index of the sample
+//
+//------------------------------------------------------------------------------
+
+
+void startSample
+
+  ( Sampler*       sampler ,
+    unsigned int   pixel   ,
+    unsigned int   sample  );
+
+
+//------------------------------------------------------------------------------
+//  getSample2D: Returns a 2D sample point in [0,1)^2 for the current sample
+//
+//  Arguments:
+//      sampler : Pointer to the sampler
+//      dim     : index of the pair of dimensions (SAMPLER_DIM_...)
+//      u       : first coordinate (return argument)
+//      v       : second coordinate (return argument)
+//
+//------------------------------------------------------------------------------
+
+
+void getSample2D
+
+  ( Sampler*       sampler ,
+    int            dim     ,
+    double*        u       ,
+    double*        v       );
+
+
+#endif
+
+
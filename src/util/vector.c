@@ -205,3 +205,68 @@ inline Vec3 permute
   const double* vals = &a.x;
   return (Vec3){vals[kx], vals[ky], vals[kz]};
 }
+
+
+//------------------------------------------------------------------------------
+//  encodeOctNormal: Encodes a unit vector in 32 bits (octahedral mapping)
+//------------------------------------------------------------------------------
+
+unsigned int encodeOctNormal
+
+  ( Vec3*   n )
+
+{
+  double l1 = fabs(n->x) + fabs(n->y) + fabs(n->z);
+
+  if ( l1 == 0.0 )
+  {
+    return 0;
+  }
+
+  double u = n->x / l1;
+  double v = n->y / l1;
+
+  if ( n->z < 0.0 )
+  {
+    double uf = ( 1.0 - fabs(v) ) * ( u >= 0.0 ? 1.0 : -1.0 );
+    double vf = ( 1.0 - fabs(u) ) * ( v >= 0.0 ? 1.0 : -1.0 );
+    u = uf;
+    v = vf;
+  }
+
+  int iu = (int)lround( u * 32767.0 );
+  int iv = (int)lround( v * 32767.0 );
+
+  return ( (unsigned int)(iu & 0xffff) ) | ( (unsigned int)(iv & 0xffff) << 16 );
+}
+
+
+//------------------------------------------------------------------------------
+//  decodeOctNormal: Decodes an octahedral encoded unit vector
+//------------------------------------------------------------------------------
+
+Vec3 decodeOctNormal
+
+  ( unsigned int code )
+
+{
+  Vec3 n;
+
+  n.x = (short)( code & 0xffff ) / 32767.0;
+  n.y = (short)( code >> 16    ) / 32767.0;
+  n.z = 1.0 - fabs(n.x) - fabs(n.y);
+
+  if ( n.z < 0.0 )
+  {
+    double x = n.x;
+    n.x = ( 1.0 - fabs(n.y) ) * ( x   >= 0.0 ? 1.0 : -1.0 );
+    n.y = ( 1.0 - fabs(x)   ) * ( n.y >= 0.0 ? 1.0 : -1.0 );
+  }
+
+  if ( n.x != 0.0 || n.y != 0.0 || n.z != 0.0 )
+  {
+    unit( &n );
+  }
+
+  return n;
+}
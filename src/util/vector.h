@@ -27,6 +27,17 @@ typedef struct
 } Vec3;
 
 
+//------------------------------------------------------------------------------
+//  Declaration of the Vec3f type (a single precision vector, used for compact
+//  storage of mesh vertices)
+//------------------------------------------------------------------------------
+
+typedef struct 
+{
+  float      x,y,z;
+} Vec3f;
+
+
 //------------------------------------------------------------------------------
 //  unit: Calculates the unit of a vector v
 //  
@@ -213,6 +224,38 @@ Vec3 permute
     int    ky , 
     int    kz );
     
+
+
+//------------------------------------------------------------------------------
+//  encodeOctNormal: Encodes a unit vector in 32 bits using the octahedral
+//                   mapping (2 x 16 bit signed normalised coordinates)
+//
+//  Arguments:
+//      n       : unit vector n (Vec3)
+//
+//  Return: 
+//      unsigned int : the encoded vector
+//------------------------------------------------------------------------------
+
+unsigned int encodeOctNormal
+
+  ( Vec3*   n );
+
+
+//------------------------------------------------------------------------------
+//  decodeOctNormal: Decodes a unit vector that is encoded by encodeOctNormal
+//
+//  Arguments:
+//      code    : the encoded vector
+//
+//  Return: 
+//      Vec3    : the unit vector
+//------------------------------------------------------------------------------
+
+Vec3 decodeOctNormal
+
+  ( unsigned int code );
+    
 #endif
 
 